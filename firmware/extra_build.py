@@ -5,7 +5,7 @@ def after_build(source, target, env):
     version = os.popen("cat src/version.h | grep \"FIRMWARE_VERSION\" | cut -d'\"' -f 2").read().strip()
     buildTime = os.popen("cat src/version.h | grep \"BUILD_TIME\" | cut -d'\"' -f 2").read().strip()
     firmwareType = os.popen("cat src/version.h | grep \"FIRMWARE_TYPE\" | cut -d'\"' -f 2").read().strip()
-    chip = env['BOARD_MCU']
+    chip = env.get('BOARD_MCU', 'native')
 
     os.popen(f"mkdir -p /tmp/fkm-build ; cp {source[0].get_abspath()} /tmp/fkm-build/{chip}_{firmwareType}_{version}.bin")
 
@@ -15,7 +15,7 @@ def generate_version():
     buildTime = int(time.time())
     version = release_build == True and env["ENV"]["RELEASE_BUILD"] or ("D" + str(buildTime))
     versionPath = os.path.join(env["PROJECT_DIR"], "src", "version.h")
-    chip = env['BOARD_MCU']
+    chip = env.get('BOARD_MCU', 'native')
 
     print(f"Version: {version}")
     print(f"Build Time: {buildTime}")
@@ -29,9 +29,10 @@ def generate_version():
 #define BUILD_TIME "{buildTime}"
 #define FIRMWARE_TYPE "{firmwareType}"
 #define CHIP "{chip}"
-
+{releaseBuild}
 #endif
-""".format(version = version, buildTime = buildTime, chip = chip, firmwareType = "STATION" )
+""".format(version = version, buildTime = buildTime, chip = chip, firmwareType = "STATION",
+           releaseBuild = release_build and "#define RELEASE_BUILD\n" or "")
 
     with open(versionPath, "w") as file:
         file.write(versionString)
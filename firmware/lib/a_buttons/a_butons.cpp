@@ -49,6 +49,7 @@ void AButtons::loop() {
     b.disableAfterReleaseCbs = false;
 
     if (!isPinsPressed(b.pins)) continue;
+    if (edgeCb != NULL) edgeCb(b, true);
     if (b.afterPressCb != NULL) b.afterPressCb(b);
     bPressedTime = millis();
 
@@ -74,6 +75,8 @@ void AButtons::loop() {
       delay(checkDelay);
     }
 
+    if (edgeCb != NULL) edgeCb(b, false);
+
     // after release
     for (size_t cb = 0; cb < b.callbacks.size(); cb++) {
       ButtonCb &bcb = b.callbacks.at(cb);
@@ -156,6 +159,11 @@ void AButtons::addButtonReocCb(size_t idx, int _callInterval, reoc_callback_t ca
   std::sort(b.callbacks.begin(), b.callbacks.end(), compareButtonsCbs);
 }
 
+// Called on every press/release (before press and release callbacks)
+void AButtons::setEdgeCb(edge_callback_t callback) {
+  edgeCb = callback;
+}
+
 void AButtons::testButtonClick(std::vector<uint8_t> pins, int pressTime) {
   unsigned long bPressedTime = 0;
   unsigned long lastReocCbTime = 0;
@@ -165,6 +173,7 @@ void AButtons::testButtonClick(std::vector<uint8_t> pins, int pressTime) {
     if (!compare(b.pins, pins)) continue;
 
     b.disableAfterReleaseCbs = false;
+    if (edgeCb != NULL) edgeCb(b, true);
     if (b.afterPressCb != NULL) b.afterPressCb(b);
     bPressedTime = millis();
 
@@ -190,6 +199,8 @@ void AButtons::testButtonClick(std::vector<uint8_t> pins, int pressTime) {
       delay(checkDelay);
     }
 
+    if (edgeCb != NULL) edgeCb(b, false);
+
     // after release
     for (size_t cb = 0; cb < b.callbacks.size(); cb++) {
       ButtonCb &bcb = b.callbacks.at(cb);
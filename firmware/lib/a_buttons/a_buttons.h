@@ -10,6 +10,7 @@ struct Button;
 
 typedef void (*callback_t)(Button&);
 typedef void (*reoc_callback_t)(int);
+typedef void (*edge_callback_t)(Button&, bool pressed);
 
 struct ButtonCb {
   int callTime;
@@ -35,11 +36,13 @@ public:
   void addButtonCb(size_t idx, int _callTime, bool _afterRelease, callback_t callback);
   void addButtonReocCb(size_t idx, int _callInterval, reoc_callback_t callback);
   void testButtonClick(std::vector<uint8_t> pins, int pressTime);
+  void setEdgeCb(edge_callback_t callback);
   void loop();
 
 private:
   int checkDelay = 15;
   std::vector<Button> buttons;
+  edge_callback_t edgeCb = NULL;
 };
 
 #endif
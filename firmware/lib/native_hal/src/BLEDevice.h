@@ -0,0 +1,61 @@
+#ifndef __BLE_DEVICE_H__
+#define __BLE_DEVICE_H__
+
+#include <stdint.h>
+#include <string>
+
+// No radio on host, objects exist so setup code runs (nothing ever writes characteristic)
+class BLECharacteristic;
+
+class BLECharacteristicCallbacks {
+  public:
+    virtual ~BLECharacteristicCallbacks() {}
+    virtual void onWrite(BLECharacteristic */*pCharacteristic*/) {}
+};
+
+class BLECharacteristic {
+  public:
+    static const uint32_t PROPERTY_READ = 1 << 0;
+    static const uint32_t PROPERTY_WRITE = 1 << 1;
+    static const uint32_t PROPERTY_NOTIFY = 1 << 2;
+
+    void setCallbacks(BLECharacteristicCallbacks *callbacks) { this->callbacks = callbacks; }
+    std::string getValue() { return value; }
+    void setValue(const std::string &v) { value = v; }
+
+  private:
+    BLECharacteristicCallbacks *callbacks = nullptr;
+    std::string value;
+};
+
+class BLEService {
+  public:
+    BLECharacteristic *createCharacteristic(const char */*uuid*/, uint32_t /*properties*/) { return new BLECharacteristic(); }
+    void start() {}
+};
+
+class BLEServer {
+  public:
+    BLEService *createService(const char */*uuid*/) { return new BLEService(); }
+};
+
+class BLEAdvertising {
+  public:
+    void addServiceUUID(const char */*uuid*/) {}
+    void setScanResponse(bool /*set*/) {}
+    void setMinPreferred(uint16_t /*interval*/) {}
+};
+
+class BLEDevice {
+  public:
+    static void init(std::string /*deviceName*/) {}
+    static void deinit(bool /*releaseMemory*/ = false) {}
+    static BLEServer *createServer() { return new BLEServer(); }
+    static BLEAdvertising *getAdvertising() {
+      static BLEAdvertising advertising;
+      return &advertising;
+    }
+    static void startAdvertising() {}
+};
+
+#endif
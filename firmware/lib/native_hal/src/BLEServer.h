@@ -0,0 +1,6 @@
+#ifndef __BLE_SERVER_H__
+#define __BLE_SERVER_H__
+
+#include "BLEDevice.h"
+
+#endif
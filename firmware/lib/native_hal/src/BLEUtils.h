@@ -0,0 +1,6 @@
+#ifndef __BLE_UTILS_H__
+#define __BLE_UTILS_H__
+
+#include "BLEDevice.h"
+
+#endif
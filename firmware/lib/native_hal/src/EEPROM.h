@@ -0,0 +1,43 @@
+#ifndef __EEPROM_H__
+#define __EEPROM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// RAM copy of "eeprom" flash region, written back on commit() (nvs blob on esp32)
+class EEPROMClass {
+  public:
+    bool begin(size_t size);
+    void end();
+    bool commit();
+    size_t length() { return size; }
+
+    uint8_t read(int address) { return address >= 0 && (size_t)address < size ? data[address] : 0; }
+    void write(int address, uint8_t value) {
+      if (address < 0 || (size_t)address >= size) return;
+      data[address] = value;
+      dirty = true;
+    }
+
+    template <typename T> T &get(int address, T &t) {
+      if (address >= 0 && address + sizeof(T) <= size) memcpy((uint8_t *)&t, data + address, sizeof(T));
+      return t;
+    }
+    template <typename T> const T &put(int address, const T &t) {
+      if (address >= 0 && address + sizeof(T) <= size) {
+        memcpy(data + address, (const uint8_t *)&t, sizeof(T));
+        dirty = true;
+      }
+      return t;
+    }
+
+  private:
+    uint8_t *data = NULL;
+    size_t size = 0;
+    bool dirty = false;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef __ESP_MDNS_H__
+#define __ESP_MDNS_H__
+
+#include <stdint.h>
+#include "WString.h"
+#include "IPAddress.h"
+
+// Answers come from halMdnsAdd entries, query blocks for HAL_MDNS_QUERY_US like esp32 one
+class MDNSResponder {
+  public:
+    bool begin(const char */*hostName*/) { return true; }
+    void end() {}
+
+    int queryService(const char *service, const char *proto);
+    String hostname(int idx);
+    IPAddress IP(int idx);
+    uint16_t port(int idx);
+    String txt(int idx, const char *key);
+
+  private:
+    String queried;
+};
+
+extern MDNSResponder MDNS;
+
+#endif
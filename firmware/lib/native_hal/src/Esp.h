@@ -0,0 +1,21 @@
+#ifndef __ESP_H__
+#define __ESP_H__
+
+#include <stdint.h>
+
+class EspClass {
+  public:
+    uint64_t getEfuseMac();
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getHeapSize() { return 327680; }
+    uint32_t getFreeSketchSpace() { return 0x1E0000; } // app partition of partitions.csv
+    uint32_t getCpuFreqMHz();
+    const char *getChipModel() { return "ESP32-native"; }
+    void restart() __attribute__((noreturn));
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef __HARDWARE_SERIAL_H__
+#define __HARDWARE_SERIAL_H__
+
+#include "Stream.h"
+
+#define SERIAL_8N1 0x800001c
+
+// UART backed by hal (rx bytes injected with halUartInject, tx captured by halUartTake)
+class HardwareSerial : public Stream {
+  public:
+    HardwareSerial(int port) : port(port) {}
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1, bool invert = false,
+               unsigned long timeoutMs = 20000UL, uint8_t rxfifoFullThrhd = 112);
+    void end() {}
+    void updateBaudRate(unsigned long baud);
+    uint32_t baudRate() { return baud; }
+    size_t setRxBufferSize(size_t size) { return size; }
+    size_t setTxBufferSize(size_t size) { txBufferSize = size; return size; }
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    int availableForWrite() override { return txBufferSize; }
+    void flush() override {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+
+    operator bool() const { return true; }
+
+  private:
+    int port;
+    unsigned long baud = 115200;
+    size_t txBufferSize = 128;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+#endif
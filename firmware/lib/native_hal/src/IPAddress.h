@@ -0,0 +1,38 @@
+#ifndef __IP_ADDRESS_H__
+#define __IP_ADDRESS_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include "WString.h"
+
+class IPAddress {
+  public:
+    IPAddress() : IPAddress(0, 0, 0, 0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes{a, b, c, d} {}
+    IPAddress(uint32_t address) { for (int i = 0; i < 4; i++) bytes[i] = address >> (i * 8); }
+
+    bool fromString(const char *address) {
+      unsigned int a, b, c, d;
+      char end;
+      if (sscanf(address, "%u.%u.%u.%u%c", &a, &b, &c, &d, &end) != 4 || a > 255 || b > 255 || c > 255 || d > 255) return false;
+      *this = IPAddress(a, b, c, d);
+      return true;
+    }
+
+    String toString() const {
+      char buf[16];
+      snprintf(buf, sizeof(buf), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+      return String(buf);
+    }
+
+    operator uint32_t() const { return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24; }
+    bool operator==(const IPAddress &o) const { return (uint32_t)*this == (uint32_t)o; }
+    bool operator!=(const IPAddress &o) const { return !(*this == o); }
+    uint8_t operator[](int i) const { return bytes[i]; }
+    uint8_t &operator[](int i) { return bytes[i]; }
+
+  private:
+    uint8_t bytes[4];
+};
+
+#endif
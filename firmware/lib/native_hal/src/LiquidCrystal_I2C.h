@@ -0,0 +1,29 @@
+#ifndef __LIQUID_CRYSTAL_I2C_H__
+#define __LIQUID_CRYSTAL_I2C_H__
+
+#include "Print.h"
+
+// Characters end up in hal framebuffer (halLcd()), every one costs HAL_LCD_WRITE_US
+class LiquidCrystal_I2C : public Print {
+  public:
+    LiquidCrystal_I2C(uint8_t addr, uint8_t cols, uint8_t rows) : addr(addr), cols(cols), rows(rows) {}
+
+    void init();
+    void begin(uint8_t /*cols*/, uint8_t /*rows*/) { init(); }
+    void clear();
+    void home();
+    void setCursor(uint8_t col, uint8_t row);
+    void backlight();
+    void noBacklight();
+    void display() {}
+    void noDisplay() {}
+
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+  private:
+    uint8_t addr, cols, rows;
+    uint8_t col = 0, row = 0;
+};
+
+#endif
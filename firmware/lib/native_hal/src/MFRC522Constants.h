@@ -0,0 +1,79 @@
+#ifndef __MFRC522_CONSTANTS_H__
+#define __MFRC522_CONSTANTS_H__
+
+#include <stdint.h>
+
+// Register addresses as in MFRC522 datasheet (driver shifts them for spi)
+class MFRC522Constants {
+  public:
+    enum PCD_Register : uint8_t {
+      CommandReg = 0x01,
+      ComIEnReg = 0x02,
+      DivIEnReg = 0x03,
+      ComIrqReg = 0x04,
+      DivIrqReg = 0x05,
+      ErrorReg = 0x06,
+      Status1Reg = 0x07,
+      Status2Reg = 0x08,
+      FIFODataReg = 0x09,
+      FIFOLevelReg = 0x0A,
+      WaterLevelReg = 0x0B,
+      ControlReg = 0x0C,
+      BitFramingReg = 0x0D,
+      CollReg = 0x0E,
+      ModeReg = 0x11,
+      TxModeReg = 0x12,
+      RxModeReg = 0x13,
+      TxControlReg = 0x14,
+      TxASKReg = 0x15,
+      ModWidthReg = 0x24,
+      RFCfgReg = 0x26,
+      TModeReg = 0x2A,
+      TPrescalerReg = 0x2B,
+      TReloadRegH = 0x2C,
+      TReloadRegL = 0x2D,
+      VersionReg = 0x37,
+    };
+
+    enum PCD_Command : uint8_t {
+      PCD_Idle = 0x00,
+      PCD_Mem = 0x01,
+      PCD_CalcCRC = 0x03,
+      PCD_Transmit = 0x04,
+      PCD_NoCmdChange = 0x07,
+      PCD_Receive = 0x08,
+      PCD_Transceive = 0x0C,
+      PCD_MFAuthent = 0x0E,
+      PCD_SoftReset = 0x0F,
+    };
+
+    enum PICC_Command : uint8_t {
+      PICC_CMD_REQA = 0x26,
+      PICC_CMD_WUPA = 0x52,
+      PICC_CMD_CT = 0x88,
+      PICC_CMD_SEL_CL1 = 0x93,
+      PICC_CMD_SEL_CL2 = 0x95,
+      PICC_CMD_SEL_CL3 = 0x97,
+      PICC_CMD_HLTA = 0x50,
+    };
+
+    enum StatusCode : uint8_t {
+      STATUS_OK,
+      STATUS_ERROR,
+      STATUS_COLLISION,
+      STATUS_TIMEOUT,
+      STATUS_NO_ROOM,
+      STATUS_INTERNAL_ERROR,
+      STATUS_INVALID,
+      STATUS_CRC_WRONG,
+      STATUS_MIFARE_NACK = 0xff,
+    };
+
+    struct Uid {
+      uint8_t size;
+      uint8_t uidByte[10];
+      uint8_t sak;
+    };
+};
+
+#endif
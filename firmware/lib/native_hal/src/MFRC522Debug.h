@@ -0,0 +1,12 @@
+#ifndef __MFRC522_DEBUG_H__
+#define __MFRC522_DEBUG_H__
+
+#include "MFRC522v2.h"
+#include "Print.h"
+
+class MFRC522Debug {
+  public:
+    static void PCD_DumpVersionToSerial(MFRC522 &/*device*/, Print &logPrint) { logPrint.println("Firmware Version: 0x92 = v2.0 (emulated)"); }
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef __MFRC522_DRIVER_H__
+#define __MFRC522_DRIVER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "MFRC522Constants.h"
+
+class MFRC522Driver {
+  public:
+    using PCD_Register = MFRC522Constants::PCD_Register;
+
+    virtual ~MFRC522Driver() {}
+    virtual bool init() = 0;
+    virtual void PCD_WriteRegister(PCD_Register reg, uint8_t value) = 0;
+    virtual void PCD_WriteRegister(PCD_Register reg, uint8_t count, uint8_t *values) = 0;
+    virtual uint8_t PCD_ReadRegister(PCD_Register reg) = 0;
+    virtual void PCD_ReadRegister(PCD_Register reg, uint8_t count, uint8_t *values, uint8_t rxAlign = 0) = 0;
+};
+
+class MFRC522DriverPin {
+  public:
+    virtual ~MFRC522DriverPin() {}
+    virtual bool init() = 0;
+    virtual bool high() = 0;
+    virtual bool low() = 0;
+};
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef __MFRC522_DRIVER_PIN_SIMPLE_H__
+#define __MFRC522_DRIVER_PIN_SIMPLE_H__
+
+#include "MFRC522Driver.h"
+
+class MFRC522DriverPinSimple : public MFRC522DriverPin {
+  public:
+    MFRC522DriverPinSimple(uint8_t pin) : pin(pin) {}
+    bool init() override { return true; }
+    bool high() override { return true; }
+    bool low() override { return true; }
+
+  private:
+    uint8_t pin;
+};
+
+#endif
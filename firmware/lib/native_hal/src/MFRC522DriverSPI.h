@@ -0,0 +1,37 @@
+#ifndef __MFRC522_DRIVER_SPI_H__
+#define __MFRC522_DRIVER_SPI_H__
+
+#include "MFRC522Driver.h"
+#include "SPI.h"
+
+// Register file of emulated MFRC522, card in field is set with halRfidPresent().
+// Transceive of REQA/WUPA, anticollision, select and HLTA is evaluated: answer is
+// in fifo HAL_RFID_ATQA_US after StartSend, TimerIRq after HAL_RFID_TIMER_US when
+// card doesn't answer. PICC_ReadCardSerial still selects card in one blocking call.
+class MFRC522DriverSPI : public MFRC522Driver {
+  public:
+    MFRC522DriverSPI(MFRC522DriverPin &chipSelectPin, SPIClass &/*spiClass*/ = SPI, const SPISettings /*spiSettings*/ = SPISettings(4000000u))
+        : chipSelectPin(chipSelectPin) {}
+
+    bool init() override;
+    void PCD_WriteRegister(PCD_Register reg, uint8_t value) override;
+    void PCD_WriteRegister(PCD_Register reg, uint8_t count, uint8_t *values) override;
+    uint8_t PCD_ReadRegister(PCD_Register reg) override;
+    void PCD_ReadRegister(PCD_Register reg, uint8_t count, uint8_t *values, uint8_t rxAlign = 0) override;
+
+  private:
+    MFRC522DriverPin &chipSelectPin;
+    uint8_t regs[64] = {0};
+    uint8_t fifo[64];
+    uint8_t fifoLevel = 0;
+    uint8_t fifoRead = 0;
+    uint8_t answer[8];
+    uint8_t answerLen = 0;
+    uint64_t answerAt = 0; // virtual us, 0 - no answer pending
+    uint64_t timerAt = 0;  // virtual us, 0 - timer stopped
+
+    void transceive();
+    void answerWith(const uint8_t *data, uint8_t len);
+};
+
+#endif
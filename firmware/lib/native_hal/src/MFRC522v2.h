@@ -0,0 +1,29 @@
+#ifndef __MFRC522V2_H__
+#define __MFRC522V2_H__
+
+#include "MFRC522Constants.h"
+#include "MFRC522Driver.h"
+
+class MFRC522 {
+  public:
+    using Uid = MFRC522Constants::Uid;
+    using StatusCode = MFRC522Constants::StatusCode;
+
+    MFRC522(MFRC522Driver &driver) : driver(driver) {}
+
+    bool PCD_Init();
+    void PCD_AntennaOn();
+    void PCD_AntennaOff();
+    void PCD_SoftPowerDown();
+    void PCD_SoftPowerUp();
+    bool PICC_IsNewCardPresent();
+    bool PICC_ReadCardSerial();
+    StatusCode PICC_HaltA();
+
+    Uid uid = {};
+
+  private:
+    MFRC522Driver &driver;
+};
+
+#endif
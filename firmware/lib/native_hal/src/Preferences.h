@@ -0,0 +1,46 @@
+#ifndef __PREFERENCES_H__
+#define __PREFERENCES_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "WString.h"
+
+// Every key is "nvs/<namespace>/<key>" flash region
+class Preferences {
+  public:
+    bool begin(const char *name, bool readOnly = false, const char *partitionLabel = NULL);
+    void end() { started = false; }
+    bool clear();
+    bool remove(const char *key);
+    bool isKey(const char *key);
+
+    size_t putBytes(const char *key, const void *value, size_t len);
+    size_t getBytes(const char *key, void *buf, size_t maxLen);
+    size_t getBytesLength(const char *key);
+
+    size_t putUInt(const char *key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+    uint32_t getUInt(const char *key, uint32_t defaultValue = 0) { return getValue(key, defaultValue); }
+    size_t putInt(const char *key, int32_t value) { return putBytes(key, &value, sizeof(value)); }
+    int32_t getInt(const char *key, int32_t defaultValue = 0) { return getValue(key, defaultValue); }
+    size_t putULong64(const char *key, uint64_t value) { return putBytes(key, &value, sizeof(value)); }
+    uint64_t getULong64(const char *key, uint64_t defaultValue = 0) { return getValue(key, defaultValue); }
+    size_t putBool(const char *key, bool value) { return putBytes(key, &value, sizeof(value)); }
+    bool getBool(const char *key, bool defaultValue = false) { return getValue(key, defaultValue); }
+    size_t putString(const char *key, const char *value) { return putBytes(key, value, strlen(value) + 1); }
+    size_t putString(const char *key, const String &value) { return putString(key, value.c_str()); }
+    String getString(const char *key, const String &defaultValue = String());
+
+  private:
+    String ns;
+    bool readOnly = false;
+    bool started = false;
+
+    String region(const char *key) { return String("nvs/") + ns + "/" + key; }
+    template <typename T> T getValue(const char *key, T defaultValue) {
+      T value;
+      return getBytesLength(key) == sizeof(T) && getBytes(key, &value, sizeof(T)) == sizeof(T) ? value : defaultValue;
+    }
+};
+
+#endif
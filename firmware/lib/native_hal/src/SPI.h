@@ -0,0 +1,26 @@
+#ifndef __SPI_H__
+#define __SPI_H__
+
+#include <stdint.h>
+
+#define SPI_MODE0 0x00
+
+class SPISettings {
+  public:
+    SPISettings(uint32_t clock = 1000000, uint8_t /*bitOrder*/ = 1, uint8_t /*dataMode*/ = SPI_MODE0) : clock(clock) {}
+    uint32_t clock;
+};
+
+// bus itself isn't emulated, devices (mfrc522) are emulated at driver level
+class SPIClass {
+  public:
+    void begin(int8_t /*sck*/ = -1, int8_t /*miso*/ = -1, int8_t /*mosi*/ = -1, int8_t /*ss*/ = -1) { started = true; }
+    void end() { started = false; }
+    void beginTransaction(SPISettings /*settings*/) {}
+    void endTransaction() {}
+    bool started = false;
+};
+
+extern SPIClass SPI;
+
+#endif
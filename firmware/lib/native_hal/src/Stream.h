@@ -0,0 +1,28 @@
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#include "Print.h"
+
+class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    size_t readBytes(uint8_t *buffer, size_t length) {
+      size_t n = 0;
+      while (n < length && available() > 0) buffer[n++] = read();
+      return n;
+    }
+    String readString() {
+      String s;
+      while (available() > 0) s += (char)read();
+      return s;
+    }
+
+  protected:
+    unsigned long _timeout = 1000;
+};
+
+#endif
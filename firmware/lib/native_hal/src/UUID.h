@@ -0,0 +1,48 @@
+#ifndef __UUID_H__
+#define __UUID_H__
+
+#include <stdint.h>
+
+#define UUID_LENGTH 37
+
+// Like robtillaart/UUID: Marsaglia MWC generator, version 4 format
+class UUID {
+  public:
+    UUID() { seed(1, 2); generate(); }
+
+    void seed(uint32_t s1, uint32_t s2 = 0) {
+      m_w = s1 == 0 ? 1 : s1;
+      m_z = s2 == 0 ? 2 : s2;
+    }
+
+    void generate() {
+      static const char hex[] = "0123456789abcdef";
+      uint32_t ar[4];
+      for (int i = 0; i < 4; i++) ar[i] = random();
+      ar[1] = (ar[1] & 0xFFFF0FFF) | 0x00004000; // version 4
+      ar[2] = (ar[2] & 0x3FFFFFFF) | 0x80000000; // variant 1
+
+      int j = 0;
+      for (int i = 0; i < 16; i++) {
+        if (i == 4 || i == 6 || i == 8 || i == 10) buffer[j++] = '-';
+        uint8_t b = ar[i / 4] >> (24 - (i % 4) * 8);
+        buffer[j++] = hex[b >> 4];
+        buffer[j++] = hex[b & 0x0F];
+      }
+      buffer[j] = '\0';
+    }
+
+    char *toCharArray() { return buffer; }
+
+  private:
+    uint32_t m_w, m_z;
+    char buffer[UUID_LENGTH];
+
+    uint32_t random() {
+      m_z = 36969L * (m_z & 65535L) + (m_z >> 16);
+      m_w = 18000L * (m_w & 65535L) + (m_w >> 16);
+      return (m_z << 16) + m_w;
+    }
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef __UPDATE_H__
+#define __UPDATE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Print.h"
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+#define UPDATE_ERROR_OK 0
+#define UPDATE_ERROR_SIZE 4
+#define UPDATE_ERROR_NO_PARTITION 10
+
+// Image goes into "part/app1" flash region (like second ota slot), nothing is booted from it
+class UpdateClass {
+  public:
+    bool begin(size_t size = UPDATE_SIZE_UNKNOWN);
+    size_t write(uint8_t *data, size_t len);
+    bool end(bool evenIfRemaining = false);
+    void abort() { started = false; }
+    void printError(Print &out);
+    bool hasError() { return error != UPDATE_ERROR_OK; }
+    uint8_t getError() { return error; }
+    bool isRunning() { return started; }
+    size_t progress() { return written; }
+    size_t size() { return total; }
+
+  private:
+    bool started = false;
+    size_t total = 0;
+    size_t written = 0;
+    uint8_t error = UPDATE_ERROR_OK;
+};
+
+extern UpdateClass Update;
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef __WSTRING_H__
+#define __WSTRING_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+
+// Arduino String on top of std::string (subset used by station and its libraries)
+class String {
+  public:
+    String() {}
+    String(const char *s) : s(s != NULL ? s : "") {}
+    String(const char *s, size_t len) : s(s, len) {}
+    String(const std::string &s) : s(s) {}
+    String(char c) : s(1, c) {}
+    String(unsigned char v, unsigned char base = 10) { fromInt(v, base); }
+    String(int v, unsigned char base = 10) { fromInt(v, base); }
+    String(unsigned int v, unsigned char base = 10) { fromUInt(v, base); }
+    String(long v, unsigned char base = 10) { fromInt(v, base); }
+    String(unsigned long v, unsigned char base = 10) { fromUInt(v, base); }
+    String(long long v, unsigned char base = 10) { fromInt(v, base); }
+    String(unsigned long long v, unsigned char base = 10) { fromUInt(v, base); }
+    String(float v, unsigned int decimals = 2) { fromDouble(v, decimals); }
+    String(double v, unsigned int decimals = 2) { fromDouble(v, decimals); }
+
+    const char *c_str() const { return s.c_str(); }
+    unsigned int length() const { return s.length(); }
+    bool isEmpty() const { return s.empty(); }
+    void reserve(unsigned int size) { s.reserve(size); }
+
+    bool concat(const char *str, unsigned int len) { s.append(str, len); return true; }
+    bool concat(const String &str) { s += str.s; return true; }
+    bool concat(const char *str) { if (str != NULL) s += str; return true; }
+    bool concat(char c) { s += c; return true; }
+    template <typename T> bool concat(T v) { s += String(v).s; return true; }
+
+    String &operator+=(const String &str) { s += str.s; return *this; }
+    String &operator+=(const char *str) { if (str != NULL) s += str; return *this; }
+    String &operator+=(char c) { s += c; return *this; }
+    template <typename T> String &operator+=(T v) { s += String(v).s; return *this; }
+
+    char operator[](unsigned int i) const { return i < s.length() ? s[i] : 0; }
+    char &operator[](unsigned int i) { return s[i]; }
+    char charAt(unsigned int i) const { return (*this)[i]; }
+
+    bool operator==(const String &o) const { return s == o.s; }
+    bool operator==(const char *o) const { return o != NULL && s == o; }
+    bool operator!=(const String &o) const { return s != o.s; }
+    bool operator!=(const char *o) const { return !(*this == o); }
+    bool operator<(const String &o) const { return s < o.s; }
+    bool equals(const String &o) const { return s == o.s; }
+    bool startsWith(const String &p) const { return s.compare(0, p.s.length(), p.s) == 0; }
+    bool endsWith(const String &p) const { return s.length() >= p.s.length() && s.compare(s.length() - p.s.length(), p.s.length(), p.s) == 0; }
+
+    String substring(unsigned int from) const { return from >= s.length() ? String() : String(s.substr(from)); }
+    String substring(unsigned int from, unsigned int to) const {
+      if (from > to) { unsigned int t = from; from = to; to = t; }
+      if (from >= s.length()) return String();
+      return String(s.substr(from, to - from));
+    }
+
+    int indexOf(char c, unsigned int from = 0) const { size_t i = s.find(c, from); return i == std::string::npos ? -1 : (int)i; }
+    int indexOf(const String &str, unsigned int from = 0) const { size_t i = s.find(str.s, from); return i == std::string::npos ? -1 : (int)i; }
+    int lastIndexOf(char c) const { size_t i = s.rfind(c); return i == std::string::npos ? -1 : (int)i; }
+
+    long toInt() const { return strtol(s.c_str(), NULL, 10); }
+    float toFloat() const { return strtof(s.c_str(), NULL); }
+    double toDouble() const { return strtod(s.c_str(), NULL); }
+
+    void toLowerCase() { for (char &c : s) c = tolower(c); }
+    void toUpperCase() { for (char &c : s) c = toupper(c); }
+    void trim() {
+      size_t b = s.find_first_not_of(" \t\r\n");
+      size_t e = s.find_last_not_of(" \t\r\n");
+      s = b == std::string::npos ? "" : s.substr(b, e - b + 1);
+    }
+    void replace(const String &from, const String &to) {
+      if (from.s.empty()) return;
+      for (size_t i = s.find(from.s); i != std::string::npos; i = s.find(from.s, i + to.s.length())) s.replace(i, from.s.length(), to.s);
+    }
+    void remove(unsigned int index, unsigned int count = (unsigned int)-1) { if (index < s.length()) s.erase(index, count); }
+
+    void getBytes(unsigned char *buf, unsigned int size, unsigned int index = 0) const { toCharArray((char *)buf, size, index); }
+    void toCharArray(char *buf, unsigned int size, unsigned int index = 0) const {
+      if (size == 0) return;
+      size_t n = index < s.length() ? s.copy(buf, size - 1, index) : 0;
+      buf[n] = '\0';
+    }
+
+    friend String operator+(const String &a, const String &b) { return String(a.s + b.s); }
+    friend String operator+(const String &a, const char *b) { return String(a.s + (b != NULL ? b : "")); }
+    friend String operator+(const char *a, const String &b) { return String(std::string(a != NULL ? a : "") + b.s); }
+    template <typename T> friend String operator+(const String &a, T b) { return String(a.s + String(b).s); }
+
+  private:
+    std::string s;
+
+    template <typename T> void fromInt(T v, unsigned char base) {
+      if (v < 0 && base == 10) { s = "-"; fromUInt((unsigned long long)(-(long long)v), base, true); return; }
+      fromUInt((unsigned long long)v, base);
+    }
+    void fromUInt(unsigned long long v, unsigned char base, bool append = false) {
+      char buf[66];
+      int i = sizeof(buf) - 1;
+      buf[i] = '\0';
+      do {
+        int d = v % base;
+        buf[--i] = d < 10 ? '0' + d : 'a' + d - 10;
+        v /= base;
+      } while (v > 0);
+      if (append) s += &buf[i];
+      else s = &buf[i];
+    }
+    void fromDouble(double v, unsigned int decimals) {
+      char buf[64];
+      snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+      s = buf;
+    }
+};
+
+#endif
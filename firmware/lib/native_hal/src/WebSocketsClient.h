@@ -0,0 +1,93 @@
+#ifndef __WEBSOCKETS_CLIENT_H__
+#define __WEBSOCKETS_CLIENT_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <string>
+#include "WString.h"
+
+typedef enum {
+  WStype_ERROR,
+  WStype_DISCONNECTED,
+  WStype_CONNECTED,
+  WStype_TEXT,
+  WStype_BIN,
+  WStype_FRAGMENT_TEXT_START,
+  WStype_FRAGMENT_BIN_START,
+  WStype_FRAGMENT,
+  WStype_FRAGMENT_FIN,
+  WStype_PING,
+  WStype_PONG,
+} WStype_t;
+
+// Client side of hal loopback websocket (server side is halWs* api). Connect
+// (tcp + upgrade) blocks for two rtts inside loop(), like the real library.
+// With halNetReal it's a plain ws:// client over host tcp socket instead
+class WebSocketsClient {
+  public:
+    typedef std::function<void(WStype_t type, uint8_t *payload, size_t length)> WebSocketClientEvent;
+
+    void begin(const char *host, uint16_t port, const char *url = "/", const char *protocol = "arduino");
+    void begin(String host, uint16_t port, String url = "/", String protocol = "arduino") {
+      begin(host.c_str(), port, url.c_str(), protocol.c_str());
+    }
+    void beginSSL(const char *host, uint16_t port, const char *url = "/", const char */*fingerprint*/ = "", const char *protocol = "arduino") {
+      begin(host, port, url, protocol);
+    }
+    void beginSslWithCA(const char *host, uint16_t port, const char *url = "/", const char */*caCert*/ = NULL, const char *protocol = "arduino") {
+      begin(host, port, url, protocol);
+    }
+
+    void onEvent(WebSocketClientEvent cbEvent) { event = cbEvent; }
+    void loop();
+
+    bool sendTXT(uint8_t *payload, size_t length = 0, bool headerToPayload = false);
+    bool sendTXT(const uint8_t *payload, size_t length = 0) { return sendTXT((uint8_t *)payload, length); }
+    bool sendTXT(char *payload, size_t length = 0, bool /*headerToPayload*/ = false) { return sendTXT((uint8_t *)payload, length); }
+    bool sendTXT(const char *payload, size_t length = 0) { return sendTXT((uint8_t *)payload, length); }
+    bool sendTXT(String &payload) { return sendTXT((uint8_t *)payload.c_str(), payload.length()); }
+
+    bool sendBIN(uint8_t *payload, size_t length, bool headerToPayload = false);
+    bool sendBIN(const uint8_t *payload, size_t length) { return sendBIN((uint8_t *)payload, length); }
+
+    bool sendPing(uint8_t *payload = NULL, size_t length = 0);
+    bool sendPing(String &payload) { return sendPing((uint8_t *)payload.c_str(), payload.length()); }
+
+    void disconnect();
+    bool isConnected() { return connected; }
+    void setReconnectInterval(unsigned long time) { reconnectInterval = time; }
+    void enableHeartbeat(uint32_t /*pingInterval*/, uint32_t /*pongTimeout*/, uint8_t /*disconnectTimeoutCount*/) {}
+    void disableHeartbeat() {}
+
+  private:
+    WebSocketClientEvent event;
+    String host, url;
+    uint16_t port = 0;
+    bool started = false;
+    bool connected = false;
+    uint32_t connection = 0;       // hal connection it belongs to
+    unsigned long lastAttempt = 0; // ms
+    uint64_t upgradeAt = 0;        // virtual us, http upgrade answered
+    bool attempted = false;
+    unsigned long reconnectInterval = 500;
+
+    // halNetReal connection
+    int sock = -1;
+    bool upgrading = false;     // request sent, waiting for http response (until upgradeAt)
+    std::string inbox;          // received bytes, not yet parsed into frames
+    std::string fragments;      // payload of unfinished message
+    uint8_t fragmentsOpcode = 0;
+
+    void runEvent(WStype_t type, uint8_t *payload, size_t length) {
+      if (event) event(type, payload, length);
+    }
+
+    void realLoop();
+    bool realConnect();
+    bool realUpgraded();
+    bool realSend(uint8_t opcode, const uint8_t *payload, size_t length);
+    void realClose();
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef __WIFI_H__
+#define __WIFI_H__
+
+#include <stdint.h>
+#include "WString.h"
+#include "IPAddress.h"
+
+typedef enum {
+  WL_NO_SHIELD = 255,
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL,
+  WL_SCAN_COMPLETED,
+  WL_CONNECTED,
+  WL_CONNECT_FAILED,
+  WL_CONNECTION_LOST,
+  WL_DISCONNECTED,
+} wl_status_t;
+
+typedef enum {
+  WIFI_OFF,
+  WIFI_STA,
+  WIFI_AP,
+  WIFI_AP_STA,
+} wifi_mode_t;
+
+typedef enum {
+  WIFI_PS_NONE,
+  WIFI_PS_MIN_MODEM,
+  WIFI_PS_MAX_MODEM,
+} wifi_ps_type_t;
+
+// Association takes HAL_WIFI_CONNECT_US (HAL_WIFI_FAST_CONNECT_US with channel + bssid),
+// only while ap is available (halWifiAvailable)
+class WiFiClass {
+  public:
+    bool mode(wifi_mode_t m) { wifiMode = m; return true; }
+    wifi_mode_t getMode() { return wifiMode; }
+    bool persistent(bool /*persistent*/) { return true; }
+    bool setSleep(wifi_ps_type_t type) { sleepType = type; return true; } // no effect on loopback latency
+    wifi_ps_type_t getSleep() { return sleepType; }
+
+    wl_status_t begin(const char *ssid, const char *passphrase = NULL, int32_t channel = 0, const uint8_t *bssid = NULL,
+                      bool connect = true);
+    wl_status_t begin() { return begin(ssid.c_str(), pass.c_str()); }
+    bool reconnect();
+    bool disconnect(bool wifiOff = false, bool eraseAp = false);
+    wl_status_t status();
+    bool isConnected() { return status() == WL_CONNECTED; }
+
+    String SSID() { return ssid; }
+    String psk() { return pass; }
+    uint8_t *BSSID();
+    String BSSIDstr();
+    int32_t channel();
+    int8_t RSSI() { return isConnected() ? -50 : 0; }
+    IPAddress localIP() { return isConnected() ? IPAddress(127, 0, 0, 2) : IPAddress(); }
+    String macAddress();
+
+    int hostByName(const char *host, IPAddress &result);
+
+  private:
+    wifi_mode_t wifiMode = WIFI_OFF;
+    wifi_ps_type_t sleepType = WIFI_PS_MIN_MODEM;
+    String ssid, pass;
+    bool started = false;
+    uint64_t connectedAt = 0; // virtual us
+};
+
+extern WiFiClass WiFi;
+
+// Tcp connect succeeds when loopback server listens on given port (takes one rtt),
+// with halNetReal it's real connect to the host
+class WiFiClient {
+  public:
+    ~WiFiClient() { stop(); }
+
+    int connect(const char *host, uint16_t port, int32_t timeoutMs = 3000);
+    int connect(IPAddress ip, uint16_t port, int32_t timeoutMs = 3000) { return connect(ip.toString().c_str(), port, timeoutMs); }
+    void stop();
+    uint8_t connected() { return isOpen; }
+
+  private:
+    bool isOpen = false;
+    int sock = -1;
+};
+
+#endif
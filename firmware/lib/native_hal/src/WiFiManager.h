@@ -0,0 +1,23 @@
+#ifndef __WIFI_MANAGER_H__
+#define __WIFI_MANAGER_H__
+
+#include "WiFi.h"
+
+// Saved credentials are always there, autoConnect waits for association
+class WiFiManager {
+  public:
+    void setConfigPortalTimeout(unsigned long /*seconds*/) {}
+    void setConfigPortalBlocking(bool /*shouldBlock*/) {}
+    void setConnectRetries(uint8_t /*numRetries*/) {}
+    void setConnectTimeout(unsigned long seconds) { connectTimeout = seconds; }
+    void setAPCallback(void (*/*func*/)(WiFiManager *)) {}
+
+    bool autoConnect(const char *apName = NULL, const char *apPassword = NULL);
+    bool process() { return WiFi.isConnected(); }
+    void resetSettings() {}
+
+  private:
+    unsigned long connectTimeout = 10;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef __WIFI_UDP_H__
+#define __WIFI_UDP_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include "IPAddress.h"
+
+// Real (non blocking) udp socket on the host. Loopback server has no udp
+// endpoint, so datagrams only go somewhere with halNetReal (tools/test_server.py --udp)
+class WiFiUDP {
+  public:
+    ~WiFiUDP() { stop(); }
+
+    uint8_t begin(uint16_t port);
+    void stop();
+    int beginPacket(IPAddress ip, uint16_t port);
+    size_t write(const uint8_t *buffer, size_t size);
+    int endPacket();
+    int parsePacket();
+    int read(uint8_t *buffer, size_t len);
+    void flush() { rx.clear(); }
+    IPAddress remoteIP() { return rxIp; }
+    uint16_t remotePort() { return rxPort; }
+
+    uint32_t sent = 0;
+
+  private:
+    int sock = -1;
+    IPAddress txIp, rxIp;
+    uint16_t txPort = 0, rxPort = 0;
+    std::string tx, rx;
+};
+
+#endif
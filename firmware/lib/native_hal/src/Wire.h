@@ -0,0 +1,16 @@
+#ifndef __WIRE_H__
+#define __WIRE_H__
+
+#include <stdint.h>
+
+// bus itself isn't emulated, devices (lcd) are emulated at driver level
+class TwoWire {
+  public:
+    bool begin(int /*sda*/ = -1, int /*scl*/ = -1, uint32_t /*frequency*/ = 0) { return true; }
+    bool end() { return true; }
+    bool setClock(uint32_t /*frequency*/) { return true; }
+};
+
+extern TwoWire Wire;
+
+#endif
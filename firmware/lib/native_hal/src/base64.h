@@ -0,0 +1,30 @@
+#ifndef __BASE64_H__
+#define __BASE64_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "WString.h"
+
+class base64 {
+  public:
+    static String encode(const uint8_t *data, size_t length) {
+      static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+      String out;
+      out.reserve((length + 2) / 3 * 4);
+      for (size_t i = 0; i < length; i += 3) {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < length) v |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < length) v |= data[i + 2];
+
+        out += table[(v >> 18) & 0x3F];
+        out += table[(v >> 12) & 0x3F];
+        out += i + 1 < length ? table[(v >> 6) & 0x3F] : '=';
+        out += i + 2 < length ? table[v & 0x3F] : '=';
+      }
+      return out;
+    }
+
+    static String encode(const String &text) { return encode((const uint8_t *)text.c_str(), text.length()); }
+};
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef __DRIVER_RTC_IO_H__
+#define __DRIVER_RTC_IO_H__
+
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+inline esp_err_t rtc_gpio_init(gpio_num_t /*pin*/) { return ESP_OK; }
+inline esp_err_t rtc_gpio_deinit(gpio_num_t /*pin*/) { return ESP_OK; }
+inline esp_err_t rtc_gpio_hold_en(gpio_num_t /*pin*/) { return ESP_OK; }
+inline esp_err_t rtc_gpio_hold_dis(gpio_num_t /*pin*/) { return ESP_OK; }
+inline esp_err_t rtc_gpio_pullup_en(gpio_num_t /*pin*/) { return ESP_OK; }
+inline esp_err_t rtc_gpio_pullup_dis(gpio_num_t /*pin*/) { return ESP_OK; }
+inline esp_err_t rtc_gpio_pulldown_en(gpio_num_t /*pin*/) { return ESP_OK; }
+inline esp_err_t rtc_gpio_pulldown_dis(gpio_num_t /*pin*/) { return ESP_OK; }
+
+#endif
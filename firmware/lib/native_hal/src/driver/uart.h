@@ -0,0 +1,21 @@
+#ifndef __DRIVER_UART_H__
+#define __DRIVER_UART_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum {
+  UART_NUM_0,
+  UART_NUM_1,
+  UART_NUM_2,
+  UART_NUM_MAX,
+} uart_port_t;
+
+typedef enum {
+  UART_SCLK_APB,
+  UART_SCLK_REF_TICK,
+} uart_sclk_t;
+
+esp_err_t uart_set_baudrate(uart_port_t port, uint32_t baud);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef __ESP_PM_H__
+#define __ESP_PM_H__
+
+#include "esp_err.h"
+
+// host has no frequency scaling, esp_pm_configure reports it like sdk without CONFIG_PM_ENABLE
+typedef struct esp_pm_lock *esp_pm_lock_handle_t;
+
+typedef enum {
+  ESP_PM_CPU_FREQ_MAX,
+  ESP_PM_APB_FREQ_MAX,
+  ESP_PM_NO_LIGHT_SLEEP,
+} esp_pm_lock_type_t;
+
+typedef struct {
+  int max_freq_mhz;
+  int min_freq_mhz;
+  bool light_sleep_enable;
+} esp_pm_config_esp32_t;
+
+inline esp_err_t esp_pm_configure(const void */*config*/) { return ESP_ERR_NOT_SUPPORTED; }
+inline esp_err_t esp_pm_lock_create(esp_pm_lock_type_t /*type*/, int /*arg*/, const char */*name*/, esp_pm_lock_handle_t *out) {
+  *out = NULL;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+inline esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t /*lock*/) { return ESP_ERR_NOT_SUPPORTED; }
+inline esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t /*lock*/) { return ESP_ERR_NOT_SUPPORTED; }
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef __ESP_TASK_WDT_H__
+#define __ESP_TASK_WDT_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+// no hardware watchdog on host, stalls are still caught by watchdog.hpp
+inline esp_err_t esp_task_wdt_init(uint32_t /*timeout*/, bool /*panic*/) { return ESP_OK; }
+inline esp_err_t esp_task_wdt_add(TaskHandle_t /*task*/) { return ESP_OK; }
+inline esp_err_t esp_task_wdt_delete(TaskHandle_t /*task*/) { return ESP_OK; }
+inline esp_err_t esp_task_wdt_reset() { return ESP_OK; }
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef __HAL_H__
+#define __HAL_H__
+
+// Control side of native hal (tests, benchmarks, runner). Station code never
+// includes this, it only sees Arduino/ESP-IDF headers implemented on top of it.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <functional>
+
+// ---- virtual clock and tasks ----
+// Tasks are threads, but only one runs at a time (single cpu, switched only in
+// delay/yield/blocking calls). Clock moves when every task waits, jumping to the
+// earliest wake up, so simulated seconds take microseconds of real time.
+// Every clock read costs HAL_CLOCK_READ_COST us, busy waits on millis() end.
+#define HAL_CLOCK_READ_COST 1
+
+uint64_t halNow();                      // virtual us since boot
+void halAdvance(uint64_t us);           // busy time of current task (no switch)
+void halSleepUntil(uint64_t us);        // yields until virtual time
+void halSetRealtime(bool realtime);     // clock follows wall clock (interactive runs)
+void *halTaskCreate(const char *name, std::function<void()> fn, int core = 1, uint32_t stack = 8192);
+
+enum HalExitCode {
+  HAL_EXIT_OK = 0,         // time limit or runner decided
+  HAL_EXIT_RESTART = 2,    // ESP.restart() / esp_restart()
+  HAL_EXIT_DEEP_SLEEP = 3, // esp_deep_sleep_start()
+  HAL_EXIT_DEADLOCK = 4,   // every task waits forever
+};
+void halExit(int code, const char *reason) __attribute__((noreturn)); // ends simulation (flushes output, saves flash)
+void halOnExit(std::function<void(int code)> fn); // runs in halExit before output is flushed
+void halSetEfuseMac(uint64_t mac);                // station id (getEspId) is derived from it
+
+// ---- gpio ----
+void halGpioSet(uint8_t pin, int level); // drives input pin (buttons, wake line), runs interrupts
+int halGpioGet(uint8_t pin);             // last level written by station
+void halAnalogSet(uint8_t pin, uint32_t millivolts);
+
+// ---- uart ----
+// Received bytes become available at baud rate pace (like real line)
+// returns virtual time last injected byte arrives
+uint64_t halUartInject(int port, const uint8_t *data, size_t len);
+uint64_t halUartInject(int port, const std::string &data);
+std::string halUartTake(int port);       // bytes station wrote since last call
+void halUartEcho(int port, bool echo);   // print station output to stdout
+
+// ---- i2c lcd ----
+#define HAL_LCD_WRITE_US 250 // one character (two nibbles over 100 kHz i2c backpack)
+struct HalLcd {
+  uint8_t cols = 0, rows = 0;
+  std::vector<std::string> lines;
+  bool backlight = false;
+  uint32_t writes = 0; // characters sent over i2c
+};
+HalLcd &halLcd();
+
+// ---- 74hc595 chain (7 segment display) ----
+void halShiftAttach(uint8_t dataPin, uint8_t clockPin, uint8_t latchPin);
+struct HalShiftFrame {
+  uint64_t at;
+  std::vector<uint8_t> bytes; // first shifted byte first
+};
+std::vector<HalShiftFrame> halShiftTake(); // latched frames since last call
+
+// ---- rfid (mfrc522) ----
+#define HAL_RFID_ATQA_US 1000    // frame -> card answer (ATQA, uid part, SAK)
+#define HAL_RFID_TIMER_US 25000  // TimerIRq without card (RFID_REQUEST_TIMEOUT)
+#define HAL_RFID_SELECT_US 3000  // anticollision + select (PICC_ReadCardSerial)
+void halRfidPresent(const std::vector<uint8_t> &uid); // card in field (answers REQA until halted)
+void halRfidRemove();
+
+// ---- flash store (eeprom, nvs, partitions) ----
+#define HAL_FLASH_ERASE_US 45000 // sector erase (4 KB), cpu is stalled like on esp32
+#define HAL_FLASH_WRITE_US 20    // per 32 bytes written
+std::vector<uint8_t> &halFlashRegion(const std::string &name); // "eeprom", "nvs/<ns>/<key>", "part/<label>"
+bool halFlashLoad(const std::string &path);
+bool halFlashSave(const std::string &path);
+void halFlashAutosave(const std::string &path); // saved by halExit
+
+// ---- loopback websocket ----
+struct HalWsFrame {
+  bool binary = false;
+  std::string data;
+  uint64_t at = 0; // virtual time it arrives
+};
+void halWsListen(bool accept);          // server reachable (false also drops current connection)
+void halWsClose();                      // drops current connection
+void halWsSetLatency(uint32_t us);      // one way
+bool halWsConnected();
+uint32_t halWsConnections();            // accepted so far (changes on every new connection)
+std::string halWsPath();                // path + query station connected with
+void halWsSend(const std::string &data, bool binary = false); // server -> station
+bool halWsReceive(HalWsFrame &frame);   // station -> server (arrived ones only)
+
+// ---- network discovery ----
+#define HAL_WIFI_CONNECT_US 1500000     // scan + association + dhcp
+#define HAL_WIFI_FAST_CONNECT_US 300000 // known channel + bssid, no scan
+#define HAL_MDNS_QUERY_US 3000000       // esp32 MDNS.queryService waits whole timeout
+void halMdnsAdd(const char *service, const char *ip, uint16_t port, const char *wsUrl);
+void halWifiAvailable(bool available);
+
+// ---- host network ----
+// Websocket, tcp probe and dns use host sockets instead of loopback server, so
+// station talks to a real one (tools/test_server.py). Needs halSetRealtime(true).
+// WiFiUDP is always a host socket.
+void halNetReal(bool real);
+
+#endif
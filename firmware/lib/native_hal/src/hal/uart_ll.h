@@ -0,0 +1,11 @@
+#ifndef __HAL_UART_LL_H__
+#define __HAL_UART_LL_H__
+
+#include "driver/uart.h"
+
+// uart clock source has no meaning on host
+typedef struct { int port; } uart_dev_t;
+#define UART_LL_GET_HW(num) ((uart_dev_t *)(uintptr_t)((num) + 1))
+inline void uart_ll_set_sclk(uart_dev_t */*hw*/, uart_sclk_t /*source*/) {}
+
+#endif
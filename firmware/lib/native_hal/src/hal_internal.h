@@ -0,0 +1,25 @@
+#ifndef __HAL_INTERNAL_H__
+#define __HAL_INTERNAL_H__
+
+// Shared between hal translation units (not for station or runner)
+
+#include <stdint.h>
+#include <string>
+#include "hal.h"
+
+struct HalTask;
+
+uint64_t halClockRead();          // station clock read (millis, micros, esp_timer), costs HAL_CLOCK_READ_COST
+void halTaskWake(HalTask *task);  // makes sleeping task ready now
+HalTask *halStationTask(const char *name, std::function<void()> fn, int core, uint32_t stack);
+
+int halGpioLevel(uint8_t pin);    // level station would read
+void halSleepGpioChanged();       // wakes light sleep waiting for ext0 level
+
+bool halFlashExists(const std::string &name);
+void halFlashRemove(const std::string &name);
+void halFlashSaveOnExit();
+
+void halLog(const char *format, ...) __attribute__((format(printf, 1, 2))); // "[   1.234] ..." on stdout
+
+#endif
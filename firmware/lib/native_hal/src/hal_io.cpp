@@ -0,0 +1,584 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include <Wire.h>
+#include <LiquidCrystal_I2C.h>
+#include <MFRC522v2.h>
+#include <MFRC522DriverSPI.h>
+#include <driver/uart.h>
+#include <deque>
+#include <stdarg.h>
+#include "hal_internal.h"
+
+#define HAL_GPIO_COUNT 40
+
+void halLog(const char *format, ...) {
+  printf("[%4llu.%03llu] ", (unsigned long long)(halNow() / 1000000), (unsigned long long)(halNow() / 1000 % 1000));
+  va_list arg;
+  va_start(arg, format);
+  vprintf(format, arg);
+  va_end(arg);
+}
+
+// ---- gpio ----
+
+struct HalPin {
+  uint8_t mode = INPUT;
+  int out = LOW;     // written by station
+  int in = -1;       // driven by runner (-1 - floating, pull decides)
+  uint32_t millivolts = 0;
+  void (*isr)() = nullptr;
+  int isrMode = 0;
+};
+
+static HalPin pins[HAL_GPIO_COUNT];
+
+int halGpioLevel(uint8_t pin) {
+  if (pin >= HAL_GPIO_COUNT) return LOW;
+
+  HalPin &p = pins[pin];
+  if (p.mode == OUTPUT) return p.out;
+  if (p.in >= 0) return p.in;
+  return (p.mode & PULLUP) ? HIGH : LOW;
+}
+
+static void runIsr(HalPin &p, int before, int after) {
+  if (p.isr == nullptr || before == after) return;
+  bool rising = after == HIGH;
+  if (p.isrMode == CHANGE || (p.isrMode == RISING && rising) || (p.isrMode == FALLING && !rising)) p.isr();
+}
+
+void halGpioSet(uint8_t pin, int level) {
+  if (pin >= HAL_GPIO_COUNT) return;
+
+  int before = halGpioLevel(pin);
+  pins[pin].in = level;
+  runIsr(pins[pin], before, halGpioLevel(pin));
+  halSleepGpioChanged();
+}
+
+int halGpioGet(uint8_t pin) {
+  return pin < HAL_GPIO_COUNT ? pins[pin].out : LOW;
+}
+
+void halAnalogSet(uint8_t pin, uint32_t millivolts) {
+  if (pin < HAL_GPIO_COUNT) pins[pin].millivolts = millivolts;
+}
+
+static void shiftPinChanged(uint8_t pin, int level);
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin < HAL_GPIO_COUNT) pins[pin].mode = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin >= HAL_GPIO_COUNT) return;
+
+  int before = pins[pin].out;
+  pins[pin].out = val ? HIGH : LOW;
+  if (before != pins[pin].out) shiftPinChanged(pin, pins[pin].out);
+}
+
+int digitalRead(uint8_t pin) {
+  return halGpioLevel(pin);
+}
+
+uint32_t analogReadMilliVolts(uint8_t pin) {
+  halAdvance(40); // adc conversion
+  return pin < HAL_GPIO_COUNT ? pins[pin].millivolts : 0;
+}
+
+uint16_t analogRead(uint8_t pin) {
+  return min(analogReadMilliVolts(pin) * 4095 / 3300, (uint32_t)4095);
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) {
+  if (pin >= HAL_GPIO_COUNT) return;
+  pins[pin].isr = isr;
+  pins[pin].isrMode = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (pin < HAL_GPIO_COUNT) pins[pin].isr = nullptr;
+}
+
+// ---- 74hc595 chain ----
+
+static int shiftData = -1, shiftClock = -1, shiftLatch = -1;
+static std::vector<uint8_t> shiftBits;
+static std::vector<HalShiftFrame> shiftFrames;
+
+void halShiftAttach(uint8_t dataPin, uint8_t clockPin, uint8_t latchPin) {
+  shiftData = dataPin;
+  shiftClock = clockPin;
+  shiftLatch = latchPin;
+}
+
+static void shiftPinChanged(uint8_t pin, int level) {
+  if (level != HIGH) return;
+
+  if (pin == shiftClock) {
+    shiftBits.push_back(halGpioLevel(shiftData));
+  } else if (pin == shiftLatch && !shiftBits.empty()) {
+    // bytes assembled lsb first, as station shifts them (LSBFIRST)
+    HalShiftFrame frame;
+    frame.at = halNow();
+    for (size_t i = 0; i + 8 <= shiftBits.size(); i += 8) {
+      uint8_t b = 0;
+      for (int bit = 0; bit < 8; bit++) b |= shiftBits[i + bit] << bit;
+      frame.bytes.push_back(b);
+    }
+
+    shiftFrames.push_back(frame);
+    shiftBits.clear();
+  }
+}
+
+std::vector<HalShiftFrame> halShiftTake() {
+  std::vector<HalShiftFrame> frames;
+  frames.swap(shiftFrames);
+  return frames;
+}
+
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val) {
+  for (int i = 0; i < 8; i++) {
+    int bit = bitOrder == LSBFIRST ? (val >> i) & 1 : (val >> (7 - i)) & 1;
+    digitalWrite(dataPin, bit);
+    digitalWrite(clockPin, HIGH);
+    digitalWrite(clockPin, LOW);
+  }
+}
+
+// ---- uart ----
+
+#define HAL_UART_COUNT 3
+
+struct HalUart {
+  std::deque<std::pair<uint64_t, uint8_t>> rx; // arrival time, byte
+  uint64_t lastRxAt = 0;
+  std::string tx;
+  bool echo = false;
+  bool lineStart = true;
+  unsigned long baud = 115200;
+};
+
+static HalUart uarts[HAL_UART_COUNT];
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+
+uint64_t halUartInject(int port, const uint8_t *data, size_t len) {
+  HalUart &u = uarts[port];
+  uint64_t byteTime = 10 * 1000000ULL / u.baud; // 8N1
+
+  for (size_t i = 0; i < len; i++) {
+    u.lastRxAt = max(u.lastRxAt, halNow()) + byteTime;
+    u.rx.push_back({u.lastRxAt, data[i]});
+  }
+
+  return u.lastRxAt;
+}
+
+uint64_t halUartInject(int port, const std::string &data) {
+  return halUartInject(port, (const uint8_t *)data.data(), data.size());
+}
+
+std::string halUartTake(int port) {
+  std::string tx;
+  tx.swap(uarts[port].tx);
+  return tx;
+}
+
+void halUartEcho(int port, bool echo) {
+  uarts[port].echo = echo;
+}
+
+void HardwareSerial::begin(unsigned long baud, uint32_t /*config*/, int8_t /*rxPin*/, int8_t /*txPin*/, bool /*invert*/,
+                           unsigned long /*timeoutMs*/, uint8_t /*rxfifoFullThrhd*/) {
+  updateBaudRate(baud);
+}
+
+void HardwareSerial::updateBaudRate(unsigned long baud) {
+  this->baud = baud;
+  uarts[port].baud = baud;
+}
+
+int HardwareSerial::available() {
+  int n = 0;
+  for (auto &b : uarts[port].rx) {
+    if (b.first > halNow()) break;
+    n++;
+  }
+  return n;
+}
+
+int HardwareSerial::read() {
+  if (available() == 0) return -1;
+  uint8_t c = uarts[port].rx.front().second;
+  uarts[port].rx.pop_front();
+  return c;
+}
+
+int HardwareSerial::peek() {
+  return available() == 0 ? -1 : uarts[port].rx.front().second;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  HalUart &u = uarts[port];
+  u.tx.append((const char *)buffer, size);
+  if (u.tx.size() > 65536) u.tx.erase(0, u.tx.size() - 65536); // nobody takes it
+
+  if (u.echo) {
+    for (size_t i = 0; i < size; i++) {
+      if (u.lineStart) ::printf("[%4llu.%03llu] ", (unsigned long long)(halNow() / 1000000), (unsigned long long)(halNow() / 1000 % 1000));
+      if (buffer[i] != '\r') putchar(buffer[i]);
+      u.lineStart = buffer[i] == '\n';
+    }
+  }
+
+  return size;
+}
+
+esp_err_t uart_set_baudrate(uart_port_t port, uint32_t baud) {
+  if (port < HAL_UART_COUNT) uarts[port].baud = baud;
+  return ESP_OK;
+}
+
+// ---- i2c lcd ----
+
+static HalLcd lcdState;
+
+HalLcd &halLcd() {
+  return lcdState;
+}
+
+void LiquidCrystal_I2C::init() {
+  lcdState.cols = cols;
+  lcdState.rows = rows;
+  lcdState.lines.assign(rows, std::string(cols, ' '));
+  halAdvance(50000); // hd44780 power up + init sequence
+  col = row = 0;
+}
+
+void LiquidCrystal_I2C::clear() {
+  lcdState.lines.assign(rows, std::string(cols, ' '));
+  halAdvance(2000);
+  col = row = 0;
+}
+
+void LiquidCrystal_I2C::home() {
+  halAdvance(2000);
+  col = row = 0;
+}
+
+void LiquidCrystal_I2C::setCursor(uint8_t col, uint8_t row) {
+  halAdvance(HAL_LCD_WRITE_US);
+  this->col = col;
+  this->row = min(row, (uint8_t)(rows - 1));
+}
+
+void LiquidCrystal_I2C::backlight() {
+  lcdState.backlight = true;
+}
+
+void LiquidCrystal_I2C::noBacklight() {
+  lcdState.backlight = false;
+}
+
+size_t LiquidCrystal_I2C::write(uint8_t c) {
+  halAdvance(HAL_LCD_WRITE_US);
+  lcdState.writes++;
+  if (row < lcdState.lines.size() && col < cols) lcdState.lines[row][col] = c;
+  col++;
+  return 1;
+}
+
+TwoWire Wire;
+SPIClass SPI;
+
+// ---- rfid ----
+
+static struct {
+  bool present = false;
+  bool halted = false; // until removed from field
+  std::vector<uint8_t> uid;
+} card;
+
+void halRfidPresent(const std::vector<uint8_t> &uid) {
+  card.present = true;
+  card.halted = false;
+  card.uid = uid;
+}
+
+void halRfidRemove() {
+  card.present = false;
+  card.halted = false;
+}
+
+#define SPI_REGISTER_US 4 // one register access at 4 MHz
+
+bool MFRC522DriverSPI::init() {
+  memset(regs, 0, sizeof(regs));
+  regs[MFRC522Constants::VersionReg] = 0x92;
+  fifoLevel = fifoRead = 0;
+  answerLen = 0;
+  answerAt = timerAt = 0;
+  return true;
+}
+
+static uint16_t crcA(const uint8_t *data, uint8_t len) {
+  uint16_t crc = 0x6363;
+  for (uint8_t i = 0; i < len; i++) {
+    uint8_t b = data[i] ^ (uint8_t)crc;
+    b ^= b << 4;
+    crc = (crc >> 8) ^ ((uint16_t)b << 8) ^ ((uint16_t)b << 3) ^ (b >> 4);
+  }
+  return crc;
+}
+
+/// @brief Uid part (with cascade tag when more levels follow) + BCC of cascade level
+static bool cardUidPart(int level, uint8_t *out) {
+  int levels = card.uid.size() <= 4 ? 1 : card.uid.size() <= 7 ? 2 : 3;
+  if (level >= levels || card.uid.empty()) return false;
+
+  int offset = level * 3;
+  if (level < levels - 1) {
+    out[0] = MFRC522Constants::PICC_CMD_CT;
+    for (int i = 0; i < 3; i++) out[i + 1] = card.uid[offset + i];
+  } else {
+    for (int i = 0; i < 4; i++) out[i] = offset + i < (int)card.uid.size() ? card.uid[offset + i] : 0;
+  }
+
+  out[4] = out[0] ^ out[1] ^ out[2] ^ out[3];
+  return true;
+}
+
+void MFRC522DriverSPI::answerWith(const uint8_t *data, uint8_t len) {
+  memcpy(answer, data, len);
+  answerLen = len;
+  answerAt = halNow() + HAL_RFID_ATQA_US;
+}
+
+void MFRC522DriverSPI::transceive() {
+  uint8_t len = fifoLevel;
+  uint8_t frame[64];
+  memcpy(frame, fifo, len);
+  fifoLevel = fifoRead = 0;
+  regs[MFRC522Constants::ComIrqReg] |= 0x40; // TxIRq, frame is short
+  timerAt = halNow() + HAL_RFID_TIMER_US;    // TAuto, stopped by answer
+
+  bool field = card.present && (regs[MFRC522Constants::TxControlReg] & 0x03);
+  bool plain = (regs[MFRC522Constants::TxModeReg] & 0x80) == 0; // TxCRCEn garbles short frames
+  uint8_t cmd = len > 0 ? frame[0] : 0;
+  if (!field || len == 0) return;
+
+  if ((cmd == MFRC522Constants::PICC_CMD_REQA || cmd == MFRC522Constants::PICC_CMD_WUPA) && len == 1) {
+    if (!plain || (card.halted && cmd == MFRC522Constants::PICC_CMD_REQA)) return;
+    card.halted = false;
+    uint8_t atqa[2] = {(uint8_t)(card.uid.size() <= 4 ? 0x04 : 0x44), 0x00};
+    answerWith(atqa, 2);
+    return;
+  }
+
+  if (card.halted) return;
+
+  int level = cmd == MFRC522Constants::PICC_CMD_SEL_CL1 ? 0 : cmd == MFRC522Constants::PICC_CMD_SEL_CL2 ? 1
+            : cmd == MFRC522Constants::PICC_CMD_SEL_CL3 ? 2 : -1;
+  uint8_t part[5];
+  if (level >= 0 && len == 2 && frame[1] == 0x20 && cardUidPart(level, part)) {
+    answerWith(part, 5); // anticollision
+    return;
+  }
+
+  if (level >= 0 && len == 9 && frame[1] == 0x70 && cardUidPart(level, part) && memcmp(frame + 2, part, 5) == 0 &&
+      crcA(frame, 7) == (frame[7] | (frame[8] << 8))) {
+    uint8_t sak[3] = {(uint8_t)(cardUidPart(level + 1, part) ? 0x04 : 0x08), 0, 0}; // mifare classic 1k when complete
+    uint16_t crc = crcA(sak, 1);
+    sak[1] = crc & 0xFF;
+    sak[2] = crc >> 8;
+    answerWith(sak, 3);
+    return;
+  }
+
+  if (cmd == MFRC522Constants::PICC_CMD_HLTA && len == 4) card.halted = true; // no answer
+}
+
+void MFRC522DriverSPI::PCD_WriteRegister(PCD_Register reg, uint8_t value) {
+  halAdvance(SPI_REGISTER_US);
+
+  switch (reg) {
+    case MFRC522Constants::ComIrqReg:
+      // bit 7 - set (1) or clear (0) marked bits
+      if (value & 0x80) regs[reg] |= value & 0x7F;
+      else regs[reg] &= ~value;
+      return;
+
+    case MFRC522Constants::FIFOLevelReg:
+      if (value & 0x80) fifoLevel = fifoRead = 0;
+      return;
+
+    case MFRC522Constants::FIFODataReg:
+      if (fifoLevel < sizeof(fifo)) fifo[fifoLevel++] = value;
+      return;
+
+    case MFRC522Constants::CommandReg:
+      regs[reg] = value;
+      if ((value & 0x0F) == MFRC522Constants::PCD_SoftReset) init();
+      if ((value & 0x0F) == MFRC522Constants::PCD_Idle) answerAt = timerAt = 0;
+      return;
+
+    case MFRC522Constants::BitFramingReg:
+      regs[reg] = value & 0x7F;
+      if ((value & 0x80) && (regs[MFRC522Constants::CommandReg] & 0x0F) == MFRC522Constants::PCD_Transceive) transceive();
+      return;
+
+    default:
+      if (reg < sizeof(regs)) regs[reg] = value;
+  }
+}
+
+void MFRC522DriverSPI::PCD_WriteRegister(PCD_Register reg, uint8_t count, uint8_t *values) {
+  for (uint8_t i = 0; i < count; i++) PCD_WriteRegister(reg, values[i]);
+}
+
+uint8_t MFRC522DriverSPI::PCD_ReadRegister(PCD_Register reg) {
+  halAdvance(SPI_REGISTER_US);
+
+  if (reg == MFRC522Constants::ComIrqReg) {
+    if (answerAt != 0 && halNow() >= answerAt) {
+      memcpy(fifo, answer, answerLen);
+      fifoLevel = answerLen;
+      fifoRead = 0;
+      answerAt = timerAt = 0;
+      regs[reg] |= 0x30; // RxIRq + IdleIRq
+    }
+    if (timerAt != 0 && halNow() >= timerAt) regs[reg] |= 0x01; // TimerIRq
+  } else if (reg == MFRC522Constants::FIFOLevelReg) {
+    return fifoLevel - fifoRead;
+  } else if (reg == MFRC522Constants::FIFODataReg) {
+    return fifoRead < fifoLevel ? fifo[fifoRead++] : 0;
+  }
+
+  return reg < sizeof(regs) ? regs[reg] : 0;
+}
+
+void MFRC522DriverSPI::PCD_ReadRegister(PCD_Register reg, uint8_t count, uint8_t *values, uint8_t /*rxAlign*/) {
+  for (uint8_t i = 0; i < count; i++) values[i] = PCD_ReadRegister(reg);
+}
+
+bool MFRC522::PCD_Init() {
+  driver.init();
+  driver.PCD_WriteRegister(MFRC522Constants::CommandReg, MFRC522Constants::PCD_SoftReset);
+  delay(50); // oscillator start up
+  PCD_AntennaOn();
+  return true;
+}
+
+void MFRC522::PCD_AntennaOn() {
+  uint8_t value = driver.PCD_ReadRegister(MFRC522Constants::TxControlReg);
+  if ((value & 0x03) != 0x03) driver.PCD_WriteRegister(MFRC522Constants::TxControlReg, value | 0x03);
+}
+
+void MFRC522::PCD_AntennaOff() {
+  uint8_t value = driver.PCD_ReadRegister(MFRC522Constants::TxControlReg);
+  driver.PCD_WriteRegister(MFRC522Constants::TxControlReg, value & ~0x03);
+}
+
+void MFRC522::PCD_SoftPowerDown() {
+  uint8_t value = driver.PCD_ReadRegister(MFRC522Constants::CommandReg);
+  driver.PCD_WriteRegister(MFRC522Constants::CommandReg, value | 0x10);
+}
+
+void MFRC522::PCD_SoftPowerUp() {
+  uint8_t value = driver.PCD_ReadRegister(MFRC522Constants::CommandReg);
+  driver.PCD_WriteRegister(MFRC522Constants::CommandReg, value & ~0x10);
+  delay(1);
+}
+
+bool MFRC522::PICC_IsNewCardPresent() {
+  halAdvance(HAL_RFID_ATQA_US);
+  return card.present && !card.halted;
+}
+
+bool MFRC522::PICC_ReadCardSerial() {
+  halAdvance(HAL_RFID_SELECT_US);
+  if (!card.present || card.uid.empty()) return false;
+
+  uid.size = min(card.uid.size(), sizeof(uid.uidByte));
+  memcpy(uid.uidByte, card.uid.data(), uid.size);
+  uid.sak = 0x08; // mifare classic 1k
+  return true;
+}
+
+MFRC522::StatusCode MFRC522::PICC_HaltA() {
+  halAdvance(1000);
+  card.halted = true;
+  return MFRC522Constants::STATUS_OK;
+}
+
+// ---- chip ----
+
+static uint64_t efuseMac = 0x0000A1B2C3D4E5F6ULL;
+
+void halSetEfuseMac(uint64_t mac) {
+  efuseMac = mac;
+}
+
+EspClass ESP;
+
+uint64_t EspClass::getEfuseMac() {
+  return efuseMac;
+}
+
+uint32_t EspClass::getFreeHeap() {
+  return 180000;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+  return 150000;
+}
+
+uint32_t EspClass::getMaxAllocHeap() {
+  return 110000;
+}
+
+uint32_t EspClass::getCpuFreqMHz() {
+  return getCpuFrequencyMhz();
+}
+
+void EspClass::restart() {
+  esp_restart();
+}
+
+static uint32_t cpuFrequency = 80; // board_build.f_cpu
+
+uint32_t getCpuFrequencyMhz() {
+  return cpuFrequency;
+}
+
+bool setCpuFrequencyMhz(uint32_t mhz) {
+  cpuFrequency = mhz;
+  return true;
+}
+
+static uint32_t randomState = 1;
+
+long random(long max) {
+  // xorshift, runs are reproducible (esp32 uses hardware rng)
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return max <= 0 ? 0 : randomState % max;
+}
+
+long random(long min, long max) {
+  return min >= max ? min : min + random(max - min);
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) randomState = seed;
+}
+
+void configTime(long /*gmtOffsetSec*/, int /*daylightOffsetSec*/, const char */*server1*/, const char */*server2*/, const char */*server3*/) {
+  // no sntp, station clock is synced over websocket (clock.hpp)
+}
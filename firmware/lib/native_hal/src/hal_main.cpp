@@ -0,0 +1,400 @@
+// Runner for `pio run -e native -t exec`: station setup()/loop() on the hal with
+// loopback server (like tools/test_server.py), stackmat emulator and scripted
+// cards/buttons. Tests and benchmarks link their own main, so this file stays out.
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_partition.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "hal.h"
+#include "hal_internal.h"
+#include "pins.h"
+#include "defines.h"
+
+#define SIM_EPOCH 1767225600ULL // 2026-01-01, server clock at boot (runs are reproducible)
+#define SIM_SERVER_PORT 8080
+#define SIM_POLL_US 1000
+
+struct SimEvent {
+  uint64_t at;      // us
+  uint64_t length;  // us (solve time, card in field, button held)
+  std::string arg;
+};
+
+static struct {
+  uint64_t seconds = 60;
+  bool realtime = false;
+  bool quiet = false;
+  bool server = true;
+  bool timer = true;
+  uint32_t latency = 1000;
+  std::string serverUrl; // real server instead of loopback one
+  std::string flash;
+  std::string partitions = "partitions.csv";
+  std::vector<SimEvent> solves, cards, presses;
+} opts;
+
+static uint64_t epochMs() {
+  return SIM_EPOCH * 1000 + halNow() / 1000;
+}
+
+static void usage(const char *name) {
+  printf("usage: %s [options]\n"
+         "  --seconds N        simulated time limit (default 60)\n"
+         "  --realtime         virtual clock follows wall clock\n"
+         "  --quiet            don't print station serial and websocket traffic\n"
+         "  --flash FILE       load flash (eeprom, nvs, partitions) from FILE and save it on exit\n"
+         "  --partitions FILE  partition table (default partitions.csv)\n"
+         "  --latency US       one way websocket latency (default 1000)\n"
+         "  --mac HEX          efuse mac (station id)\n"
+         "  --no-server        nothing advertised or listening\n"
+         "  --server URL       advertise real server (ws://127.0.0.1:8080/, tools/test_server.py),\n"
+         "                     station uses host sockets and clock follows wall clock\n"
+         "  --no-timer         stackmat unplugged\n"
+         "  --solve MS@S       timer runs for MS ms, started S seconds after boot\n"
+         "  --card UID@S       card with hex UID in field at S seconds (for 1 s)\n"
+         "  --press PIN@S[:MS] button on PIN held at S seconds for MS ms (default 100)\n",
+         name);
+}
+
+static bool parseEvent(const char *arg, bool hexArg, std::vector<SimEvent> &out, uint64_t defaultLength) {
+  const char *at = strchr(arg, '@');
+  if (at == NULL) return false;
+
+  SimEvent e;
+  e.arg = std::string(arg, at - arg);
+  e.at = (uint64_t)(atof(at + 1) * 1000000);
+  e.length = defaultLength;
+
+  const char *len = strchr(at, ':');
+  if (len != NULL) e.length = strtoull(len + 1, NULL, 10) * 1000;
+  if (!hexArg && defaultLength == 0) e.length = strtoull(e.arg.c_str(), NULL, 10) * 1000; // solve time
+
+  out.push_back(e);
+  return true;
+}
+
+static bool parseArgs(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    bool hasValue = i + 1 < argc;
+
+    if (a == "--seconds" && hasValue) opts.seconds = strtoull(argv[++i], NULL, 10);
+    else if (a == "--realtime") opts.realtime = true;
+    else if (a == "--quiet") opts.quiet = true;
+    else if (a == "--flash" && hasValue) opts.flash = argv[++i];
+    else if (a == "--partitions" && hasValue) opts.partitions = argv[++i];
+    else if (a == "--latency" && hasValue) opts.latency = strtoul(argv[++i], NULL, 10);
+    else if (a == "--mac" && hasValue) halSetEfuseMac(strtoull(argv[++i], NULL, 16));
+    else if (a == "--no-server") opts.server = false;
+    else if (a == "--server" && hasValue) opts.serverUrl = argv[++i];
+    else if (a == "--no-timer") opts.timer = false;
+    else if (a == "--solve" && hasValue && parseEvent(argv[++i], false, opts.solves, 0)) continue;
+    else if (a == "--card" && hasValue && parseEvent(argv[++i], true, opts.cards, 1000000)) continue;
+    else if (a == "--press" && hasValue && parseEvent(argv[++i], false, opts.presses, 100000)) continue;
+    else {
+      usage(argv[0]);
+      return false;
+    }
+  }
+
+  auto byTime = [](const SimEvent &a, const SimEvent &b) { return a.at < b.at; };
+  std::sort(opts.solves.begin(), opts.solves.end(), byTime);
+  return true;
+}
+
+// ---- partitions ----
+
+static uint8_t partitionSubtype(const std::string &s) {
+  if (s == "nvs") return ESP_PARTITION_SUBTYPE_DATA_NVS;
+  if (s == "ota") return ESP_PARTITION_SUBTYPE_DATA_OTA;
+  if (s == "coredump") return ESP_PARTITION_SUBTYPE_DATA_COREDUMP;
+  if (s == "spiffs") return ESP_PARTITION_SUBTYPE_DATA_SPIFFS;
+  return strtoul(s.c_str(), NULL, 0);
+}
+
+/// @brief Data partitions of partitions.csv (app slots are only used by Update)
+static void loadPartitions(const std::string &path) {
+  FILE *f = fopen(path.c_str(), "r");
+  if (f == NULL) {
+    halPartitionAdd("history", ESP_PARTITION_TYPE_DATA, 0x40, 0x3D0000, 0x20000);
+    return;
+  }
+
+  char line[256];
+  while (fgets(line, sizeof(line), f) != NULL) {
+    if (line[0] == '#') continue;
+
+    std::vector<std::string> cols;
+    std::string col;
+    for (char *c = line; *c != '\0' && *c != '\n'; c++) {
+      if (*c == ',') {
+        cols.push_back(col);
+        col.clear();
+      } else if (*c != ' ' && *c != '\t') {
+        col += *c;
+      }
+    }
+    cols.push_back(col);
+
+    if (cols.size() < 5 || cols[1] != "data") continue;
+    halPartitionAdd(cols[0].c_str(), ESP_PARTITION_TYPE_DATA, partitionSubtype(cols[2]), strtoul(cols[3].c_str(), NULL, 0),
+                    strtoul(cols[4].c_str(), NULL, 0));
+  }
+
+  fclose(f);
+}
+
+// ---- loopback server (tools/test_server.py) ----
+
+static void serverSend(JsonDocument &doc) {
+  String out;
+  serializeJson(doc, out);
+  halWsSend(out.c_str());
+}
+
+static void serverOnConnected(unsigned long espId) {
+  JsonDocument epoch;
+  epoch["epoch_time"]["current_epoch"] = epochMs() / 1000;
+  serverSend(epoch);
+
+  JsonDocument settings;
+  settings["device_settings"]["esp_id"] = espId;
+  settings["device_settings"]["use_inspection"] = true;
+  settings["device_settings"]["added"] = true;
+  serverSend(settings);
+}
+
+static void serverHandle(const HalWsFrame &frame, unsigned long espId) {
+  if (frame.binary) {
+    if (!opts.quiet) halLog("server: binary frame (%u bytes)\n", (unsigned)frame.data.size());
+    return;
+  }
+
+  JsonDocument doc;
+  if (deserializeJson(doc, frame.data.c_str(), frame.data.size())) {
+    halLog("server: invalid frame: %s\n", frame.data.c_str());
+    return;
+  }
+
+  JsonDocument response;
+  if (doc.containsKey("time_sync")) {
+    response["time_sync"]["esp_id"] = espId;
+    response["time_sync"]["t0"] = doc["time_sync"]["t0"];
+    response["time_sync"]["t1"] = epochMs();
+    response["time_sync"]["t2"] = epochMs();
+  } else if (doc.containsKey("card_info_request")) {
+    uint64_t cardId = doc["card_info_request"]["card_id"];
+    JsonObject r = response["card_info_response"].to<JsonObject>();
+    r["card_id"] = cardId;
+    r["esp_id"] = espId;
+    r["request_id"] = doc["card_info_request"]["request_id"] | 0;
+    r["display"] = String("Test ") + (unsigned long)(cardId % 1000);
+    r["country_iso2"] = "PL";
+    r["can_compete"] = true;
+  } else if (doc.containsKey("solve")) {
+    JsonObject r = response["solve_confirm"].to<JsonObject>();
+    r["esp_id"] = espId;
+    r["request_id"] = doc["solve"]["request_id"] | 0;
+    r["competitor_id"] = doc["solve"]["competitor_id"];
+    r["session_id"] = doc["solve"]["session_id"];
+    halLog("server: solve %d ms (+%d), competitor %llu\n", doc["solve"]["solve_time"] | 0, doc["solve"]["penalty"] | 0,
+           (unsigned long long)(doc["solve"]["competitor_id"] | 0ULL));
+  } else if (doc.containsKey("logs")) {
+    return; // same records as serial echo
+  }
+
+  if (!opts.quiet) halLog("server: < %.200s\n", frame.data.c_str());
+  if (!response.isNull()) serverSend(response);
+}
+
+static void serverTask() {
+  uint32_t connection = 0;
+  unsigned long espId = 0;
+
+  while (true) {
+    if (halWsConnected() && halWsConnections() != connection) {
+      connection = halWsConnections();
+      std::string path = halWsPath();
+      size_t id = path.find("id=");
+      espId = id == std::string::npos ? 0 : strtoul(path.c_str() + id + 3, NULL, 10);
+
+      halLog("server: connected %s\n", path.c_str());
+      serverOnConnected(espId);
+    }
+
+    HalWsFrame frame;
+    while (halWsReceive(frame)) serverHandle(frame, espId);
+    halSleepUntil(halNow() + SIM_POLL_US);
+  }
+}
+
+// ---- stackmat ----
+
+/// @brief Frame timer sends at given time: [state][M][SS][mmm][64 + sum of digits]\n\r
+static std::string stackmatFrame(uint64_t at) {
+  char state = 'I';
+  uint64_t ms = 0;
+  for (const SimEvent &s : opts.solves) {
+    if (at + 1000000 < s.at) break;
+    if (at < s.at) {
+      state = 'I'; // reset a second before start
+      ms = 0;
+      break;
+    }
+    if (at < s.at + s.length) {
+      state = ' ';
+      ms = (at - s.at) / 1000;
+      break;
+    }
+    state = 'S';
+    ms = s.length / 1000;
+  }
+
+  char digits[8];
+  snprintf(digits, sizeof(digits), "%01u%02u%03u", (unsigned)min(ms / 60000, (uint64_t)9), (unsigned)(ms / 1000 % 60),
+           (unsigned)(ms % 1000));
+
+  int sum = 64;
+  for (int i = 0; i < 6; i++) sum += digits[i] - '0';
+  return std::string(1, state) + digits + (char)sum + "\n\r";
+}
+
+static void stackmatTask() {
+  while (true) {
+    halSleepUntil(halUartInject(1, stackmatFrame(halNow()))); // line is never idle
+  }
+}
+
+// ---- scripted input ----
+
+struct SimAction {
+  uint64_t at;
+  std::function<void()> run;
+};
+
+static std::vector<uint8_t> parseUid(const std::string &hex) {
+  std::vector<uint8_t> uid;
+  for (size_t i = 0; i + 1 < hex.size() && uid.size() < 10; i += 2) uid.push_back(strtoul(hex.substr(i, 2).c_str(), NULL, 16));
+  return uid;
+}
+
+static void inputTask() {
+  std::vector<SimAction> actions;
+  for (const SimEvent &c : opts.cards) {
+    std::vector<uint8_t> uid = parseUid(c.arg);
+    actions.push_back({c.at, [uid, c] { halLog("sim: card %s\n", c.arg.c_str()); halRfidPresent(uid); }});
+    actions.push_back({c.at + c.length, [] { halRfidRemove(); }});
+  }
+  for (const SimEvent &p : opts.presses) {
+    uint8_t pin = atoi(p.arg.c_str());
+    actions.push_back({p.at, [pin] { halLog("sim: press %u\n", pin); halGpioSet(pin, LOW); }});
+    actions.push_back({p.at + p.length, [pin] { halGpioSet(pin, HIGH); }});
+  }
+
+  std::stable_sort(actions.begin(), actions.end(), [](const SimAction &a, const SimAction &b) { return a.at < b.at; });
+  for (SimAction &a : actions) {
+    halSleepUntil(a.at);
+    a.run();
+  }
+}
+
+// ---- monitor ----
+
+static int decodeDigit(uint8_t segments) {
+  static const uint8_t digits[10] = {215, 132, 203, 206, 156, 94, 95, 196, 223, 222}; // utils.hpp decDigits
+  for (int i = 0; i < 10; i++) {
+    if (digits[i] == segments) return i;
+  }
+  return -1;
+}
+
+/// @brief Text on 7 segment display (bytes are inverted, bit 5 is dot)
+static std::string decodeDisplay(const std::vector<uint8_t> &bytes) {
+  std::string text;
+  for (uint8_t b : bytes) {
+    uint8_t segments = ~b;
+    int digit = decodeDigit(segments & ~32);
+    text += segments == 0 ? ' ' : digit < 0 ? '?' : '0' + digit;
+    if (segments & 32) text += '.';
+  }
+  return text;
+}
+
+static void monitorTask() {
+  std::vector<std::string> lcdLines;
+  bool backlight = false;
+  std::string display;
+
+  while (true) {
+    HalLcd &lcd = halLcd();
+    if (lcd.lines != lcdLines || lcd.backlight != backlight) {
+      lcdLines = lcd.lines;
+      backlight = lcd.backlight;
+
+      std::string text;
+      for (auto &line : lcdLines) text += "|" + line;
+      halLog("lcd %s| %s\n", text.c_str(), backlight ? "" : "(backlight off)");
+    }
+
+    std::vector<HalShiftFrame> frames = halShiftTake();
+    if (!frames.empty() && decodeDisplay(frames.back().bytes) != display) {
+      display = decodeDisplay(frames.back().bytes);
+      halLog("7seg [%s]\n", display.c_str());
+    }
+
+    halSleepUntil(halNow() + 10 * SIM_POLL_US);
+  }
+}
+
+int main(int argc, char **argv) {
+  if (!parseArgs(argc, argv)) return 1;
+
+  if (!opts.serverUrl.empty()) {
+    // ws://host:port/path
+    char host[64] = "127.0.0.1";
+    unsigned port = 80;
+    sscanf(opts.serverUrl.c_str(), "ws://%63[^:/]:%u", host, &port);
+
+    opts.realtime = true;
+    opts.server = false;
+    halNetReal(true);
+    halMdnsAdd("stackmat", host, port, opts.serverUrl.c_str());
+  }
+
+  halSetRealtime(opts.realtime);
+  if (!opts.flash.empty()) {
+    halFlashLoad(opts.flash);
+    halFlashAutosave(opts.flash);
+  }
+  loadPartitions(opts.partitions);
+
+  halShiftAttach(DIS_DS, DIS_SHCP, DIS_STCP);
+  halAnalogSet(BAT_ADC, 1950); // 3.9 V behind 1:2 divider
+  halUartEcho(0, !opts.quiet);
+  halWsSetLatency(opts.latency);
+
+  if (opts.server) {
+    char url[64];
+    snprintf(url, sizeof(url), "ws://127.0.0.1:%d/", SIM_SERVER_PORT);
+    halMdnsAdd("stackmat", "127.0.0.1", SIM_SERVER_PORT, url);
+    halWsListen(true);
+    halTaskCreate("server", serverTask);
+  }
+
+  if (opts.timer) halTaskCreate("stackmat", stackmatTask);
+  halTaskCreate("input", inputTask);
+  halTaskCreate("monitor", monitorTask);
+  halTaskCreate("limit", [] {
+    halSleepUntil(opts.seconds * 1000000);
+    halExit(HAL_EXIT_OK, "time limit");
+  });
+
+  setup();
+  while (true) {
+    loop();
+    yield();
+  }
+}
@@ -0,0 +1,645 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiManager.h>
+#include <ESPmDNS.h>
+#include <WebSocketsClient.h>
+#include <WiFiUdp.h>
+#include <base64.h>
+#include <deque>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "hal_internal.h"
+
+static bool netReal = false;
+
+void halNetReal(bool real) {
+  netReal = real;
+}
+
+// ---- host sockets ----
+
+static bool sockResolve(const char *host, uint16_t port, sockaddr_in &addr) {
+  addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  addrinfo *res = NULL;
+  if (getaddrinfo(host, NULL, &hints, &res) != 0 || res == NULL) return false;
+
+  addr = *(sockaddr_in *)res->ai_addr;
+  addr.sin_port = htons(port);
+  freeaddrinfo(res);
+  return true;
+}
+
+static sockaddr_in sockAddr(IPAddress ip, uint16_t port) {
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = (uint32_t)ip; // same byte order (first octet first)
+  addr.sin_port = htons(port);
+  return addr;
+}
+
+static void sockNonBlocking(int sock) {
+  fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+}
+
+static bool sockWait(int sock, short events, int timeoutMs) {
+  pollfd p = {sock, events, 0};
+  return poll(&p, 1, timeoutMs) > 0 && (p.revents & events);
+}
+
+/// @brief Blocking tcp connect (with timeout), socket is non blocking afterwards
+static int sockConnect(const char *host, uint16_t port, int timeoutMs) {
+  sockaddr_in addr;
+  if (!sockResolve(host, port, addr)) return -1;
+
+  int sock = socket(AF_INET, SOCK_STREAM, 0);
+  if (sock < 0) return -1;
+  sockNonBlocking(sock);
+
+  int err = 0;
+  socklen_t errLen = sizeof(err);
+  if (connect(sock, (sockaddr *)&addr, sizeof(addr)) != 0 &&
+      (errno != EINPROGRESS || !sockWait(sock, POLLOUT, timeoutMs) ||
+       getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &errLen) != 0 || err != 0)) {
+    close(sock);
+    return -1;
+  }
+
+  int one = 1;
+  setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  return sock;
+}
+
+static bool sockSendAll(int sock, const uint8_t *data, size_t len) {
+  while (len > 0) {
+    ssize_t n = send(sock, data, len, MSG_NOSIGNAL);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && sockWait(sock, POLLOUT, 1000)) continue;
+    if (n <= 0) return false;
+
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+// ---- wifi ----
+
+static bool wifiAvailable = true;
+static uint8_t wifiBssid[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+static const int32_t wifiChannel = 6;
+
+WiFiClass WiFi;
+
+void halWifiAvailable(bool available) {
+  wifiAvailable = available;
+}
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase, int32_t channel, const uint8_t *bssid, bool connect) {
+  this->ssid = ssid != NULL ? ssid : "";
+  pass = passphrase != NULL ? passphrase : "";
+  started = connect;
+
+  bool fast = channel == wifiChannel && bssid != NULL && memcmp(bssid, wifiBssid, sizeof(wifiBssid)) == 0;
+  connectedAt = halNow() + (fast ? HAL_WIFI_FAST_CONNECT_US : HAL_WIFI_CONNECT_US);
+  return status();
+}
+
+bool WiFiClass::reconnect() {
+  started = true;
+  connectedAt = halNow() + HAL_WIFI_CONNECT_US;
+  return true;
+}
+
+bool WiFiClass::disconnect(bool /*wifiOff*/, bool eraseAp) {
+  started = false;
+  if (eraseAp) ssid = pass = "";
+  return true;
+}
+
+wl_status_t WiFiClass::status() {
+  if (!started) return WL_DISCONNECTED;
+  if (!wifiAvailable) return WL_NO_SSID_AVAIL;
+  return halNow() >= connectedAt ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+uint8_t *WiFiClass::BSSID() {
+  return wifiBssid;
+}
+
+String WiFiClass::BSSIDstr() {
+  char buf[18];
+  snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", wifiBssid[0], wifiBssid[1], wifiBssid[2], wifiBssid[3],
+           wifiBssid[4], wifiBssid[5]);
+  return buf;
+}
+
+int32_t WiFiClass::channel() {
+  return isConnected() ? wifiChannel : 0;
+}
+
+String WiFiClass::macAddress() {
+  uint64_t mac = ESP.getEfuseMac();
+  char buf[18];
+  snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", (uint8_t)mac, (uint8_t)(mac >> 8), (uint8_t)(mac >> 16),
+           (uint8_t)(mac >> 24), (uint8_t)(mac >> 32), (uint8_t)(mac >> 40));
+  return buf;
+}
+
+// Everything resolves to loopback (server lives in this process), host dns with halNetReal
+int WiFiClass::hostByName(const char *host, IPAddress &result) {
+  if (!isConnected()) return 0;
+  if (result.fromString(host)) return 1;
+  if (!netReal) {
+    result = IPAddress(127, 0, 0, 1);
+    return 1;
+  }
+
+  sockaddr_in addr;
+  if (!sockResolve(host, 0, addr)) return 0;
+  result = IPAddress((uint32_t)addr.sin_addr.s_addr);
+  return 1;
+}
+
+bool WiFiManager::autoConnect(const char */*apName*/, const char */*apPassword*/) {
+  if (!WiFi.isConnected()) {
+    if (WiFi.SSID().length() == 0) WiFi.begin("fkm-sim", "fkm-sim-password");
+    else WiFi.begin();
+
+    uint64_t deadline = halNow() + (uint64_t)connectTimeout * 1000000;
+    while (!WiFi.isConnected() && halNow() < deadline) delay(10);
+  }
+
+  return WiFi.isConnected();
+}
+
+// ---- loopback websocket (server side) ----
+
+static bool wsListening = false;
+static bool wsOpen = false;
+static uint32_t wsConnection = 0;
+static uint32_t wsLatency = 1000; // us, one way
+static std::string wsPathQuery;
+static std::deque<HalWsFrame> toStation, toServer;
+
+struct HalWsPong {
+  uint64_t at;
+  std::string payload;
+};
+static std::deque<HalWsPong> pongs;
+
+static void wsQueue(std::deque<HalWsFrame> &queue, const std::string &data, bool binary) {
+  HalWsFrame frame;
+  frame.binary = binary;
+  frame.data = data;
+  frame.at = halNow() + wsLatency;
+  if (!queue.empty()) frame.at = max(frame.at, queue.back().at); // tcp keeps order
+  queue.push_back(frame);
+}
+
+void halWsListen(bool accept) {
+  wsListening = accept;
+  if (!accept) wsOpen = false;
+}
+
+void halWsClose() {
+  wsOpen = false;
+}
+
+void halWsSetLatency(uint32_t us) {
+  wsLatency = us;
+}
+
+bool halWsConnected() {
+  return wsOpen;
+}
+
+uint32_t halWsConnections() {
+  return wsConnection;
+}
+
+std::string halWsPath() {
+  return wsPathQuery;
+}
+
+void halWsSend(const std::string &data, bool binary) {
+  if (wsOpen) wsQueue(toStation, data, binary);
+}
+
+bool halWsReceive(HalWsFrame &frame) {
+  if (toServer.empty() || toServer.front().at > halNow()) return false;
+
+  frame = toServer.front();
+  toServer.pop_front();
+  return true;
+}
+
+// ---- websocket client ----
+
+void WebSocketsClient::begin(const char *host, uint16_t port, const char *url, const char */*protocol*/) {
+  this->host = host;
+  this->port = port;
+  this->url = url;
+  started = true;
+  attempted = false;
+}
+
+void WebSocketsClient::loop() {
+  if (!started) return;
+  if (netReal) {
+    realLoop();
+    return;
+  }
+
+  if (connected) {
+    if (connection != wsConnection || !wsOpen || !WiFi.isConnected()) {
+      if (connection == wsConnection) wsOpen = false;
+      connected = false;
+      lastAttempt = millis();
+      runEvent(WStype_DISCONNECTED, NULL, 0);
+      return;
+    }
+
+    while (connected && !toStation.empty() && toStation.front().at <= halNow()) {
+      HalWsFrame frame = toStation.front();
+      toStation.pop_front();
+      runEvent(frame.binary ? WStype_BIN : WStype_TEXT, (uint8_t *)&frame.data[0], frame.data.size());
+    }
+
+    while (connected && !pongs.empty() && pongs.front().at <= halNow()) {
+      HalWsPong pong = pongs.front();
+      pongs.pop_front();
+      runEvent(WStype_PONG, (uint8_t *)&pong.payload[0], pong.payload.size());
+    }
+    return;
+  }
+
+  if (connection != 0 && connection == wsConnection && wsOpen) {
+    // tcp is up, waiting for http upgrade response (one rtt)
+    if (halNow() < upgradeAt) return;
+
+    connected = true;
+    runEvent(WStype_CONNECTED, (uint8_t *)url.c_str(), url.length());
+    return;
+  }
+
+  if (attempted && millis() - lastAttempt < reconnectInterval) return;
+  attempted = true;
+
+  // tcp connect blocks the caller for one rtt (refused one as well)
+  halSleepUntil(halNow() + 2 * wsLatency);
+  lastAttempt = millis();
+  if (!WiFi.isConnected() || !wsListening) return;
+
+  connection = ++wsConnection;
+  wsOpen = true;
+  wsPathQuery = url.c_str();
+  toStation.clear();
+  toServer.clear();
+  pongs.clear();
+  upgradeAt = halNow() + 2 * wsLatency;
+}
+
+bool WebSocketsClient::sendTXT(uint8_t *payload, size_t length, bool /*headerToPayload*/) {
+  if (!connected) return false;
+  if (length == 0) length = strlen((const char *)payload);
+  if (netReal) return realSend(0x1, payload, length);
+
+  wsQueue(toServer, std::string((const char *)payload, length), false);
+  return true;
+}
+
+bool WebSocketsClient::sendBIN(uint8_t *payload, size_t length, bool /*headerToPayload*/) {
+  if (!connected) return false;
+  if (netReal) return realSend(0x2, payload, length);
+
+  wsQueue(toServer, std::string((const char *)payload, length), true);
+  return true;
+}
+
+bool WebSocketsClient::sendPing(uint8_t *payload, size_t length) {
+  if (!connected) return false;
+  if (netReal) return realSend(0x9, payload, payload != NULL ? length : 0);
+
+  pongs.push_back({halNow() + 2 * wsLatency, std::string((const char *)payload, payload != NULL ? length : 0)});
+  return true;
+}
+
+void WebSocketsClient::disconnect() {
+  realClose();
+  if (connection == wsConnection) wsOpen = false;
+  connection = 0;
+  if (!connected) return;
+
+  connected = false;
+  lastAttempt = millis();
+  runEvent(WStype_DISCONNECTED, NULL, 0);
+}
+
+// ---- websocket client over host socket (halNetReal) ----
+
+#define WS_REAL_TIMEOUT 5000 // ms, tcp connect and http upgrade
+
+/// @brief Tcp connect and upgrade request, blocking like the real library
+bool WebSocketsClient::realConnect() {
+  sock = sockConnect(host.c_str(), port, WS_REAL_TIMEOUT);
+  if (sock < 0) return false;
+
+  uint8_t key[16];
+  for (int i = 0; i < 16; i++) key[i] = rand();
+  String request = String("GET ") + url + " HTTP/1.1\r\nHost: " + host + ":" + port +
+                   "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: " + base64::encode(key, sizeof(key)) +
+                   "\r\nSec-WebSocket-Version: 13\r\n\r\n";
+
+  inbox.clear();
+  fragments.clear();
+  upgrading = true;
+  upgradeAt = halNow() + WS_REAL_TIMEOUT * 1000ULL;
+  return sockSendAll(sock, (const uint8_t *)request.c_str(), request.length());
+}
+
+/// @brief Polls http upgrade response, closes socket if it failed
+bool WebSocketsClient::realUpgraded() {
+  char buf[512];
+  ssize_t n;
+  while ((n = recv(sock, buf, sizeof(buf), MSG_DONTWAIT)) > 0) inbox.append(buf, n);
+
+  size_t end = inbox.find("\r\n\r\n");
+  if (end == std::string::npos) {
+    if ((n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) || halNow() > upgradeAt || inbox.size() > 8192) {
+      upgrading = false;
+      realClose();
+    }
+    return false;
+  }
+
+  upgrading = false;
+  bool upgraded = inbox.compare(0, 12, "HTTP/1.1 101") == 0;
+  inbox.erase(0, end + 4); // frames right after response
+  if (!upgraded) realClose();
+  return upgraded;
+}
+
+bool WebSocketsClient::realSend(uint8_t opcode, const uint8_t *payload, size_t length) {
+  if (sock < 0) return false;
+
+  // client frames are masked
+  std::string frame;
+  frame += (char)(0x80 | opcode);
+  if (length < 126) {
+    frame += (char)(0x80 | length);
+  } else if (length <= 0xFFFF) {
+    frame += (char)(0x80 | 126);
+    frame += (char)(length >> 8);
+    frame += (char)length;
+  } else {
+    frame += (char)(0x80 | 127);
+    for (int i = 7; i >= 0; i--) frame += (char)((uint64_t)length >> (i * 8));
+  }
+
+  uint8_t mask[4];
+  for (int i = 0; i < 4; i++) mask[i] = rand();
+  frame.append((const char *)mask, sizeof(mask));
+  for (size_t i = 0; i < length; i++) frame += (char)(payload[i] ^ mask[i % 4]);
+
+  if (sockSendAll(sock, (const uint8_t *)frame.data(), frame.size())) return true;
+
+  realClose();
+  return false;
+}
+
+void WebSocketsClient::realClose() {
+  upgrading = false;
+  if (sock < 0) return;
+
+  if (connected) {
+    uint8_t close[] = {0x88, 0x80, 0, 0, 0, 0}; // empty masked close
+    send(sock, close, sizeof(close), MSG_NOSIGNAL);
+  }
+  ::close(sock);
+  sock = -1;
+}
+
+void WebSocketsClient::realLoop() {
+  if (upgrading) {
+    if (!realUpgraded()) return;
+
+    connected = true;
+    runEvent(WStype_CONNECTED, (uint8_t *)url.c_str(), url.length());
+    return;
+  }
+
+  if (!connected) {
+    if (attempted && millis() - lastAttempt < reconnectInterval) return;
+    attempted = true;
+
+    bool ok = WiFi.isConnected() && realConnect();
+    lastAttempt = millis();
+    if (!ok) realClose();
+    return;
+  }
+
+  bool open = WiFi.isConnected();
+  char buf[2048];
+  ssize_t n;
+  while (open && (n = recv(sock, buf, sizeof(buf), MSG_DONTWAIT)) != 0) {
+    if (n < 0) {
+      open = errno == EAGAIN || errno == EWOULDBLOCK;
+      break;
+    }
+    inbox.append(buf, n);
+  }
+  if (n == 0) open = false;
+
+  // [fin | opcode] [mask | len (126 - 16 bit, 127 - 64 bit follows)] [mask key] [payload]
+  while (open && inbox.size() >= 2) {
+    const uint8_t *h = (const uint8_t *)inbox.data();
+    uint64_t len = h[1] & 0x7F;
+    size_t headerLen = 2;
+    if (len == 126) headerLen = 4;
+    else if (len == 127) headerLen = 10;
+    if (h[1] & 0x80) headerLen += 4;
+    if (inbox.size() < headerLen) break;
+
+    if (len >= 126) {
+      len = 0;
+      for (size_t i = 2; i < (h[1] & 0x80 ? headerLen - 4 : headerLen); i++) len = len << 8 | h[i];
+    }
+    if (inbox.size() < headerLen + len) break;
+
+    std::string payload = inbox.substr(headerLen, len);
+    if (h[1] & 0x80) {
+      for (size_t i = 0; i < len; i++) payload[i] ^= h[headerLen - 4 + i % 4];
+    }
+    bool fin = h[0] & 0x80;
+    uint8_t opcode = h[0] & 0x0F;
+    inbox.erase(0, headerLen + len);
+
+    if (opcode == 0x0 || ((opcode == 0x1 || opcode == 0x2) && !fin)) {
+      if (opcode != 0x0) fragmentsOpcode = opcode;
+      fragments += payload;
+      if (!fin) continue;
+
+      opcode = fragmentsOpcode;
+      payload.swap(fragments);
+      fragments.clear();
+    }
+
+    if (opcode == 0x1) runEvent(WStype_TEXT, (uint8_t *)&payload[0], payload.size());
+    else if (opcode == 0x2) runEvent(WStype_BIN, (uint8_t *)&payload[0], payload.size());
+    else if (opcode == 0x9) realSend(0xA, (const uint8_t *)payload.data(), payload.size());
+    else if (opcode == 0xA) runEvent(WStype_PONG, (uint8_t *)&payload[0], payload.size());
+    else if (opcode == 0x8) open = false;
+
+    open = open && sock >= 0 && connected; // event handler may disconnect
+  }
+
+  if (!open && connected) {
+    realClose();
+    connected = false;
+    lastAttempt = millis();
+    runEvent(WStype_DISCONNECTED, NULL, 0);
+  }
+}
+
+// ---- udp ----
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+  stop();
+  sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if (sock < 0) return 0;
+
+  sockaddr_in addr = sockAddr(IPAddress(), port);
+  if (bind(sock, (sockaddr *)&addr, sizeof(addr)) != 0) {
+    stop();
+    return 0;
+  }
+
+  sockNonBlocking(sock);
+  return 1;
+}
+
+void WiFiUDP::stop() {
+  if (sock >= 0) close(sock);
+  sock = -1;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+  txIp = ip;
+  txPort = port;
+  tx.clear();
+  return sock >= 0;
+}
+
+size_t WiFiUDP::write(const uint8_t *buffer, size_t size) {
+  tx.append((const char *)buffer, size);
+  return size;
+}
+
+int WiFiUDP::endPacket() {
+  if (sock < 0 || !WiFi.isConnected()) return 0;
+
+  sockaddr_in addr = sockAddr(txIp, txPort);
+  sent++;
+  return sendto(sock, tx.data(), tx.size(), 0, (sockaddr *)&addr, sizeof(addr)) == (ssize_t)tx.size();
+}
+
+int WiFiUDP::parsePacket() {
+  rx.clear();
+  if (sock < 0) return 0;
+
+  char buf[2048];
+  sockaddr_in from;
+  socklen_t fromLen = sizeof(from);
+  ssize_t n = recvfrom(sock, buf, sizeof(buf), MSG_DONTWAIT, (sockaddr *)&from, &fromLen);
+  if (n <= 0 || !WiFi.isConnected()) return 0;
+
+  rx.assign(buf, n);
+  rxIp = IPAddress((uint32_t)from.sin_addr.s_addr);
+  rxPort = ntohs(from.sin_port);
+  return n;
+}
+
+int WiFiUDP::read(uint8_t *buffer, size_t len) {
+  size_t n = min(len, rx.size());
+  memcpy(buffer, rx.data(), n);
+  rx.erase(0, n);
+  return n;
+}
+
+// ---- tcp probe, mdns ----
+
+int WiFiClient::connect(const char *host, uint16_t port, int32_t timeoutMs) {
+  if (!WiFi.isConnected()) return 0;
+
+  if (netReal) {
+    stop();
+    sock = sockConnect(host, port, timeoutMs);
+    isOpen = sock >= 0;
+    return isOpen;
+  }
+
+  halSleepUntil(halNow() + 2 * wsLatency);
+  isOpen = wsListening;
+  return isOpen;
+}
+
+void WiFiClient::stop() {
+  if (sock >= 0) close(sock);
+  sock = -1;
+  isOpen = false;
+}
+
+struct HalMdnsEntry {
+  String service;
+  String ip;
+  uint16_t port;
+  String wsUrl;
+};
+
+static std::vector<HalMdnsEntry> mdnsEntries;
+static std::vector<HalMdnsEntry> mdnsResults;
+
+MDNSResponder MDNS;
+
+void halMdnsAdd(const char *service, const char *ip, uint16_t port, const char *wsUrl) {
+  mdnsEntries.push_back({service, ip, port, wsUrl});
+}
+
+int MDNSResponder::queryService(const char *service, const char */*proto*/) {
+  halSleepUntil(halNow() + HAL_MDNS_QUERY_US);
+
+  mdnsResults.clear();
+  if (!WiFi.isConnected()) return 0;
+
+  for (auto &e : mdnsEntries) {
+    if (e.service == service) mdnsResults.push_back(e);
+  }
+  return mdnsResults.size();
+}
+
+String MDNSResponder::hostname(int idx) {
+  return idx < (int)mdnsResults.size() ? mdnsResults[idx].service + "-" + idx : String();
+}
+
+IPAddress MDNSResponder::IP(int idx) {
+  IPAddress ip;
+  if (idx < (int)mdnsResults.size()) ip.fromString(mdnsResults[idx].ip.c_str());
+  return ip;
+}
+
+uint16_t MDNSResponder::port(int idx) {
+  return idx < (int)mdnsResults.size() ? mdnsResults[idx].port : 0;
+}
+
+String MDNSResponder::txt(int idx, const char *key) {
+  if (idx >= (int)mdnsResults.size() || strcmp(key, "ws") != 0) return String();
+  return mdnsResults[idx].wsUrl;
+}
@@ -0,0 +1,498 @@
+#include <Arduino.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "hal_internal.h"
+
+// Tasks are threads, but they hand over a single token, so exactly one runs at
+// a time and station code sees the same interleavings on every run. Task gives
+// the token away only in halSleepUntil (delay, yield, blocking freertos calls).
+
+struct HalTask {
+  std::string name;
+  int core;
+  uint32_t stack;
+  bool station;        // frozen while station is in light sleep
+  bool done = false;
+  uint64_t wakeAt = 0;
+  uint32_t notify = 0;
+  bool waitingNotify = false;
+  std::condition_variable cv;
+};
+
+struct HalTaskKilled {};
+
+static std::mutex schedMutex;
+static std::vector<HalTask *> tasks;
+static HalTask *running = nullptr;
+static thread_local HalTask *self = nullptr;
+static uint64_t now = 0;
+
+static bool realtime = false;
+static std::chrono::steady_clock::time_point realtimeStart;
+
+static HalTask *sleeper = nullptr; // task in esp_light_sleep_start
+static std::vector<std::function<void(int)>> exitHooks;
+
+static uint64_t wallUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - realtimeStart).count();
+}
+
+// First thread touching scheduler is arduino loopTask (runner main)
+static HalTask *current() {
+  if (self != nullptr) return self;
+
+  std::lock_guard<std::mutex> lock(schedMutex);
+  self = new HalTask();
+  self->name = "loopTask";
+  self->core = 1;
+  self->stack = 8192;
+  self->station = true;
+  tasks.push_back(self);
+  if (running == nullptr) running = self;
+  return self;
+}
+
+static bool runnable(HalTask *t) {
+  return !t->done && (sleeper == nullptr || !t->station || t == sleeper);
+}
+
+/// @brief Task that runs next: earliest wake up, ties go round robin after from
+static HalTask *pickNext(HalTask *from) {
+  size_t start = 0;
+  for (size_t i = 0; i < tasks.size(); i++) {
+    if (tasks[i] == from) start = i + 1;
+  }
+
+  HalTask *best = nullptr;
+  for (size_t n = 0; n < tasks.size(); n++) {
+    HalTask *t = tasks[(start + n) % tasks.size()];
+    if (!runnable(t)) continue;
+    if (best == nullptr || t->wakeAt < best->wakeAt) best = t;
+  }
+
+  return best;
+}
+
+static void switchTo(std::unique_lock<std::mutex> &lock, HalTask *from) {
+  HalTask *next = pickNext(from);
+  if (next == nullptr || next->wakeAt == UINT64_MAX) {
+    lock.unlock();
+    halExit(HAL_EXIT_DEADLOCK, next == nullptr ? "all tasks finished" : "every task waits forever");
+  }
+
+  if (next->wakeAt > now) {
+    if (realtime) {
+      uint64_t wall = wallUs();
+      if (next->wakeAt > wall) std::this_thread::sleep_for(std::chrono::microseconds(next->wakeAt - wall));
+    }
+    now = next->wakeAt;
+  }
+
+  running = next;
+  if (next != from) next->cv.notify_one();
+}
+
+static void waitForToken(std::unique_lock<std::mutex> &lock, HalTask *t) {
+  t->cv.wait(lock, [t] { return running == t; });
+  if (t->done) throw HalTaskKilled();
+}
+
+uint64_t halNow() {
+  return now;
+}
+
+uint64_t halClockRead() {
+  now += HAL_CLOCK_READ_COST;
+  if (realtime) now = max(now, wallUs());
+  return now;
+}
+
+void halAdvance(uint64_t us) {
+  now += us;
+}
+
+void halSleepUntil(uint64_t us) {
+  HalTask *t = current();
+  std::unique_lock<std::mutex> lock(schedMutex);
+  t->wakeAt = max(us, now);
+  switchTo(lock, t);
+  if (running != t) waitForToken(lock, t);
+}
+
+void halSetRealtime(bool on) {
+  realtime = on;
+  realtimeStart = std::chrono::steady_clock::now() - std::chrono::microseconds(now);
+}
+
+static HalTask *createTask(const char *name, std::function<void()> fn, int core, uint32_t stack, bool station) {
+  current(); // caller becomes loopTask if it's the first one
+
+  HalTask *t = new HalTask();
+  t->name = name;
+  t->core = core;
+  t->stack = stack;
+  t->station = station;
+  t->wakeAt = now;
+
+  {
+    std::lock_guard<std::mutex> lock(schedMutex);
+    tasks.push_back(t);
+  }
+
+  std::thread([t, fn] {
+    self = t;
+    {
+      std::unique_lock<std::mutex> lock(schedMutex);
+      t->cv.wait(lock, [t] { return running == t; });
+    }
+
+    try {
+      if (!t->done) fn();
+    } catch (HalTaskKilled &) {
+    }
+
+    std::unique_lock<std::mutex> lock(schedMutex);
+    t->done = true;
+    if (running == t) switchTo(lock, t);
+  }).detach();
+
+  return t;
+}
+
+void *halTaskCreate(const char *name, std::function<void()> fn, int core, uint32_t stack) {
+  return createTask(name, fn, core, stack, false);
+}
+
+HalTask *halStationTask(const char *name, std::function<void()> fn, int core, uint32_t stack) {
+  return createTask(name, fn, core, stack, true);
+}
+
+void halTaskWake(HalTask *t) {
+  std::lock_guard<std::mutex> lock(schedMutex);
+  if (!t->done && t->wakeAt > now) t->wakeAt = now;
+}
+
+void halOnExit(std::function<void(int code)> fn) {
+  exitHooks.push_back(fn);
+}
+
+void halExit(int code, const char *reason) {
+  for (auto &hook : exitHooks) hook(code);
+  halLog("hal: exit %d (%s)\n", code, reason);
+  halFlashSaveOnExit();
+  fflush(stdout);
+  fflush(stderr);
+  _exit(code);
+}
+
+// ---- arduino ----
+
+unsigned long millis() {
+  return halClockRead() / 1000;
+}
+
+unsigned long micros() {
+  return halClockRead();
+}
+
+void delay(uint32_t ms) {
+  halSleepUntil(halClockRead() + (uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us) {
+  halAdvance(us); // busy wait, no task switch
+}
+
+void yield() {
+  halSleepUntil(now);
+}
+
+// ---- freertos ----
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *param,
+                                   UBaseType_t /*priority*/, TaskHandle_t *handle, BaseType_t core) {
+  HalTask *t = halStationTask(name, [fn, param] { fn(param); }, core == tskNO_AFFINITY ? 0 : core, stackDepth);
+  if (handle != NULL) *handle = t;
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *param, UBaseType_t priority,
+                       TaskHandle_t *handle) {
+  return xTaskCreatePinnedToCore(fn, name, stackDepth, param, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  HalTask *t = task == NULL ? current() : (HalTask *)task;
+  {
+    std::lock_guard<std::mutex> lock(schedMutex);
+    t->done = true;
+  }
+
+  if (t == current()) {
+    if (t->name == "loopTask") {
+      std::unique_lock<std::mutex> lock(schedMutex);
+      switchTo(lock, t);
+      t->cv.wait(lock, [] { return false; }); // main thread can't end
+    }
+    throw HalTaskKilled();
+  }
+}
+
+void vTaskDelay(TickType_t ticks) {
+  halSleepUntil(now + (uint64_t)ticks * 1000);
+}
+
+TickType_t xTaskGetTickCount() {
+  return halClockRead() / 1000;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return current();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  HalTask *t = task == NULL ? current() : (HalTask *)task;
+  return t->stack / 2; // host stacks aren't measured, half of requested looks healthy
+}
+
+BaseType_t xPortGetCoreID() {
+  return current()->core;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  HalTask *t = (HalTask *)task;
+  t->notify++;
+  if (t->waitingNotify) halTaskWake(t);
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) {
+  xTaskNotifyGive(task);
+  if (woken != NULL) *woken = pdFALSE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  HalTask *t = current();
+  if (t->notify == 0 && ticks > 0) {
+    t->waitingNotify = true;
+    halSleepUntil(ticks == portMAX_DELAY ? UINT64_MAX : now + (uint64_t)ticks * 1000);
+    t->waitingNotify = false;
+  }
+
+  uint32_t value = t->notify;
+  if (clearOnExit) t->notify = 0;
+  else if (value > 0) t->notify--;
+  return value;
+}
+
+struct HalSemaphore {
+  bool taken;
+  HalTask *holder;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return new HalSemaphore{false, nullptr};
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+  return new HalSemaphore{true, nullptr}; // created empty
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+  HalSemaphore *s = (HalSemaphore *)sem;
+  uint64_t deadline = ticks == portMAX_DELAY ? UINT64_MAX : now + (uint64_t)ticks * 1000;
+
+  // holder can only release it when it runs, so waiting task polls every tick
+  while (s->taken) {
+    if (now >= deadline) return pdFALSE;
+    halSleepUntil(min(now + 1000, deadline));
+  }
+
+  s->taken = true;
+  s->holder = current();
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  HalSemaphore *s = (HalSemaphore *)sem;
+  if (!s->taken) return pdFALSE;
+  s->taken = false;
+  s->holder = nullptr;
+  return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {
+  delete (HalSemaphore *)sem;
+}
+
+// ---- esp_timer ----
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void *arg;
+  const char *name;
+  uint64_t period; // 0 - one shot
+  uint64_t next;   // 0 - stopped
+};
+
+static std::vector<esp_timer *> timers;
+static HalTask *timerTask = nullptr;
+
+static void timerLoop() {
+  while (true) {
+    uint64_t next = UINT64_MAX;
+    for (esp_timer *t : timers) {
+      if (t->next != 0) next = min(next, t->next);
+    }
+
+    if (next > now) {
+      halSleepUntil(next);
+      continue;
+    }
+
+    for (size_t i = 0; i < timers.size(); i++) {
+      esp_timer *t = timers[i];
+      if (t->next == 0 || t->next > now) continue;
+
+      t->next = t->period > 0 ? t->next + t->period : 0;
+      t->callback(t->arg);
+    }
+  }
+}
+
+int64_t esp_timer_get_time() {
+  return halClockRead();
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out) {
+  if (args == NULL || args->callback == NULL || out == NULL) return ESP_ERR_INVALID_ARG;
+  if (timerTask == nullptr) timerTask = halStationTask("esp_timer", timerLoop, 0, 4096);
+
+  esp_timer *t = new esp_timer{args->callback, args->arg, args->name, 0, 0};
+  timers.push_back(t);
+  *out = t;
+  return ESP_OK;
+}
+
+static esp_err_t timerStart(esp_timer_handle_t timer, uint64_t timeout, uint64_t period) {
+  if (timer == NULL) return ESP_ERR_INVALID_ARG;
+  if (timer->next != 0) return ESP_ERR_INVALID_STATE;
+
+  timer->period = period;
+  timer->next = now + max(timeout, (uint64_t)1);
+  halTaskWake(timerTask);
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+  return timerStart(timer, period, period);
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout) {
+  return timerStart(timer, timeout, 0);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (timer == NULL || timer->next == 0) return ESP_ERR_INVALID_STATE;
+  timer->next = 0;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  if (timer == NULL || timer->next != 0) return ESP_ERR_INVALID_STATE;
+  timers.erase(std::find(timers.begin(), timers.end(), timer));
+  delete timer;
+  return ESP_OK;
+}
+
+// ---- system, sleep ----
+
+static int ext0Pin = -1;
+static int ext0Level = 0;
+static uint64_t sleepTimer = 0; // us, 0 - disabled
+static esp_sleep_wakeup_cause_t wakeupCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+
+esp_reset_reason_t esp_reset_reason() {
+  return ESP_RST_POWERON;
+}
+
+uint32_t esp_get_free_heap_size() {
+  return ESP.getFreeHeap();
+}
+
+uint32_t esp_get_minimum_free_heap_size() {
+  return ESP.getMinFreeHeap();
+}
+
+void esp_restart() {
+  halExit(HAL_EXIT_RESTART, "restart");
+}
+
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t pin, int level) {
+  ext0Pin = pin;
+  ext0Level = level;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_ext1_wakeup(uint64_t /*mask*/, esp_sleep_ext1_wakeup_mode_t /*mode*/) {
+  return ESP_OK; // only used for deep sleep, which ends simulation
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t us) {
+  sleepTimer = us;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_source_t source) {
+  if (source == ESP_SLEEP_WAKEUP_TIMER || source == ESP_SLEEP_WAKEUP_ALL) sleepTimer = 0;
+  if (source == ESP_SLEEP_WAKEUP_EXT0 || source == ESP_SLEEP_WAKEUP_ALL) ext0Pin = -1;
+  return ESP_OK;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+  return wakeupCause;
+}
+
+// Other station tasks (and esp_timer) are frozen until wake up, runner tasks keep going
+esp_err_t esp_light_sleep_start() {
+  HalTask *t = current();
+  if (ext0Pin >= 0 && halGpioLevel(ext0Pin) == ext0Level) {
+    wakeupCause = ESP_SLEEP_WAKEUP_EXT0;
+    return ESP_OK;
+  }
+
+  uint64_t start = now;
+  uint64_t deadline = sleepTimer > 0 ? start + sleepTimer : UINT64_MAX;
+  halLog("hal: light sleep\n");
+
+  sleeper = t;
+  wakeupCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+  while (true) {
+    if (ext0Pin >= 0 && halGpioLevel(ext0Pin) == ext0Level) {
+      wakeupCause = ESP_SLEEP_WAKEUP_EXT0;
+      break;
+    }
+    if (now >= deadline) {
+      wakeupCause = ESP_SLEEP_WAKEUP_TIMER;
+      break;
+    }
+
+    halSleepUntil(deadline); // woken earlier by halSleepGpioChanged
+  }
+  sleeper = nullptr;
+
+  halLog("hal: woken up after %.3f s (%s)\n", (now - start) / 1e6, wakeupCause == ESP_SLEEP_WAKEUP_TIMER ? "timer" : "gpio");
+  return ESP_OK;
+}
+
+void halSleepGpioChanged() {
+  if (sleeper != nullptr) halTaskWake(sleeper);
+}
+
+void esp_deep_sleep_start() {
+  halExit(HAL_EXIT_DEEP_SLEEP, "deep sleep");
+}
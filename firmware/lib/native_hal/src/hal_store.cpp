@@ -0,0 +1,293 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <Preferences.h>
+#include <Update.h>
+#include <esp_partition.h>
+#include <rom/crc.h>
+#include <map>
+#include <vector>
+#include "hal_internal.h"
+
+#define FLASH_SECTOR_SIZE 4096
+
+static std::map<std::string, std::vector<uint8_t>> regions;
+static std::string autosavePath;
+
+static void flashWriteCost(size_t len) {
+  halAdvance(HAL_FLASH_WRITE_US * ((len + 31) / 32));
+}
+
+std::vector<uint8_t> &halFlashRegion(const std::string &name) {
+  return regions[name];
+}
+
+bool halFlashExists(const std::string &name) {
+  return regions.count(name) > 0;
+}
+
+void halFlashRemove(const std::string &name) {
+  regions.erase(name);
+}
+
+// File: [name length(32)] [name] [data length(32)] [data], repeated
+bool halFlashLoad(const std::string &path) {
+  FILE *f = fopen(path.c_str(), "rb");
+  if (f == NULL) return false;
+
+  uint32_t len;
+  while (fread(&len, sizeof(len), 1, f) == 1) {
+    std::string name(len, '\0');
+    if (fread(&name[0], 1, len, f) != len || fread(&len, sizeof(len), 1, f) != 1) break;
+
+    std::vector<uint8_t> &data = regions[name];
+    data.resize(len);
+    if (fread(data.data(), 1, len, f) != len) break;
+  }
+
+  fclose(f);
+  return true;
+}
+
+bool halFlashSave(const std::string &path) {
+  FILE *f = fopen(path.c_str(), "wb");
+  if (f == NULL) return false;
+
+  for (auto &r : regions) {
+    uint32_t len = r.first.size();
+    fwrite(&len, sizeof(len), 1, f);
+    fwrite(r.first.data(), 1, len, f);
+    len = r.second.size();
+    fwrite(&len, sizeof(len), 1, f);
+    fwrite(r.second.data(), 1, len, f);
+  }
+
+  return fclose(f) == 0;
+}
+
+void halFlashAutosave(const std::string &path) {
+  autosavePath = path;
+}
+
+void halFlashSaveOnExit() {
+  if (!autosavePath.empty()) halFlashSave(autosavePath);
+}
+
+uint32_t crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len) {
+  crc = ~crc;
+  while (len--) {
+    crc ^= *buf++;
+    for (int i = 0; i < 8; i++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+  }
+  return ~crc;
+}
+
+// ---- eeprom ----
+
+EEPROMClass EEPROM;
+
+bool EEPROMClass::begin(size_t size) {
+  if (size == 0) return false;
+
+  std::vector<uint8_t> &r = halFlashRegion("eeprom");
+  r.resize(size, 0); // fresh nvs blob reads as zeros
+
+  delete[] data;
+  data = new uint8_t[size];
+  memcpy(data, r.data(), size);
+  this->size = size;
+  dirty = false;
+  return true;
+}
+
+void EEPROMClass::end() {
+  commit();
+  delete[] data;
+  data = NULL;
+  size = 0;
+}
+
+bool EEPROMClass::commit() {
+  if (data == NULL) return false;
+  if (!dirty) return true;
+
+  std::vector<uint8_t> &r = halFlashRegion("eeprom");
+  r.assign(data, data + size);
+  flashWriteCost(size);
+  dirty = false;
+  return true;
+}
+
+// ---- preferences ----
+
+bool Preferences::begin(const char *name, bool readOnly, const char */*partitionLabel*/) {
+  if (name == NULL || strlen(name) > 15) return false;
+  ns = name;
+  this->readOnly = readOnly;
+  started = true;
+  return true;
+}
+
+bool Preferences::clear() {
+  if (!started || readOnly) return false;
+
+  std::string prefix = std::string(region("").c_str());
+  for (auto it = regions.begin(); it != regions.end();) {
+    it = it->first.compare(0, prefix.size(), prefix) == 0 ? regions.erase(it) : std::next(it);
+  }
+  return true;
+}
+
+bool Preferences::remove(const char *key) {
+  if (!started || readOnly || !isKey(key)) return false;
+  halFlashRemove(region(key).c_str());
+  return true;
+}
+
+bool Preferences::isKey(const char *key) {
+  return started && halFlashExists(region(key).c_str());
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+  if (!started || readOnly || key == NULL || value == NULL) return 0;
+
+  std::vector<uint8_t> &r = halFlashRegion(region(key).c_str());
+  r.assign((const uint8_t *)value, (const uint8_t *)value + len);
+  flashWriteCost(len);
+  return len;
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+  return isKey(key) ? halFlashRegion(region(key).c_str()).size() : 0;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+  size_t len = getBytesLength(key);
+  if (len == 0 || buf == NULL || len > maxLen) return 0;
+
+  memcpy(buf, halFlashRegion(region(key).c_str()).data(), len);
+  return len;
+}
+
+String Preferences::getString(const char *key, const String &defaultValue) {
+  size_t len = getBytesLength(key);
+  if (len == 0) return defaultValue;
+
+  std::vector<uint8_t> &r = halFlashRegion(region(key).c_str());
+  return String((const char *)r.data(), strnlen((const char *)r.data(), len));
+}
+
+// ---- partitions ----
+
+static std::vector<esp_partition_t *> partitions;
+
+static std::vector<uint8_t> &partitionData(const esp_partition_t *p) {
+  std::vector<uint8_t> &r = halFlashRegion(std::string("part/") + p->label);
+  if (r.size() != p->size) r.resize(p->size, 0xFF); // erased flash
+  return r;
+}
+
+const esp_partition_t *halPartitionAdd(const char *label, esp_partition_type_t type, uint8_t subtype, uint32_t address, uint32_t size) {
+  esp_partition_t *p = new esp_partition_t();
+  p->type = type;
+  p->subtype = (esp_partition_subtype_t)subtype;
+  p->address = address;
+  p->size = size;
+  strncpy(p->label, label, sizeof(p->label) - 1);
+  partitions.push_back(p);
+  return p;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label) {
+  for (esp_partition_t *p : partitions) {
+    if (p->type != type) continue;
+    if (subtype != ESP_PARTITION_SUBTYPE_ANY && p->subtype != subtype) continue;
+    if (label != NULL && strcmp(p->label, label) != 0) continue;
+    return p;
+  }
+
+  return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *p, size_t offset, void *dst, size_t size) {
+  if (p == NULL || dst == NULL) return ESP_ERR_INVALID_ARG;
+  if (offset + size > p->size) return ESP_ERR_INVALID_SIZE;
+
+  memcpy(dst, partitionData(p).data() + offset, size);
+  halAdvance(size / 40 + 1); // ~40 MB/s (qio, cached)
+  return ESP_OK;
+}
+
+// NOR flash: programming only clears bits, erase sets them back
+esp_err_t esp_partition_write(const esp_partition_t *p, size_t offset, const void *src, size_t size) {
+  if (p == NULL || src == NULL) return ESP_ERR_INVALID_ARG;
+  if (offset + size > p->size) return ESP_ERR_INVALID_SIZE;
+
+  uint8_t *data = partitionData(p).data() + offset;
+  for (size_t i = 0; i < size; i++) data[i] &= ((const uint8_t *)src)[i];
+  flashWriteCost(size);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *p, size_t offset, size_t size) {
+  if (p == NULL) return ESP_ERR_INVALID_ARG;
+  if (offset + size > p->size) return ESP_ERR_INVALID_SIZE;
+  if (offset % FLASH_SECTOR_SIZE != 0 || size % FLASH_SECTOR_SIZE != 0) return ESP_ERR_INVALID_SIZE;
+
+  memset(partitionData(p).data() + offset, 0xFF, size);
+  halAdvance(HAL_FLASH_ERASE_US * (size / FLASH_SECTOR_SIZE));
+  return ESP_OK;
+}
+
+// ---- ota ----
+
+UpdateClass Update;
+
+bool UpdateClass::begin(size_t size) {
+  if (size == 0 || (size != UPDATE_SIZE_UNKNOWN && size > ESP.getFreeSketchSpace())) {
+    error = UPDATE_ERROR_SIZE;
+    return false;
+  }
+
+  std::vector<uint8_t> &image = halFlashRegion("part/app1");
+  image.clear();
+  total = size;
+  written = 0;
+  error = UPDATE_ERROR_OK;
+  started = true;
+  return true;
+}
+
+size_t UpdateClass::write(uint8_t *data, size_t len) {
+  if (!started) return 0;
+  if (total != UPDATE_SIZE_UNKNOWN && written + len > total) {
+    error = UPDATE_ERROR_SIZE;
+    return 0;
+  }
+
+  std::vector<uint8_t> &image = halFlashRegion("part/app1");
+  size_t sectorsBefore = (image.size() + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE;
+  image.insert(image.end(), data, data + len);
+  size_t sectorsAfter = (image.size() + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE;
+
+  halAdvance(HAL_FLASH_ERASE_US * (sectorsAfter - sectorsBefore));
+  flashWriteCost(len);
+  written += len;
+  return len;
+}
+
+bool UpdateClass::end(bool evenIfRemaining) {
+  if (!started) return false;
+  started = false;
+
+  if (written == 0 || (!evenIfRemaining && total != UPDATE_SIZE_UNKNOWN && written != total)) {
+    error = UPDATE_ERROR_SIZE;
+    return false;
+  }
+
+  halLog("hal: ota image written (%u bytes)\n", (unsigned)written);
+  return true;
+}
+
+void UpdateClass::printError(Print &out) {
+  out.printf("ERROR[%u]: %s\n", error, error == UPDATE_ERROR_OK ? "No Error" : "Bad Size Given");
+}
@@ -0,0 +1,8 @@
+#ifndef __SOC_RTC_CNTL_REG_H__
+#define __SOC_RTC_CNTL_REG_H__
+
+#include "soc/soc.h"
+
+#define RTC_CNTL_BROWN_OUT_REG 0x3FF480D4
+
+#endif
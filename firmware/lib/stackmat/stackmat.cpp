@@ -38,6 +38,16 @@ int Stackmat::time() {
     return timerTime;
 }
 
+// Number of valid frames received since boot
+unsigned long Stackmat::frames() {
+    return frameCount;
+}
+
+// micros() of last valid frame decode
+unsigned long Stackmat::frameTime() {
+    return lastFrameMicros;
+}
+
 bool Stackmat::connected() {
     return millis() - lastUpdated < STACKMAT_TIMER_TIMEOUT;
 }
@@ -94,6 +104,8 @@ bool Stackmat::ParseTimerData(String data) {
   currentTimerState = state;
   lastUpdated = millis();
   timerTime = totalMs;
+  frameCount++;
+  lastFrameMicros = micros();
 
   return true;
 }
\ No newline at end of file
@@ -24,11 +24,15 @@ class Stackmat {
     bool connected();
     StackmatTimerState state();
     int time();
+    unsigned long frames();
+    unsigned long frameTime();
 
   private:
     StackmatTimerState currentTimerState = ST_Reset;
     unsigned long lastUpdated = 0;
     int timerTime = 0;
+    unsigned long frameCount = 0;
+    unsigned long lastFrameMicros = 0;
     Stream *serial;
 
     String ReadStackmatString();
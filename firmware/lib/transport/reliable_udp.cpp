@@ -0,0 +1,225 @@
+#include "reliable_udp.h"
+#include <string.h>
+
+static inline void put16(uint8_t *out, uint16_t v) {
+  out[0] = v & 0xFF;
+  out[1] = v >> 8;
+}
+
+static inline void put32(uint8_t *out, uint32_t v) {
+  put16(out, v & 0xFFFF);
+  put16(out + 2, v >> 16);
+}
+
+static inline uint16_t get16(const uint8_t *in) {
+  return in[0] | (in[1] << 8);
+}
+
+static inline uint32_t get32(const uint8_t *in) {
+  return get16(in) | ((uint32_t)get16(in + 2) << 16);
+}
+
+ReliableUdp::ReliableUdp(SendFn send, ReceiveFn receive, void *ctx) : sendFn(send), receiveFn(receive), ctx(ctx) {
+  memset(window, 0, sizeof(window));
+}
+
+void ReliableUdp::start(uint32_t _session, uint32_t nowUs) {
+  memset(window, 0, sizeof(window));
+  stats = RudpStats();
+  session = _session;
+  active = true;
+  heard = false;
+  nextSeq = 1;
+  receivedAny = false;
+  receivedMask = 0;
+  rttVar = 0;
+  rto = RUDP_INITIAL_RTO * 1000;
+
+  // first hello right away, server learns our address from it
+  lastHello = nowUs;
+  sendControl(RUDP_HELLO, ++helloSeq);
+}
+
+void ReliableUdp::stop() {
+  active = false;
+  heard = false;
+  memset(window, 0, sizeof(window));
+}
+
+bool ReliableUdp::up(uint32_t nowUs) {
+  return active && heard && nowUs - lastHeard < RUDP_DEAD_TIME * 1000UL;
+}
+
+bool ReliableUdp::canSend(size_t len) {
+  if (!active || len > RUDP_MAX_PAYLOAD) return false;
+
+  for (int i = 0; i < RUDP_WINDOW; i++) {
+    if (!window[i].used) return true;
+  }
+
+  return false;
+}
+
+void ReliableUdp::writeHeader(uint8_t *out, RudpType type, uint16_t seq) {
+  out[0] = RUDP_MAGIC;
+  out[1] = type;
+  put16(out + 2, seq);
+  put32(out + 4, session);
+}
+
+void ReliableUdp::sendControl(RudpType type, uint16_t seq) {
+  uint8_t packet[RUDP_HEADER_SIZE];
+  writeHeader(packet, type, seq);
+  sendFn(ctx, packet, sizeof(packet));
+}
+
+bool ReliableUdp::send(const uint8_t *data, size_t len, uint32_t nowUs) {
+  if (!active || len > RUDP_MAX_PAYLOAD) return false;
+
+  Slot *slot = NULL;
+  for (int i = 0; i < RUDP_WINDOW; i++) {
+    if (!window[i].used) {
+      slot = &window[i];
+      break;
+    }
+  }
+
+  if (slot == NULL) return false;
+
+  slot->used = true;
+  slot->seq = nextSeq++;
+  if (nextSeq == 0) nextSeq = 1;
+  slot->retries = 0;
+  slot->sentAt = nowUs;
+  slot->timeout = rto;
+  slot->len = RUDP_HEADER_SIZE + len;
+  writeHeader(slot->data, RUDP_DATA, slot->seq);
+  memcpy(slot->data + RUDP_HEADER_SIZE, data, len);
+
+  sendFn(ctx, slot->data, slot->len);
+  stats.sent++;
+  return true;
+}
+
+bool ReliableUdp::wasReceived(uint16_t seq) {
+  if (!receivedAny) return false;
+
+  int16_t diff = (int16_t)(seq - highestSeq);
+  if (diff > 0) return false;
+
+  // older than window is treated as duplicate (server retransmits give up long before)
+  if (-diff >= 32) return true;
+
+  return receivedMask & (1UL << -diff);
+}
+
+void ReliableUdp::markReceived(uint16_t seq) {
+  if (!receivedAny) {
+    receivedAny = true;
+    highestSeq = seq;
+    receivedMask = 1;
+    return;
+  }
+
+  int16_t diff = (int16_t)(seq - highestSeq);
+  if (diff > 0) {
+    receivedMask = diff >= 32 ? 1 : (receivedMask << diff) | 1;
+    highestSeq = seq;
+    return;
+  }
+
+  receivedMask |= 1UL << -diff;
+}
+
+void ReliableUdp::onAck(uint16_t seq, uint32_t nowUs) {
+  for (int i = 0; i < RUDP_WINDOW; i++) {
+    Slot &s = window[i];
+    if (!s.used || s.seq != seq) continue;
+
+    // karn: rtt of retransmitted frame is ambiguous
+    if (s.retries == 0) {
+      uint32_t rtt = nowUs - s.sentAt;
+      if (stats.srtt == 0) {
+        stats.srtt = rtt;
+        rttVar = rtt / 2;
+      } else {
+        uint32_t diff = rtt > stats.srtt ? rtt - stats.srtt : stats.srtt - rtt;
+        rttVar = (3 * rttVar + diff) / 4;
+        stats.srtt = (7 * stats.srtt + rtt) / 8;
+      }
+
+      rto = stats.srtt + 4 * rttVar;
+      if (rto < RUDP_MIN_RTO * 1000UL) rto = RUDP_MIN_RTO * 1000UL;
+      if (rto > RUDP_MAX_RTO * 1000UL) rto = RUDP_MAX_RTO * 1000UL;
+    }
+
+    s.used = false;
+    return;
+  }
+}
+
+void ReliableUdp::onDatagram(const uint8_t *data, size_t len, uint32_t nowUs) {
+  if (!active || len < RUDP_HEADER_SIZE || data[0] != RUDP_MAGIC) return;
+  if (get32(data + 4) != session) return; // old session or someone else
+
+  uint16_t seq = get16(data + 2);
+  heard = true;
+  lastHeard = nowUs;
+
+  switch (data[1]) {
+  case RUDP_DATA:
+    if (wasReceived(seq)) {
+      // acked again, previous ack was probably lost
+      sendControl(RUDP_ACK, seq);
+      stats.duplicates++;
+      return;
+    }
+
+    // acked only once it's queued, otherwise server retransmits it
+    if (!receiveFn(ctx, data + RUDP_HEADER_SIZE, len - RUDP_HEADER_SIZE)) {
+      stats.rejected++;
+      return;
+    }
+
+    markReceived(seq);
+    sendControl(RUDP_ACK, seq);
+    stats.received++;
+    break;
+  case RUDP_ACK:
+    onAck(seq, nowUs);
+    break;
+  case RUDP_HELLO:
+    sendControl(RUDP_HELLO_ACK, seq);
+    break;
+  default:
+    break;
+  }
+}
+
+void ReliableUdp::loop(uint32_t nowUs) {
+  if (!active) return;
+
+  for (int i = 0; i < RUDP_WINDOW; i++) {
+    Slot &s = window[i];
+    if (!s.used || nowUs - s.sentAt < s.timeout) continue;
+
+    if (s.retries >= RUDP_MAX_RETRIES) {
+      s.used = false;
+      stats.failed++;
+      continue;
+    }
+
+    s.retries++;
+    s.sentAt = nowUs;
+    s.timeout = s.timeout * 2 > RUDP_MAX_RTO * 1000UL ? RUDP_MAX_RTO * 1000UL : s.timeout * 2;
+    sendFn(ctx, s.data, s.len);
+    stats.retransmits++;
+  }
+
+  // faster hellos until server answers (it may not know our address yet)
+  uint32_t interval = heard ? RUDP_HELLO_INTERVAL * 1000UL : RUDP_INITIAL_RTO * 1000UL;
+  if (nowUs - lastHello >= interval) {
+    lastHello = nowUs;
+    sendControl(RUDP_HELLO, ++helloSeq);
+  }
+}
@@ -0,0 +1,102 @@
+#ifndef __RELIABLE_UDP_H__
+#define __RELIABLE_UDP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RUDP_MAGIC 0xF7
+#define RUDP_HEADER_SIZE 8
+#define RUDP_MAX_PAYLOAD 512 // fits into single datagram without ip fragmentation
+#define RUDP_WINDOW 8        // unacked frames in flight
+#define RUDP_INITIAL_RTO 250 // ms (until first rtt sample)
+#define RUDP_MIN_RTO 30
+#define RUDP_MAX_RTO 2000
+#define RUDP_MAX_RETRIES 5
+#define RUDP_HELLO_INTERVAL 5000
+#define RUDP_DEAD_TIME 15000 // channel is down without anything from server
+
+// Datagram: [magic(8) | type(8) | seq(16)] [session(32)] [payload], little endian
+enum RudpType : uint8_t {
+  RUDP_DATA = 1,      // payload - json text frame
+  RUDP_ACK = 2,       // seq of received data
+  RUDP_HELLO = 3,     // keepalive (and nat binding), seq - hello counter
+  RUDP_HELLO_ACK = 4,
+};
+
+struct RudpStats {
+  uint32_t sent = 0;
+  uint32_t received = 0;
+  uint32_t retransmits = 0;
+  uint32_t failed = 0;     // dropped after RUDP_MAX_RETRIES
+  uint32_t duplicates = 0; // received again (ack was lost)
+  uint32_t rejected = 0;   // receiver had no room, not acked (server retransmits)
+  uint32_t srtt = 0;       // us
+};
+
+// Sequence numbers, acks and retransmits for small frames over plain udp.
+// Frames are independent (delivered out of order, duplicates dropped), so
+// one lost datagram doesn't delay the others. Platform independent: socket
+// and clock (micros, may wrap) are supplied by caller, not thread safe.
+class ReliableUdp {
+  public:
+    typedef void (*SendFn)(void *ctx, const uint8_t *data, size_t len);
+    /// @return false if frame couldn't be queued (it isn't acked then)
+    typedef bool (*ReceiveFn)(void *ctx, const uint8_t *data, size_t len);
+
+    ReliableUdp(SendFn send, ReceiveFn receive, void *ctx);
+
+    /// @brief Starts new session (clears window and stats of previous one)
+    void start(uint32_t session, uint32_t nowUs);
+    void stop();
+
+    /// @return false if frame is too big or window is full
+    bool send(const uint8_t *data, size_t len, uint32_t nowUs);
+    void onDatagram(const uint8_t *data, size_t len, uint32_t nowUs);
+    /// @brief Retransmits and keepalive, call often (every few ms)
+    void loop(uint32_t nowUs);
+
+    /// @brief Server answered recently (frames should go through this channel)
+    bool up(uint32_t nowUs);
+    bool canSend(size_t len);
+    RudpStats stats;
+
+  private:
+    struct Slot {
+      bool used;
+      uint16_t seq;
+      uint8_t retries;
+      uint32_t sentAt;    // us, last (re)send
+      uint32_t timeout;   // us, rto with backoff
+      uint16_t len;
+      uint8_t data[RUDP_HEADER_SIZE + RUDP_MAX_PAYLOAD];
+    };
+
+    SendFn sendFn;
+    ReceiveFn receiveFn;
+    void *ctx;
+
+    bool active = false;
+    uint32_t session = 0;
+    uint16_t nextSeq = 1;
+    uint16_t helloSeq = 0;
+    uint32_t lastHello = 0;  // us
+    uint32_t lastHeard = 0;  // us, anything valid from server
+    bool heard = false;
+    uint32_t rttVar = 0;     // us
+    uint32_t rto = RUDP_INITIAL_RTO * 1000;
+
+    // received seqs (replay window like dtls), bit n - highestSeq - n
+    uint16_t highestSeq = 0;
+    uint32_t receivedMask = 0;
+    bool receivedAny = false;
+
+    Slot window[RUDP_WINDOW];
+
+    void writeHeader(uint8_t *out, RudpType type, uint16_t seq);
+    void sendControl(RudpType type, uint16_t seq);
+    bool wasReceived(uint16_t seq);
+    void markReceived(uint16_t seq);
+    void onAck(uint16_t seq, uint32_t nowUs);
+};
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef __TRANSPORT_H__
+#define __TRANSPORT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Channel to the server used by message layer (frames, requests, logs)
+class Transport {
+  public:
+    virtual ~Transport() {}
+
+    virtual const char *name() = 0;
+    virtual bool connected() = 0;
+    /// @brief Connected, but frame can't be queued now (sender keeps it and retries later)
+    virtual bool busy() { return false; }
+    /// @brief Sends single text frame (json), false if it couldn't be queued
+    virtual bool sendText(const uint8_t *data, size_t len) = 0;
+    /// @brief Sends single binary frame, false if it couldn't be queued (or transport has text frames only)
+    virtual bool sendBinary(const uint8_t */*data*/, size_t /*len*/) { return false; }
+    /// @brief Largest frame this transport can send
+    virtual size_t maxFrameSize() = 0;
+};
+
+#endif
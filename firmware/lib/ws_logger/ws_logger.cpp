@@ -1,5 +1,9 @@
 #include "ws_logger.h"
 
+#define RECORD_COMMITTED 0x01
+#define RECORD_HEADER_SIZE 8
+#define BUFFER_MASK (WS_LOGGER_BUFFER_SIZE - 1)
+
 unsigned long espId()
 {
     uint64_t efuse = ESP.getEfuseMac();
@@ -13,76 +17,369 @@ unsigned long espId()
     return (unsigned long)(efuse & 0x000000007FFFFFFF);
 }
 
+static inline uint32_t recordSize(uint32_t len)
+{
+    return RECORD_HEADER_SIZE + ((len + 3) & ~3u);
+}
+
 void WsLogger::begin(HardwareSerial *serial, unsigned long _sendInterval)
 {
     _serial = serial;
     sendInterval = _sendInterval;
 }
 
-void WsLogger::setWsClient(WebSocketsClient *_wsClient)
+void WsLogger::setTransport(Transport *_transport)
+{
+    transport = _transport;
+}
+
+void WsLogger::setClock(LogClock _clock)
 {
-    wsClient = _wsClient;
+    clock = _clock;
 }
 
-void WsLogger::setMaxSize(int logsSize)
+void WsLogger::setLevel(LogLevel level)
 {
-    maxLogsSize = logsSize;
+    minLevel = level;
 }
 
-// not implemented
 size_t WsLogger::write(uint8_t val)
 {
-    return 0;
+    return write(&val, 1);
 }
+
+/// @brief Pending line of given task (claims free one if task has none)
+/// @return NULL if every slot is taken
+WsLogger::PendingLine *WsLogger::claimLine(void *task)
+{
+    for (PendingLine &line : pendingLines)
+    {
+        if (line.owner.load(std::memory_order_acquire) == task)
+            return &line;
+    }
+
+    for (PendingLine &line : pendingLines)
+    {
+        void *expected = nullptr;
+        if (line.owner.compare_exchange_strong(expected, task, std::memory_order_acquire))
+            return &line;
+    }
+
+    return NULL;
+}
+
+/// @brief Appends to pending line of current task, record is logged at newline (or when line is full)
 size_t WsLogger::write(const uint8_t *buffer, size_t size)
 {
-    logData data;
-    data.millis = millis();
-    data.msg = String((const char *)buffer);
+    PendingLine *line = claimLine(xTaskGetCurrentTaskHandle());
+    if (line == NULL)
+    {
+        // too many unfinished lines, fragment is logged on its own
+        log(LOG_INFO, (const char *)buffer, size);
+        return size;
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        line->data[line->len++] = buffer[i];
+        if (buffer[i] == '\n' || line->len == sizeof(line->data))
+        {
+            log(LOG_INFO, line->data, line->len);
+            line->len = 0;
+        }
+    }
+
+    if (line->len == 0)
+        line->owner.store(nullptr, std::memory_order_release);
+
+    return size;
+}
+
+size_t WsLogger::vlogf(LogLevel level, const char *format, va_list arg)
+{
+    if (level < minLevel)
+        return 0;
+
+    char line[WS_LOGGER_MAX_LINE];
+    int len = vsnprintf(line, sizeof(line), format, arg);
+
+    if (len < 0)
+        return 0;
+    if ((size_t)len >= sizeof(line))
+        len = sizeof(line) - 1;
+
+    log(level, line, len);
+    return len;
+}
+
+void WsLogger::logf(LogLevel level, const char *format, ...)
+{
+    va_list arg;
+    va_start(arg, format);
+    vlogf(level, format, arg);
+    va_end(arg);
+}
+
+size_t WsLogger::printf(const char *format, ...)
+{
+    va_list arg;
+    va_start(arg, format);
+    size_t len = vlogf(LOG_INFO, format, arg);
+    va_end(arg);
+    return len;
+}
+
+/// @brief Appends record to ring buffer (lock free, safe to call from both cores)
+/// @return false if record was dropped (buffer full or level filtered)
+bool WsLogger::log(LogLevel level, const char *msg, size_t len)
+{
+    if (level < minLevel)
+        return false;
+
+    if (_serial != NULL)
+        writeSerial(msg, len);
+
+    if (len > WS_LOGGER_BUFFER_SIZE / 4)
+        len = WS_LOGGER_BUFFER_SIZE / 4;
+
+    uint32_t size = recordSize(len);
+    uint32_t pos = head.load(std::memory_order_relaxed);
+    do
+    {
+        // tail is only advanced by consumer, stale value only underestimates free space
+        uint32_t used = pos - __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+        if (used + size > WS_LOGGER_BUFFER_SIZE)
+        {
+            dropped++;
+            return false;
+        }
+    } while (!head.compare_exchange_weak(pos, pos + size, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    uint32_t msgPos = pos + RECORD_HEADER_SIZE;
+    *(uint32_t *)&buffer[(pos + 4) & BUFFER_MASK] = millis();
+
+    uint32_t first = WS_LOGGER_BUFFER_SIZE - (msgPos & BUFFER_MASK);
+    if (first >= len)
+    {
+        memcpy(&buffer[msgPos & BUFFER_MASK], msg, len);
+    }
+    else
+    {
+        memcpy(&buffer[msgPos & BUFFER_MASK], msg, first);
+        memcpy(&buffer[0], msg + first, len - first);
+    }
+
+    // header is written last, consumer stops at first uncommitted record
+    uint32_t header = (len << 16) | ((uint32_t)level << 8) | RECORD_COMMITTED;
+    __atomic_store_n((uint32_t *)&buffer[pos & BUFFER_MASK], header, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/// @brief Copies message into uart tx ring (never waits for uart, drops message when ring is full)
+void WsLogger::writeSerial(const char *msg, size_t len)
+{
+    uint32_t lost = serialDroppedPending.exchange(0);
+    if (lost > 0)
+    {
+        char note[48];
+        int n = snprintf(note, sizeof(note), "[logger] %lu lines dropped\n", (unsigned long)lost);
 
-    logs.push_back(data);
-    _serial->write(buffer, size);
+        if ((size_t)_serial->availableForWrite() >= n + len)
+            _serial->write((const uint8_t *)note, n);
+        else
+            serialDroppedPending += lost;
+    }
 
-    if (logs.size() > (unsigned)maxLogsSize)
-        logs.erase(logs.begin());
-    return 0;
+    if ((size_t)_serial->availableForWrite() < len)
+    {
+        serialDropped++;
+        serialDroppedPending++;
+        return;
+    }
+
+    _serial->write((const uint8_t *)msg, len);
 }
 
-/// @brief Loop method to send messages to ws
+bool WsLogger::readRecord(uint32_t pos, uint32_t &header, uint32_t &recordMillis)
+{
+    if (pos == head.load(std::memory_order_acquire))
+        return false;
+
+    header = __atomic_load_n((uint32_t *)&buffer[pos & BUFFER_MASK], __ATOMIC_ACQUIRE);
+    if ((header & RECORD_COMMITTED) == 0)
+        return false;
+
+    recordMillis = *(uint32_t *)&buffer[(pos + 4) & BUFFER_MASK];
+    return true;
+}
+
+/// @brief Clears consumed records and moves tail (so producers can reuse space)
+void WsLogger::release(uint32_t newTail)
+{
+    // whole region has to be zeroed, new headers can land anywhere inside it
+    while (tail != newTail)
+    {
+        uint32_t idx = tail & BUFFER_MASK;
+        uint32_t n = min(newTail - tail, (uint32_t)WS_LOGGER_BUFFER_SIZE - idx);
+        memset(&buffer[idx], 0, n);
+        __atomic_store_n(&tail, tail + n, __ATOMIC_RELEASE);
+    }
+}
+
+/// @brief Writes record as json object (escaped) into out
+/// @return written length or 0 if it doesn't fit
+size_t WsLogger::appendRecordJson(char *out, size_t outSize, uint32_t pos, uint32_t header, uint32_t recordMillis)
+{
+    uint32_t len = header >> 16;
+    uint8_t level = (header >> 8) & 0xFF;
+
+    int n = snprintf(out, outSize, "{\"millis\":%lu,\"level\":%u,\"msg\":\"", (unsigned long)recordMillis, level);
+    if (n < 0 || (size_t)n >= outSize)
+        return 0;
+
+    size_t w = n;
+    for (uint32_t i = 0; i < len; i++)
+    {
+        char c = buffer[(pos + RECORD_HEADER_SIZE + i) & BUFFER_MASK];
+        char esc[7];
+        size_t escLen = 0;
+
+        if (c == '"' || c == '\\')
+        {
+            esc[0] = '\\';
+            esc[1] = c;
+            escLen = 2;
+        }
+        else if (c == '\n')
+        {
+            memcpy(esc, "\\n", 2);
+            escLen = 2;
+        }
+        else if (c == '\r')
+        {
+            memcpy(esc, "\\r", 2);
+            escLen = 2;
+        }
+        else if ((uint8_t)c < 0x20)
+        {
+            escLen = snprintf(esc, sizeof(esc), "\\u%04x", (uint8_t)c);
+        }
+        else
+        {
+            esc[0] = c;
+            escLen = 1;
+        }
+
+        if (w + escLen + 2 >= outSize)
+            return 0;
+        memcpy(out + w, esc, escLen);
+        w += escLen;
+    }
+
+    out[w++] = '"';
+    out[w++] = '}';
+    return w;
+}
+
+/// @brief Loop method to send messages to ws (streams records in chunks)
 /// @param force If it should send messages without checking interval
 void WsLogger::loop(bool force)
 {
+    bool connected = transport != NULL && transport->connected();
+
+    // while disconnected keep only the newest logs (drop oldest records)
+    if (!connected && head.load(std::memory_order_acquire) - tail > WS_LOGGER_BUFFER_SIZE * 3 / 4)
+    {
+        uint32_t pos = tail, header, recordMillis;
+        while (pos - tail < WS_LOGGER_BUFFER_SIZE / 4 && readRecord(pos, header, recordMillis))
+        {
+            pos += recordSize(header >> 16);
+            dropped++;
+        }
+
+        release(pos);
+    }
+
+    // records are kept (not dropped like while disconnected), sent as soon as there is room
+    if (connected && transport->busy())
+        return;
+
     if (millis() - lastSent < sendInterval && !force)
         return;
     lastSent = millis();
 
-    if (logs.size() == 0 || wsClient == NULL || !wsClient->isConnected())
+    if (!connected)
         return;
-    JsonDocument logsArrDoc;
-    JsonArray arr = logsArrDoc.to<JsonArray>();
 
-    while (logs.size() > 0)
+    static char chunk[WS_LOGGER_CHUNK_SIZE];
+    const char *suffix = "]}}";
+    const size_t suffixLen = 3;
+
+    uint32_t pos = tail, header, recordMillis;
+    while (readRecord(pos, header, recordMillis))
     {
-        logData data = logs.back();
-        logs.pop_back();
+        uint32_t currentDropped = dropped.load();
+        uint32_t currentSuppressed = suppressed.load();
+        size_t len = snprintf(chunk, sizeof(chunk),
+                              "{\"logs\":{\"esp_id\":%lu,\"dropped\":%lu,\"suppressed\":%lu,\"serial_dropped\":%lu,", espId(),
+                              (unsigned long)(currentDropped - droppedReported),
+                              (unsigned long)(currentSuppressed - suppressedReported), (unsigned long)serialDropped.load());
 
-        JsonObject obj = arr.add<JsonObject>();
-        obj["millis"] = data.millis;
-        obj["msg"] = data.msg;
-    }
+        // records keep millis, server maps them to epoch by millis of the stamp
+        uint64_t epochMs;
+        uint32_t errMs;
+        if (clock != NULL && clock(epochMs, errMs))
+        {
+            len += snprintf(chunk + len, sizeof(chunk) - len, "\"epoch_ms\":%llu,\"err_ms\":%lu,\"millis\":%lu,",
+                            (unsigned long long)epochMs, (unsigned long)errMs, (unsigned long)millis());
+        }
 
-    JsonDocument doc;
-    doc["logs"]["esp_id"] = espId();
-    doc["logs"]["logs"] = logsArrDoc;
+        memcpy(chunk + len, "\"logs\":[", 8);
+        len += 8;
+        size_t records = 0;
 
-    if (wsClient != NULL)
-    {
-        String json;
-        serializeJson(doc, json);
-        wsClient->sendTXT(json);
-    }
+        while (readRecord(pos, header, recordMillis))
+        {
+            if (records > 0)
+                chunk[len++] = ',';
+
+            size_t w = appendRecordJson(chunk + len, sizeof(chunk) - len - suffixLen, pos, header, recordMillis);
+            if (w == 0)
+            {
+                if (records > 0)
+                {
+                    len--; // remove ','
+                    break;
+                }
 
-    logs.clear();
+                // single record bigger than chunk, skip it
+                pos += recordSize(header >> 16);
+                dropped++;
+                continue;
+            }
+
+            len += w;
+            records++;
+            pos += recordSize(header >> 16);
+        }
+
+        if (records == 0)
+        {
+            release(pos); // only oversized records were skipped
+            break;
+        }
+
+        memcpy(chunk + len, suffix, suffixLen);
+        len += suffixLen;
+
+        if (!transport->sendText((uint8_t *)chunk, len))
+            break;
+
+        droppedReported = currentDropped;
+        suppressedReported = currentSuppressed;
+        release(pos);
+    }
 }
 
-WsLogger Logger;
\ No newline at end of file
+WsLogger Logger;
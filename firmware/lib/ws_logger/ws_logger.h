@@ -1,38 +1,103 @@
 #ifndef __WS_LOGGER_H__
 #define __WS_LOGGER_H__
 
-#include <WebSocketsClient.h>
-#include <ArduinoJson.h>
-#include <vector>
+#include <Arduino.h>
+#include <transport.h>
+#include <atomic>
 
-struct logData {
-    unsigned long millis;
-    String msg;
+#define WS_LOGGER_BUFFER_SIZE 4096 // power of 2
+#define WS_LOGGER_CHUNK_SIZE 1024  // max size of single ws logs frame
+#define WS_LOGGER_MAX_LINE 192     // longer lines are truncated (logf only)
+#define WS_LOGGER_SERIAL_TX_BUFFER 4096 // uart tx ring size (drained by uart isr)
+#define WS_LOGGER_LINE_SLOTS 4     // tasks that can be in the middle of Print line at once
+
+enum LogLevel : uint8_t {
+    LOG_DEBUG = 0,
+    LOG_INFO = 1,
+    LOG_WARN = 2,
+    LOG_ERROR = 3
 };
 
+// Logs at most once per intervalMs from given call site (other calls are counted as suppressed)
+#define LOG_RATE_LIMITED(intervalMs, level, ...)                                   \
+    do                                                                             \
+    {                                                                              \
+        static unsigned long _logLastTime = 0;                                     \
+        static bool _logLogged = false;                                            \
+        if (!_logLogged || millis() - _logLastTime >= (intervalMs))                \
+        {                                                                          \
+            _logLogged = true;                                                     \
+            _logLastTime = millis();                                               \
+            Logger.logf((level), __VA_ARGS__);                                     \
+        }                                                                          \
+        else                                                                       \
+        {                                                                          \
+            Logger.suppressed++;                                                   \
+        }                                                                          \
+    } while (0)
+
+// Current epoch and its error bound (ms), false while clock isn't synced
+typedef bool (*LogClock)(uint64_t &epochMs, uint32_t &errMs);
+
+/// Fixed size ring buffer of log records. Record layout (4 byte aligned):
+/// [header: len(16) | level(8) | flags(8)] [millis(32)] [msg padded to 4 bytes]
+/// Producers reserve space with CAS on head, so logging is allocation free and
+/// can be called from both cores (and from time critical paths).
 class WsLogger : public Print {
   using Print::print;
-  
+
   public:
+    // serial tx buffer has to be set (setTxBufferSize) before serial->begin()
     void begin(HardwareSerial* serial, unsigned long _sendInterval = 5000);
     size_t write(uint8_t val) override;
     size_t write(const uint8_t *buffer, size_t size) override;
-    void setWsClient(WebSocketsClient* _wsClient);
-    void setMaxSize(int logsSize);
+    bool log(LogLevel level, const char *msg, size_t len);
+    void logf(LogLevel level, const char *format, ...) __attribute__((format(printf, 3, 4)));
+    // hides Print::printf (heap allocation for lines over 64 bytes), same as logf(LOG_INFO, ...)
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    void setLevel(LogLevel level);
+    void setTransport(Transport* _transport);
+    // logs frames are stamped with epoch_ms/err_ms (and millis they were taken at) like other frames
+    void setClock(LogClock _clock);
     void loop(bool force = false);
 
+    std::atomic<uint32_t> dropped{0};    // records that didn't fit into buffer
+    std::atomic<uint32_t> suppressed{0}; // records skipped by LOG_RATE_LIMITED
+    std::atomic<uint32_t> serialDropped{0}; // records not printed (uart tx buffer full)
+
   private:
-    HardwareSerial* _serial;
-    WebSocketsClient* wsClient;
+    HardwareSerial* _serial = NULL;
+
+    // Print writes (print, println, single bytes) are joined into one record per line,
+    // pending line belongs to task that started it (more tasks run on the same core)
+    struct PendingLine {
+        std::atomic<void *> owner{nullptr}; // TaskHandle_t, free slot when null
+        size_t len = 0;
+        char data[WS_LOGGER_MAX_LINE];
+    };
+    PendingLine pendingLines[WS_LOGGER_LINE_SLOTS];
+    Transport* transport = NULL;
+    LogClock clock = NULL;
 
     unsigned long lastSent = 0;
     unsigned long sendInterval = 5000;
-    int maxLogsSize = 100;
-    std::vector<logData> logs;
+    LogLevel minLevel = LOG_DEBUG;
+
+    alignas(4) uint8_t buffer[WS_LOGGER_BUFFER_SIZE];
+    std::atomic<uint32_t> head{0}; // reserve position (producers)
+    uint32_t tail = 0;             // read position (consumer - loop)
+    uint32_t droppedReported = 0;
+    uint32_t suppressedReported = 0;
+    std::atomic<uint32_t> serialDroppedPending{0};
 
-    void log(String msg);
+    PendingLine *claimLine(void *task);
+    void writeSerial(const char *msg, size_t len);
+    size_t vlogf(LogLevel level, const char *format, va_list arg);
+    bool readRecord(uint32_t pos, uint32_t &header, uint32_t &recordMillis);
+    void release(uint32_t newTail);
+    size_t appendRecordJson(char *out, size_t outSize, uint32_t pos, uint32_t header, uint32_t recordMillis);
 };
 
 extern WsLogger Logger;
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,118 @@
+#ifndef __BLACKBOX_HPP__
+#define __BLACKBOX_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <base64.h>
+#include <esp_system.h>
+#include "globals.hpp"
+#include "trace.hpp"
+#include "radio/frames.hpp"
+
+#define BLACKBOX_MAGIC 0xB1AC4B0A
+#define BLACKBOX_HEAP_INTERVAL 1000
+
+// Record kept in rtc slow memory, it survives panics, watchdog and brownout
+// resets, so after reboot we can tell what station was doing
+struct BlackBox {
+  uint32_t magic;
+  uint32_t uptime; // millis of last update
+  uint32_t freeHeap;
+  uint32_t minFreeHeap;
+  uint32_t maxAllocHeap;
+  int32_t stackmatTime;
+  uint8_t stackmatState;
+  uint8_t scene;
+};
+
+RTC_NOINIT_ATTR BlackBox blackBox;
+
+// Copy of previous boot record (valid only if blackBoxPending)
+BlackBox lastBlackBox;
+TraceEvent lastBlackBoxTrace[TRACE_RTC_SIZE];
+size_t lastBlackBoxTraceCount = 0;
+esp_reset_reason_t lastResetReason = ESP_RST_UNKNOWN;
+bool blackBoxPending = false;
+unsigned long lastBlackBoxHeap = 0;
+
+const char *resetReasonName(esp_reset_reason_t reason) {
+  switch (reason) {
+    case ESP_RST_POWERON: return "poweron";
+    case ESP_RST_EXT: return "external";
+    case ESP_RST_SW: return "software";
+    case ESP_RST_PANIC: return "panic";
+    case ESP_RST_INT_WDT: return "int_wdt";
+    case ESP_RST_TASK_WDT: return "task_wdt";
+    case ESP_RST_WDT: return "wdt";
+    case ESP_RST_DEEPSLEEP: return "deepsleep";
+    case ESP_RST_BROWNOUT: return "brownout";
+    case ESP_RST_SDIO: return "sdio";
+    default: return "unknown";
+  }
+}
+
+/// @brief Takes record of previous boot and starts new one (call at the beginning of setup)
+void blackBoxInit() {
+  lastResetReason = esp_reset_reason();
+
+  // after power on rtc memory contains garbage, deep sleep wake (standby) and
+  // ESP.restart() (ota, wifi reset, bt credentials) are intentional, not crashes
+  bool crashed = lastResetReason != ESP_RST_POWERON && lastResetReason != ESP_RST_DEEPSLEEP &&
+                 lastResetReason != ESP_RST_SW;
+  if (blackBox.magic == BLACKBOX_MAGIC && crashed) {
+    lastBlackBox = blackBox;
+
+    uint32_t head = traceRtcHead;
+    lastBlackBoxTraceCount = head < TRACE_RTC_SIZE ? head : TRACE_RTC_SIZE;
+    for (size_t i = 0; i < lastBlackBoxTraceCount; i++) {
+      lastBlackBoxTrace[i] = traceRtcRing[(head - lastBlackBoxTraceCount + i) % TRACE_RTC_SIZE];
+    }
+
+    blackBoxPending = true;
+  }
+
+  memset(&blackBox, 0, sizeof(blackBox));
+  traceRtcHead = 0;
+  blackBox.magic = BLACKBOX_MAGIC;
+}
+
+/// @brief Updates record, only a few stores (heap stats are read once per second)
+inline void blackBoxUpdate(uint8_t scene, uint8_t stackmatState, int32_t stackmatTime) {
+  blackBox.scene = scene;
+  blackBox.stackmatState = stackmatState;
+  blackBox.stackmatTime = stackmatTime;
+
+  unsigned long now = millis();
+  if (now - lastBlackBoxHeap < BLACKBOX_HEAP_INTERVAL) return;
+
+  blackBox.uptime = now;
+  blackBox.freeHeap = ESP.getFreeHeap();
+  blackBox.minFreeHeap = ESP.getMinFreeHeap();
+  blackBox.maxAllocHeap = ESP.getMaxAllocHeap();
+  lastBlackBoxHeap = now;
+}
+
+/// @brief Reports previous boot record to server (once)
+void sendBlackBox() {
+  if (!blackBoxPending) return;
+
+  JsonDocument doc;
+  JsonObject bb = doc["black_box"].to<JsonObject>();
+  bb["esp_id"] = getEspId();
+  bb["reset_reason"] = resetReasonName(lastResetReason);
+  bb["uptime"] = lastBlackBox.uptime;
+  bb["scene"] = lastBlackBox.scene;
+  bb["stackmat_state"] = lastBlackBox.stackmatState;
+  bb["stackmat_time"] = lastBlackBox.stackmatTime;
+  bb["heap"]["free"] = lastBlackBox.freeHeap;
+  bb["heap"]["min_free"] = lastBlackBox.minFreeHeap;
+  bb["heap"]["max_block"] = lastBlackBox.maxAllocHeap;
+
+  // same encoding as trace_dump (tools/trace_to_chrome.py)
+  bb["trace_count"] = lastBlackBoxTraceCount;
+  bb["trace"] = base64::encode((uint8_t *)lastBlackBoxTrace, lastBlackBoxTraceCount * sizeof(TraceEvent));
+
+  if (sendFrame(doc, OUT_TELEMETRY)) blackBoxPending = false;
+}
+
+#endif
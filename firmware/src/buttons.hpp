@@ -11,6 +11,10 @@
 
 AButtons buttons;
 
+void traceButtonEdge(Button &b, bool pressed) {
+  trace(TRACE_BUTTON, b.pins.at(0), pressed);
+}
+
 void delegateButtonHold(int holdTime) {
   if (state.currentScene == SCENE_ERROR) return;
   if (state.competitorCardId <= 0) return;
@@ -150,6 +154,8 @@ void inspectionButton(Button &b) {
 }
 
 void buttonsInit() {
+  buttons.setEdgeCb(traceButtonEdge);
+
   size_t delegateBtn =
       buttons.addButton(BUTTON4, NULL, delegateButtonAfterRelease);
   buttons.addButtonReocCb(delegateBtn, 1000, delegateButtonHold);
@@ -0,0 +1,177 @@
+#ifndef __CARD_CACHE_HPP__
+#define __CARD_CACHE_HPP__
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <ws_logger.h>
+#include "defines.h"
+#include "globals.hpp"
+
+struct CardInfo {
+  card_id_t cardId = 0; // 0 - empty entry
+  char display[128];
+  char countryIso2[3];
+  bool canCompete;
+  uint32_t lastUsed; // lru tick
+};
+
+CardInfo cardCache[CARD_CACHE_SIZE];
+uint32_t cardCacheTick = 0;
+uint32_t cardCacheEpoch = 0;
+bool cardCacheDirty = false;
+unsigned long cardCacheLastSave = 0;
+SemaphoreHandle_t cardCacheMutex = NULL; // read and saved on core 0, filled from responses on core 1
+CardInfo cardCacheHit; // scanned card found on core 0, applied on core 1 (cardCacheTakeHit)
+bool cardCacheHitPending = false;
+
+inline void cardCacheLock() {
+  xSemaphoreTake(cardCacheMutex, portMAX_DELAY);
+}
+
+inline void cardCacheUnlock() {
+  xSemaphoreGive(cardCacheMutex);
+}
+
+/// @brief Copies cached card info (and marks it as recently used)
+/// @return false if card is not cached
+bool cardCacheGet(card_id_t cardId, CardInfo &out) {
+  if (cardId == 0) return false;
+
+  bool found = false;
+  cardCacheLock();
+  for (int i = 0; i < CARD_CACHE_SIZE; i++) {
+    if (cardCache[i].cardId == cardId) {
+      cardCache[i].lastUsed = ++cardCacheTick;
+      out = cardCache[i];
+      found = true;
+      break;
+    }
+  }
+  cardCacheUnlock();
+
+  return found;
+}
+
+/// @brief Inserts or updates card info (evicts least recently used entry)
+/// @return true if cached entry was changed
+bool cardCachePut(card_id_t cardId, const char *display, const char *countryIso2, bool canCompete) {
+  if (cardId == 0) return false;
+
+  cardCacheLock();
+  CardInfo *entry = &cardCache[0];
+  for (int i = 0; i < CARD_CACHE_SIZE; i++) {
+    CardInfo &c = cardCache[i];
+    if (c.cardId == cardId) {
+      entry = &c;
+      break;
+    }
+
+    if (c.cardId == 0 && entry->cardId != 0) entry = &c;
+    else if (entry->cardId != 0 && c.lastUsed < entry->lastUsed) entry = &c;
+  }
+
+  bool changed = entry->cardId != cardId || entry->canCompete != canCompete ||
+                 strncmp(entry->display, display, sizeof(entry->display)) != 0 ||
+                 strncmp(entry->countryIso2, countryIso2, sizeof(entry->countryIso2)) != 0;
+
+  entry->cardId = cardId;
+  strncpy(entry->display, display, sizeof(entry->display) - 1);
+  entry->display[sizeof(entry->display) - 1] = '\0';
+  strncpy(entry->countryIso2, countryIso2, sizeof(entry->countryIso2) - 1);
+  entry->countryIso2[sizeof(entry->countryIso2) - 1] = '\0';
+  entry->canCompete = canCompete;
+  entry->lastUsed = ++cardCacheTick;
+
+  if (changed) cardCacheDirty = true;
+  cardCacheUnlock();
+  return changed;
+}
+
+/// @brief Hands cached info of scanned card over to core 1 (newer scan replaces older one)
+void cardCacheQueueHit(const CardInfo &info) {
+  cardCacheLock();
+  cardCacheHit = info;
+  cardCacheHitPending = true;
+  cardCacheUnlock();
+}
+
+/// @return false if no scanned card waits to be applied
+bool cardCacheTakeHit(CardInfo &out) {
+  cardCacheLock();
+  bool pending = cardCacheHitPending;
+  if (pending) out = cardCacheHit;
+  cardCacheHitPending = false;
+  cardCacheUnlock();
+
+  return pending;
+}
+
+void cardCacheClear() {
+  cardCacheLock();
+  for (int i = 0; i < CARD_CACHE_SIZE; i++) {
+    cardCache[i].cardId = 0;
+  }
+
+  cardCacheDirty = true;
+  cardCacheUnlock();
+}
+
+/// @brief Server sends cache epoch, every change of it invalidates whole cache
+void cardCacheSetEpoch(uint32_t epoch) {
+  if (epoch == 0 || epoch == cardCacheEpoch) return;
+
+  Logger.printf("Card cache epoch changed (%lu -> %lu), clearing cache\n", (unsigned long)cardCacheEpoch, (unsigned long)epoch);
+  cardCacheLock();
+  for (int i = 0; i < CARD_CACHE_SIZE; i++) {
+    cardCache[i].cardId = 0;
+  }
+
+  cardCacheEpoch = epoch;
+  cardCacheDirty = true;
+  cardCacheUnlock();
+}
+
+void cardCacheInit() {
+  cardCacheMutex = xSemaphoreCreateMutex();
+
+#ifdef CARD_CACHE_PERSIST
+  Preferences prefs;
+  if (!prefs.begin("card_cache", true)) return;
+
+  if (prefs.getBytesLength("entries") == sizeof(cardCache)) {
+    prefs.getBytes("entries", cardCache, sizeof(cardCache));
+    cardCacheEpoch = prefs.getUInt("epoch", 0);
+
+    // restore lru order
+    for (int i = 0; i < CARD_CACHE_SIZE; i++) {
+      if (cardCache[i].lastUsed > cardCacheTick) cardCacheTick = cardCache[i].lastUsed;
+    }
+  }
+
+  prefs.end();
+#endif
+}
+
+/// @brief Persists cache into flash (rate limited, only when it's safe to stall)
+/// @param idle true if station isn't timing anything right now
+void cardCacheLoop(bool idle) {
+#ifdef CARD_CACHE_PERSIST
+  if (!cardCacheDirty || !idle) return;
+  if (millis() - cardCacheLastSave < CARD_CACHE_SAVE_INTERVAL) return;
+
+  Preferences prefs;
+  if (!prefs.begin("card_cache", false)) return;
+
+  // held during write, only responses wait for it (station is idle)
+  cardCacheLock();
+  prefs.putBytes("entries", cardCache, sizeof(cardCache));
+  prefs.putUInt("epoch", cardCacheEpoch);
+  cardCacheDirty = false;
+  cardCacheUnlock();
+
+  prefs.end();
+  cardCacheLastSave = millis();
+#endif
+}
+
+#endif
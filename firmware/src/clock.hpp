@@ -0,0 +1,169 @@
+#ifndef __CLOCK_HPP__
+#define __CLOCK_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+#include "defines.h"
+
+#define CLOCK_SAMPLES 8 // last time_sync exchanges used for filtering
+#define CLOCK_SERVER_RESOLUTION 500 // us (server timestamps are in ms)
+#define CLOCK_DRIFT_BOUND 50e-6 // max crystal drift when drift is not measured yet
+#define CLOCK_DRIFT_ERROR 5e-6 // error of measured drift
+
+// NTP like exchange over websocket:
+// t0 - request sent (local), t1 - request received (server), t2 - response
+// sent (server), t3 - response received (local). Local time is esp_timer
+// (64 bit us since boot, never wraps), server time is epoch.
+struct ClockSample {
+  int64_t at;     // local us (t3)
+  int64_t offset; // epoch us - local us
+  int64_t delay;  // round trip without server processing (us)
+};
+
+ClockSample clockSamples[CLOCK_SAMPLES];
+uint8_t clockSamplesCount = 0;
+uint8_t clockSamplesNext = 0;
+
+bool clockSynced = false;
+int64_t clockOffset = 0; // epoch us - local us at clockRefAt
+int64_t clockRefAt = 0;
+int64_t clockErr = 0;    // error bound at clockRefAt (us)
+double clockDrift = 0;   // change of offset per local us
+bool clockDriftKnown = false;
+int64_t clockDriftRefAt = 0;
+int64_t clockDriftRefOffset = 0;
+
+int64_t clockLastSyncSent = 0;
+uint8_t clockBurstLeft = CLOCK_SYNC_BURST;
+
+inline int64_t clockLocalUs() {
+  return esp_timer_get_time();
+}
+
+/// @brief Epoch in us (0 if not synced yet)
+int64_t clockEpochUs() {
+  if (!clockSynced) return 0;
+
+  int64_t now = clockLocalUs();
+  return now + clockOffset + (int64_t)(clockDrift * (now - clockRefAt));
+}
+
+/// @brief Epoch in ms (0 if not synced yet)
+uint64_t clockEpochMs() {
+  return clockEpochUs() / 1000;
+}
+
+/// @brief Error bound of clockEpochMs (grows with time since last sync)
+uint32_t clockErrorMs() {
+  if (!clockSynced) return UINT32_MAX;
+
+  double driftErr = clockDriftKnown ? CLOCK_DRIFT_ERROR : CLOCK_DRIFT_BOUND;
+  int64_t err = clockErr + (int64_t)(driftErr * (clockLocalUs() - clockRefAt));
+  return (err + 999) / 1000;
+}
+
+/// @brief Sets clock from less precise source (epoch_time, rtc), ignored if current sync is better
+void clockSetEpoch(int64_t epochUs, int64_t errUs) {
+  if (clockSynced && (int64_t)clockErrorMs() * 1000 <= errUs) return;
+
+  clockRefAt = clockLocalUs();
+  clockOffset = epochUs - clockRefAt;
+  clockErr = errUs;
+  clockSynced = true;
+}
+
+void clockAddSample(int64_t t0, int64_t t1, int64_t t2, int64_t t3) {
+  ClockSample &s = clockSamples[clockSamplesNext];
+  s.at = t3;
+  s.offset = ((t1 - t0) + (t2 - t3)) / 2;
+  s.delay = max((int64_t)0, (t3 - t0) - (t2 - t1));
+
+  clockSamplesNext = (clockSamplesNext + 1) % CLOCK_SAMPLES;
+  if (clockSamplesCount < CLOCK_SAMPLES) clockSamplesCount++;
+
+  int64_t minDelay = INT64_MAX;
+  for (int i = 0; i < clockSamplesCount; i++) {
+    minDelay = min(minDelay, clockSamples[i].delay);
+  }
+
+  // samples with long round trip are mostly queueing delay (asymmetric),
+  // the rest is weighted by 1/delay^2, moved to current time with drift
+  double sum = 0, weights = 0;
+  for (int i = 0; i < clockSamplesCount; i++) {
+    ClockSample &c = clockSamples[i];
+    if (c.delay > 2 * minDelay + CLOCK_SERVER_RESOLUTION) continue;
+
+    double d = c.delay + CLOCK_SERVER_RESOLUTION;
+    double w = 1.0 / (d * d);
+    sum += w * (c.offset + clockDrift * (t3 - c.at));
+    weights += w;
+  }
+
+  int64_t offset = (int64_t)(sum / weights);
+
+  if (clockDriftRefAt == 0) {
+    clockDriftRefAt = t3;
+    clockDriftRefOffset = offset;
+  } else if (t3 - clockDriftRefAt > CLOCK_DRIFT_MIN_SPAN * 1000LL) {
+    double drift = (double)(offset - clockDriftRefOffset) / (t3 - clockDriftRefAt);
+    if (fabs(drift) < CLOCK_DRIFT_BOUND * 2) {
+      clockDrift = clockDriftKnown ? clockDrift * 0.7 + drift * 0.3 : drift;
+      clockDriftKnown = true;
+    }
+
+    clockDriftRefAt = t3;
+    clockDriftRefOffset = offset;
+  }
+
+  clockRefAt = t3;
+  clockOffset = offset;
+  clockErr = minDelay / 2 + CLOCK_SERVER_RESOLUTION;
+  clockSynced = true;
+}
+
+/// @brief Schedules time_sync requests (burst after connect, then periodic)
+/// @return true if request should be sent now
+bool clockSyncDue(bool connected) {
+  if (!connected) {
+    clockBurstLeft = CLOCK_SYNC_BURST; // resync quickly after reconnect
+    return false;
+  }
+
+  int64_t now = clockLocalUs();
+  int64_t interval = clockBurstLeft > 0 ? CLOCK_SYNC_BURST_INTERVAL : CLOCK_SYNC_INTERVAL;
+  if (clockLastSyncSent != 0 && now - clockLastSyncSent < interval * 1000LL) return false;
+
+  clockLastSyncSent = now;
+  if (clockBurstLeft > 0) clockBurstLeft--;
+  return true;
+}
+
+/// @brief Adds epoch and its error bound into outgoing frame
+void clockStamp(JsonObject obj) {
+  if (!clockSynced) return;
+
+  obj["epoch_ms"] = clockEpochMs();
+  obj["err_ms"] = clockErrorMs();
+}
+
+/// @brief Same stamp for logs frames (built by ws_logger without json document)
+bool clockLogStamp(uint64_t &epochMs, uint32_t &errMs) {
+  if (!clockSynced) return false;
+
+  epochMs = clockEpochMs();
+  errMs = clockErrorMs();
+  return true;
+}
+
+void addClockStats(JsonObject obj) {
+  obj["synced"] = clockSynced;
+  if (!clockSynced) return;
+
+  obj["err_ms"] = clockErrorMs();
+  obj["drift_ppm"] = clockDrift * 1e6;
+  obj["drift_known"] = clockDriftKnown;
+  obj["samples"] = clockSamplesCount;
+}
+
+#endif
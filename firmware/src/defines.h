@@ -7,7 +7,33 @@
 #define DIS_LENGTH 6
 
 #define SLEEP_TIME 600000 // 10mins
+#define STANDBY_TIME 3600000 // 1h idle -> deep sleep (counted from SLEEP_TIME)
+#define STANDBY_DRAIN_MIN_TIME 3600 // s of deep sleep needed to report standby drain
+#define BATTERY_CAPACITY_MAH 2500 // for standby current estimate
+#define WAKE_FAST_CONNECT_TIMEOUT 3000 // fall back to normal wifi connect after 3s
+// #define SLEEP_KEEP_WIFI // don't disconnect wifi and websocket before light sleep
 #define BATTERY_READ_INTERVAL 30000 // 30s
+#define BATTERY_SAMPLE_INTERVAL 100 // one adc sample per 100ms
+#define BATTERY_WINDOW 10 // samples per filtered value (max of window)
+#define BATTERY_EMA_ALPHA 0.2
+#define BATTERY_CHARGED_DELTA 5 // level rise (%) treated as charging
+#define BATTERY_RATE_MIN_TIME 1800000 // 30mins of samples before discharge rate is reported
+#define PM_MIN_CPU_FREQ 40 // MHz (xtal), esp_pm lowest frequency (wifi raises apb to 80 when it needs it)
+#define PM_MAX_CPU_FREQ 80 // MHz, board_build.f_cpu, solve and inspection (higher only draws more current)
+#define PM_TIMER_WAKE_HOLD 1500 // ms awake after jack line edge, until stackmat reports connected timer
+#define METRICS_INTERVAL 60000 // 1min
+#define TRACE_DUMP_CHUNK 64 // trace events per trace_dump frame
+#define STATE_STREAM_INTERVAL 250 // ms between state_delta frames (default for state_subscribe)
+#define STATE_STREAM_MIN_INTERVAL 100
+#define STATE_STREAM_KEYFRAME_INTERVAL 10000 // full state for late subscribers
+#define TIME_STREAM_INTERVAL 100 // ms between running time frames (default for time_stream)
+#define TIME_STREAM_MIN_INTERVAL 50
+
+#define RFID_POLL_INTERVAL 10
+#define RFID_LOW_POWER_POLL_INTERVAL 250
+#define RFID_LOW_POWER_TIME 30000 // 30s without lcd redraw
+#define RFID_ANTENNA_SETTLE_TIME 5 // time for card to power up after antenna on
+#define RFID_REQUEST_TIMEOUT 30 // MFRC522 timer fires after 25ms
 
 #define NAME_PREFIX "FkmTimer"
 #define WIFI_PASSWORD "FkmTimer"
@@ -22,4 +48,64 @@
 #define RESET_COMPETITOR_HOLD_TIME 3000 // on submit button (reset competitor and time)
 #define RESET_WIFI_HOLD_TIME 15000 // on submit button
 
+#define MAX_PENDING_REQUESTS 8
+#define SOLVE_REQUEST_TIMEOUT 2000 // doubled after every retry
+#define SOLVE_REQUEST_RETRIES 2
+#define SOLVE_REQUEST_OFFLINE_HOLD 60000 // solve waits for reconnect (wifi blip) before it fails
+#define DELEGATE_REQUEST_TIMEOUT 600000 // 10mins
+#define CARD_REQUEST_TIMEOUT 1500
+#define CARD_REQUEST_RETRIES 1
+
+#define CARD_CACHE_SIZE 16
+#define CARD_CACHE_PERSIST // comment out to keep card cache only in RAM
+#define CARD_CACHE_SAVE_INTERVAL 60000 // 1min
+
+#define HISTORY_LOG // comment out to disable solve history in flash
+#define HISTORY_PARTITION_SUBTYPE 0x40 // partitions.csv
+#define HISTORY_MAX_RECORDS 2048 // 64B records (index takes 6B of RAM per record), whole 0x20000 partition
+                                 // oldest sector is erased before reuse, so 1984-2048 newest solves are kept
+#define HISTORY_PENDING 8 // records waiting for idle station to be written
+#define HISTORY_EXPORT_CHUNK 8 // records per history frame
+
+#define CLOCK_SYNC_INTERVAL 60000 // 1min
+#define CLOCK_SYNC_BURST 4 // time_sync exchanges right after connect
+#define CLOCK_SYNC_BURST_INTERVAL 1000
+#define CLOCK_SYNC_TIMEOUT 5000 // responses with longer round trip are ignored
+#define CLOCK_DRIFT_MIN_SPAN 600000 // 10mins between drift measurements
+#define CLOCK_RTC_SLEEP_ERROR 0.005 // rtc slow clock error during deep sleep
+
+#define DISCOVERY_INTERVAL 300000 // 5mins between background mdns + rtt probes
+#define DISCOVERY_PROBES 3 // tcp connects per server (best one is used)
+#define DISCOVERY_PROBE_TIMEOUT 1000
+#define DISCOVERY_FAILOVER_TIME 5000 // switch server after 5s without connection
+#define DISCOVERY_RTT_MARGIN 20000 // us, switch when current connect rtt > 2 * best + margin
+
+#define LINK_PING_FAST 1000 // while waiting for solve/delegate response
+#define LINK_PING_NORMAL 10000
+#define LINK_PING_IDLE 30000 // stackmat disconnected
+#define LINK_PONG_TIMEOUT 2000
+#define LINK_WARN_RTT 150 // ms, link shown as degraded
+#define LINK_MAX_RTT 1000 // ms, reconnect above (smoothed rtt)
+#define LINK_MAX_LOSS 50 // %, reconnect above (last 16 pings)
+#define LINK_MAX_CONSECUTIVE_LOST 3
+#define LINK_RECONNECT_INTERVAL 1500
+#define LINK_RECONNECT_MAX_INTERVAL 15000 // reconnect backoff limit
+// #define LCD_LINK_STATUS // show rtt and loss instead of "Scan the card" when link is degraded
+
+// wss:// server verification, without any of these wss:// servers are refused
+// #define WS_TLS_CA // pinned CA certificate from src/ws_ca.h
+// #define WS_TLS_FINGERPRINT "AA:BB:..." // sha256 of server certificate (if no CA)
+// #define WS_TLS_INSECURE // connect to wss:// without verifying certificate (testing only)
+#define WS_CONNECT_BUDGET 8000 // ms, blocking tcp + tls connect inside webSocket.loop()
+#define OUTBOUND_TELEMETRY_RATE 2048 // bytes/s
+#define OUTBOUND_LOGS_RATE 1024 // bytes/s
+#define OUTBOUND_LOOP_BYTES 4096 // max queued bytes sent per loop()
+#define OUTBOUND_HOLD_MAX 1000 // telemetry and logs wait at most 1s for solve response
+#define TRANSPORT_UDP // offer udp for requests (used only if server answers with udp port, otherwise websocket)
+
+#define WATCHDOG_CHECK_INTERVAL 100
+#define WATCHDOG_LOOP_TIMEOUT 500 // max time between loop() heartbeats
+#define WATCHDOG_LOOP2_TIMEOUT 500 // max time between loop2() heartbeats
+// #define WATCHDOG_HW_ESCALATE 30000 // let task watchdog reboot esp after 30s stall (+ CONFIG_ESP_TASK_WDT_TIMEOUT_S)
+
 #endif
\ No newline at end of file
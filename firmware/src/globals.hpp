@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include <LiquidCrystal_I2C.h>
+#include <WebSocketsClient.h>
 #include <MFRC522v2.h>
 #include <MFRC522DriverSPI.h>
 #include <MFRC522DriverPinSimple.h>
@@ -10,6 +11,9 @@
 #include <stackmat.h>
 #include "defines.h"
 
+// Card UID (up to 8 bytes, longer UIDs are folded into it)
+typedef uint64_t card_id_t;
+
 float currentBatteryVoltage = 0.0;
 bool wifiConnected = false;
 bool primaryLangauge = false; // primary language is EN so non primary is PL
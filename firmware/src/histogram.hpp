@@ -0,0 +1,57 @@
+#ifndef __HISTOGRAM_HPP__
+#define __HISTOGRAM_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#define HISTOGRAM_BUCKETS 24 // log2 buckets of microseconds (up to ~16s)
+
+// Fixed size log2 histogram, adding a sample is a few instructions (no allocation)
+struct LatencyHistogram {
+  uint32_t buckets[HISTOGRAM_BUCKETS] = {0};
+  uint32_t count = 0;
+  uint32_t max = 0;
+  uint64_t sum = 0;
+
+  void add(uint32_t us) {
+    int bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+    if (bucket >= HISTOGRAM_BUCKETS) bucket = HISTOGRAM_BUCKETS - 1;
+
+    buckets[bucket]++;
+    count++;
+    sum += us;
+    if (us > max) max = us;
+  }
+
+  /// @brief Upper bound of bucket containing given percentile
+  uint32_t percentile(uint8_t p) {
+    if (count == 0) return 0;
+
+    uint32_t target = ((uint64_t)count * p + 99) / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+      seen += buckets[i];
+      if (seen >= target) return min((uint32_t)1 << i, max);
+    }
+
+    return max;
+  }
+
+  void reset() {
+    memset(buckets, 0, sizeof(buckets));
+    count = 0;
+    max = 0;
+    sum = 0;
+  }
+
+  void toJson(JsonObject obj) {
+    obj["n"] = count;
+    obj["avg"] = count > 0 ? (uint32_t)(sum / count) : 0;
+    obj["p50"] = percentile(50);
+    obj["p90"] = percentile(90);
+    obj["p99"] = percentile(99);
+    obj["max"] = max;
+  }
+};
+
+#endif
@@ -0,0 +1,490 @@
+#ifndef __HISTORY_HPP__
+#define __HISTORY_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_partition.h>
+#include <rom/crc.h>
+#include <ws_logger.h>
+#include "globals.hpp"
+#include "defines.h"
+#include "watchdog.hpp"
+#include "radio/frames.hpp"
+
+#define HISTORY_MAGIC 0xA7
+#define HISTORY_SECTOR_SIZE 4096
+#define HISTORY_UNCONFIRMED 0x01 // flag bit cleared in place when server confirms solve
+#define HISTORY_CRC_OFFSET 2     // magic and flags (changed in place) aren't covered by crc
+
+// Fixed size record, ring of them fills whole history partition (up to HISTORY_MAX_RECORDS).
+// Erased flash is 0xFF, bits can only be cleared without erasing sector
+struct __attribute__((packed)) HistoryRecord {
+  uint8_t magic;
+  uint8_t flags;
+  int8_t penalty;
+  uint8_t delegate;
+  uint32_t seq;
+  uint8_t sessionId[16]; // uuid without dashes
+  card_id_t competitorCardId;
+  card_id_t judgeCardId;
+  int32_t solveTime;
+  uint32_t inspectionTime;
+  uint64_t epochMs;
+  uint32_t crc;
+  uint32_t reserved; // 0xFFFFFFFF
+};
+
+static_assert(sizeof(HistoryRecord) == 64, "history record has to divide flash sector");
+
+enum HistoryOpType : uint8_t {
+  HISTORY_OP_APPEND,
+  HISTORY_OP_CONFIRM,
+};
+
+struct HistoryOp {
+  HistoryOpType type;
+  uint16_t slot; // confirm
+  HistoryRecord record; // append
+};
+
+const esp_partition_t *historyPartition = NULL;
+uint16_t historyCapacity = 0; // slots (multiple of records per sector)
+uint16_t historyHead = 0;     // next slot to write
+uint32_t historyNextSeq = 1;
+uint32_t historyFirstSeq = 1; // oldest seq still in flash
+
+// index sorted by key (first 4 bytes of session id), O(log n) lookup
+uint32_t historyKeys[HISTORY_MAX_RECORDS];
+uint16_t historySlots[HISTORY_MAX_RECORDS];
+uint16_t historyIndexCount = 0;
+
+// appends and confirms are written by historyLoop when station is idle
+HistoryOp historyOps[HISTORY_PENDING];
+uint8_t historyOpsHead = 0;
+uint8_t historyOpsCount = 0;
+SemaphoreHandle_t historyMutex = NULL; // appended on core 1, written on core 0
+
+// range export, sent chunk by chunk as telemetry queue has room
+bool historyExporting = false;
+uint32_t historyExportSeq = 0;
+uint32_t historyExportLeft = 0;
+bool historyExportUnconfirmed = false;
+
+uint32_t historyAppends = 0;
+uint32_t historyDropped = 0;
+uint32_t historyErases = 0;
+uint32_t historyErrors = 0;
+uint32_t historyMaxWriteUs = 0;
+
+inline void historyLock() {
+  xSemaphoreTake(historyMutex, portMAX_DELAY);
+}
+
+inline void historyUnlock() {
+  xSemaphoreGive(historyMutex);
+}
+
+/// @brief "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx" into 16 bytes
+bool historyParseUuid(const char *str, uint8_t *out) {
+  if (str == NULL) return false;
+
+  int n = 0;
+  for (const char *c = str; *c != '\0' && n < 32; c++) {
+    if (*c == '-') continue;
+    if (!isxdigit(*c)) return false;
+
+    uint8_t v = isdigit(*c) ? *c - '0' : (tolower(*c) - 'a' + 10);
+    out[n / 2] = (n % 2 == 0) ? v << 4 : out[n / 2] | v;
+    n++;
+  }
+
+  return n == 32;
+}
+
+String historyFormatUuid(const uint8_t *id) {
+  char buf[37];
+  snprintf(buf, sizeof(buf), "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+           id[0], id[1], id[2], id[3], id[4], id[5], id[6], id[7],
+           id[8], id[9], id[10], id[11], id[12], id[13], id[14], id[15]);
+  return String(buf);
+}
+
+inline uint32_t historyKey(const uint8_t *id) {
+  return (uint32_t)id[0] << 24 | (uint32_t)id[1] << 16 | (uint32_t)id[2] << 8 | id[3];
+}
+
+inline uint32_t historyCrc(const HistoryRecord &r) {
+  return crc32_le(0, (const uint8_t *)&r + HISTORY_CRC_OFFSET, offsetof(HistoryRecord, crc) - HISTORY_CRC_OFFSET);
+}
+
+bool historyRead(uint16_t slot, HistoryRecord &r) {
+  if (esp_partition_read(historyPartition, (size_t)slot * sizeof(HistoryRecord), &r, sizeof(r)) != ESP_OK) return false;
+  return r.magic == HISTORY_MAGIC && r.crc == historyCrc(r);
+}
+
+/// @brief First index entry with key >= given one
+uint16_t historyLowerBound(uint32_t key) {
+  uint16_t lo = 0, hi = historyIndexCount;
+  while (lo < hi) {
+    uint16_t mid = (lo + hi) / 2;
+    if (historyKeys[mid] < key) lo = mid + 1;
+    else hi = mid;
+  }
+
+  return lo;
+}
+
+void historyIndexInsert(uint32_t key, uint16_t slot) {
+  if (historyIndexCount >= HISTORY_MAX_RECORDS) return;
+
+  uint16_t i = historyLowerBound(key);
+  memmove(&historyKeys[i + 1], &historyKeys[i], (historyIndexCount - i) * sizeof(historyKeys[0]));
+  memmove(&historySlots[i + 1], &historySlots[i], (historyIndexCount - i) * sizeof(historySlots[0]));
+  historyKeys[i] = key;
+  historySlots[i] = slot;
+  historyIndexCount++;
+}
+
+/// @brief Removes index entries pointing into slots [from, to)
+void historyIndexRemove(uint16_t from, uint16_t to) {
+  uint16_t n = 0;
+  for (uint16_t i = 0; i < historyIndexCount; i++) {
+    if (historySlots[i] >= from && historySlots[i] < to) continue;
+
+    historyKeys[n] = historyKeys[i];
+    historySlots[n] = historySlots[i];
+    n++;
+  }
+
+  historyIndexCount = n;
+}
+
+/// @brief Slot of record with given seq (records are written to consecutive slots)
+inline uint16_t historySlotOf(uint32_t seq) {
+  uint32_t back = historyNextSeq - seq;
+  return (historyHead + historyCapacity - back % historyCapacity) % historyCapacity;
+}
+
+/// @brief Finds history partition and rebuilds index from flash (boot only, reads whole partition)
+void historyInit() {
+  historyMutex = xSemaphoreCreateMutex();
+#ifdef HISTORY_LOG
+  historyPartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)HISTORY_PARTITION_SUBTYPE, "history");
+  if (historyPartition == NULL) {
+    // stations updated over ota keep old partition table, unused spiffs is at the same place
+    historyPartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, "spiffs");
+  }
+
+  if (historyPartition == NULL) {
+    Logger.logf(LOG_WARN, "[history] no history partition, solve history disabled\n");
+    return;
+  }
+
+  uint32_t slots = (historyPartition->size / HISTORY_SECTOR_SIZE) * (HISTORY_SECTOR_SIZE / sizeof(HistoryRecord));
+  historyCapacity = min(slots, (uint32_t)HISTORY_MAX_RECORDS) / (HISTORY_SECTOR_SIZE / sizeof(HistoryRecord)) *
+                    (HISTORY_SECTOR_SIZE / sizeof(HistoryRecord));
+
+  unsigned long start = millis();
+  uint32_t maxSeq = 0;
+  uint32_t minSeq = UINT32_MAX;
+  uint16_t maxSlot = historyCapacity - 1;
+  HistoryRecord r;
+  for (uint16_t slot = 0; slot < historyCapacity; slot++) {
+    if (!historyRead(slot, r)) continue;
+
+    historyIndexInsert(historyKey(r.sessionId), slot);
+    if (r.seq < minSeq) minSeq = r.seq;
+    if (r.seq > maxSeq) {
+      maxSeq = r.seq;
+      maxSlot = slot;
+    }
+  }
+
+  historyHead = (maxSlot + 1) % historyCapacity;
+  historyNextSeq = maxSeq + 1;
+  historyFirstSeq = historyIndexCount > 0 ? minSeq : historyNextSeq;
+
+  Logger.printf("[history] %u/%u records (seq %lu-%lu, %s, loaded in %lu ms)\n", historyIndexCount, historyCapacity,
+                (unsigned long)historyFirstSeq, (unsigned long)maxSeq, historyPartition->label, millis() - start);
+#endif
+}
+
+void historyPush(const HistoryOp &op) {
+  historyLock();
+  if (historyOpsCount >= HISTORY_PENDING) {
+    historyOpsHead = (historyOpsHead + 1) % HISTORY_PENDING;
+    historyOpsCount--;
+    historyDropped++;
+  }
+
+  historyOps[(historyOpsHead + historyOpsCount) % HISTORY_PENDING] = op;
+  historyOpsCount++;
+  historyUnlock();
+}
+
+/// @brief Queues solve record (written later by historyLoop, never touches flash)
+void historyAppend(const char *sessionId, card_id_t competitorCardId, card_id_t judgeCardId, int solveTime,
+                   int penalty, uint32_t inspectionTime, bool delegate, uint64_t epochMs) {
+  if (historyPartition == NULL) return;
+
+  HistoryOp op;
+  op.type = HISTORY_OP_APPEND;
+  HistoryRecord &r = op.record;
+  memset(&r, 0xFF, sizeof(r));
+  if (!historyParseUuid(sessionId, r.sessionId)) return;
+
+  r.magic = HISTORY_MAGIC;
+  r.flags = 0xFF; // unconfirmed
+  r.penalty = penalty;
+  r.delegate = delegate;
+  r.competitorCardId = competitorCardId;
+  r.judgeCardId = judgeCardId;
+  r.solveTime = solveTime;
+  r.inspectionTime = inspectionTime;
+  r.epochMs = epochMs;
+  historyPush(op);
+  historyAppends++;
+}
+
+/// @brief Finds newest record of session (pending ones included)
+/// @param slot set to flash slot of record (UINT16_MAX if it isn't written yet)
+/// @return false if session isn't in history
+bool historyFind(const uint8_t *sessionId, HistoryRecord &out, uint16_t *slot = NULL) {
+  bool found = false;
+  uint16_t foundSlot = UINT16_MAX;
+
+  historyLock();
+  for (int i = historyOpsCount - 1; i >= 0; i--) {
+    HistoryOp &op = historyOps[(historyOpsHead + i) % HISTORY_PENDING];
+    if (op.type != HISTORY_OP_APPEND || memcmp(op.record.sessionId, sessionId, 16) != 0) continue;
+
+    out = op.record;
+    found = true;
+    break;
+  }
+
+  // resubmitted solve has more records, newest one wins
+  uint32_t key = historyKey(sessionId);
+  HistoryRecord r;
+  for (uint16_t i = historyLowerBound(key); !found || foundSlot != UINT16_MAX; i++) {
+    if (i >= historyIndexCount || historyKeys[i] != key) break;
+    if (!historyRead(historySlots[i], r) || memcmp(r.sessionId, sessionId, 16) != 0) continue;
+    if (found && r.seq < out.seq) continue;
+
+    out = r;
+    foundSlot = historySlots[i];
+    found = true;
+  }
+  historyUnlock();
+
+  if (slot != NULL) *slot = foundSlot;
+  return found;
+}
+
+/// @brief Server confirmed solve, clears unconfirmed bit (deferred flash write)
+void historyConfirm(const char *sessionId) {
+  if (historyPartition == NULL) return;
+
+  HistoryOp op;
+  if (!historyParseUuid(sessionId, op.record.sessionId)) return;
+
+  // still waiting for write
+  historyLock();
+  bool pending = false;
+  for (int i = 0; i < historyOpsCount; i++) {
+    HistoryOp &p = historyOps[(historyOpsHead + i) % HISTORY_PENDING];
+    if (p.type != HISTORY_OP_APPEND || memcmp(p.record.sessionId, op.record.sessionId, 16) != 0) continue;
+
+    p.record.flags &= ~HISTORY_UNCONFIRMED;
+    pending = true;
+  }
+  historyUnlock();
+  if (pending) return;
+
+  op.type = HISTORY_OP_CONFIRM;
+  op.slot = UINT16_MAX;
+  if (!historyFind(op.record.sessionId, op.record, &op.slot) || op.slot == UINT16_MAX) return;
+  if ((op.record.flags & HISTORY_UNCONFIRMED) == 0) return;
+
+  historyPush(op);
+}
+
+bool historyWrite(HistoryOp &op) {
+  unsigned long start = micros();
+  esp_err_t err = ESP_OK;
+
+  if (op.type == HISTORY_OP_CONFIRM) {
+    uint8_t flags = op.record.flags & ~HISTORY_UNCONFIRMED;
+    err = esp_partition_write(historyPartition, (size_t)op.slot * sizeof(HistoryRecord) + offsetof(HistoryRecord, flags),
+                              &flags, 1);
+  } else {
+    uint16_t perSector = HISTORY_SECTOR_SIZE / sizeof(HistoryRecord);
+    if (historyHead % perSector == 0) {
+      // oldest sector makes room for next records
+      WATCHDOG_SECTION(SECTION_HISTORY);
+      err = esp_partition_erase_range(historyPartition, (size_t)historyHead * sizeof(HistoryRecord), HISTORY_SECTOR_SIZE);
+      if (err != ESP_OK) {
+        historyErrors++;
+        return false;
+      }
+
+      historyLock();
+      historyIndexRemove(historyHead, historyHead + perSector);
+      // erased sector held oldest seqs once ring wrapped
+      if (historyNextSeq + perSector > historyCapacity) {
+        historyFirstSeq = max(historyFirstSeq, historyNextSeq + perSector - historyCapacity);
+      }
+      historyUnlock();
+      historyErases++;
+    }
+
+    op.record.seq = historyNextSeq;
+    op.record.crc = historyCrc(op.record);
+    err = esp_partition_write(historyPartition, (size_t)historyHead * sizeof(HistoryRecord), &op.record, sizeof(HistoryRecord));
+
+    // slot is used even after failed write (keeps seq -> slot mapping)
+    historyLock();
+    if (err == ESP_OK) historyIndexInsert(historyKey(op.record.sessionId), historyHead);
+    historyHead = (historyHead + 1) % historyCapacity;
+    historyNextSeq++;
+    historyUnlock();
+  }
+
+  uint32_t took = micros() - start;
+  if (took > historyMaxWriteUs) historyMaxWriteUs = took;
+
+  if (err != ESP_OK) {
+    historyErrors++;
+    return false;
+  }
+  return true;
+}
+
+/// @brief Writes queued records into flash (one per call, only when it's safe to stall)
+/// @param idle true if station isn't timing anything right now
+void historyLoop(bool idle) {
+#ifdef HISTORY_LOG
+  if (historyPartition == NULL || historyOpsCount == 0 || !idle) return;
+
+  historyLock();
+  HistoryOp op = historyOps[historyOpsHead];
+  historyOpsHead = (historyOpsHead + 1) % HISTORY_PENDING;
+  historyOpsCount--;
+  historyUnlock();
+
+  if (!historyWrite(op)) {
+    Logger.logf(LOG_ERROR, "[history] flash write failed (slot %u)\n", historyHead);
+  }
+#endif
+}
+
+void historyToJson(const HistoryRecord &r, JsonObject obj) {
+  obj["seq"] = r.seq;
+  obj["session_id"] = historyFormatUuid(r.sessionId);
+  obj["competitor_id"] = r.competitorCardId;
+  obj["judge_id"] = r.judgeCardId;
+  obj["solve_time"] = r.solveTime;
+  obj["penalty"] = r.penalty;
+  obj["inspection_time"] = r.inspectionTime;
+  obj["delegate"] = r.delegate != 0;
+  obj["timestamp_ms"] = r.epochMs;
+  obj["confirmed"] = (r.flags & HISTORY_UNCONFIRMED) == 0;
+}
+
+/// @brief Seqs in flash (written by historyWrite on core 0)
+void historySeqRange(uint32_t &first, uint32_t &next) {
+  historyLock();
+  first = historyFirstSeq;
+  next = historyNextSeq;
+  historyUnlock();
+}
+
+void historyFrameHeader(JsonObject obj) {
+  uint32_t first, next;
+  historySeqRange(first, next);
+  obj["esp_id"] = getEspId();
+  obj["first_seq"] = first;
+  obj["next_seq"] = next;
+  obj["capacity"] = historyCapacity;
+}
+
+/// @brief {"history_request": {"esp_id", "session_id"}} or {"history_request": {"esp_id", "from_seq", "count", "unconfirmed"}}
+void parseHistoryRequest(JsonObject doc) {
+  if (doc["esp_id"] != getEspId()) return;
+
+  if (doc.containsKey("session_id")) {
+    JsonDocument res;
+    JsonObject obj = res["history"].to<JsonObject>();
+    historyFrameHeader(obj);
+    obj["session_id"] = doc["session_id"];
+    JsonArray records = obj["records"].to<JsonArray>();
+
+    uint8_t id[16];
+    HistoryRecord r;
+    if (historyPartition != NULL && historyParseUuid(doc["session_id"], id) && historyFind(id, r)) {
+      historyToJson(r, records.add<JsonObject>());
+    }
+
+    sendFrame(res);
+    return;
+  }
+
+  uint32_t first, next;
+  historySeqRange(first, next);
+  historyExportSeq = max((uint32_t)(doc["from_seq"] | 0), first);
+  historyExportLeft = doc["count"] | (uint32_t)historyCapacity;
+  historyExportUnconfirmed = doc["unconfirmed"] | false;
+  historyExporting = true;
+}
+
+/// @brief Sends one chunk of requested range (when telemetry queue has room)
+void historyExportLoop() {
+  if (!historyExporting || !outboundHasRoom(OUT_TELEMETRY)) return;
+
+  JsonDocument doc;
+  JsonObject obj = doc["history"].to<JsonObject>();
+  historyFrameHeader(obj);
+  JsonArray records = obj["records"].to<JsonArray>();
+
+  HistoryRecord r;
+  int read = 0;
+  uint32_t first, next;
+  historySeqRange(first, next);
+  if (historyExportSeq < first) historyExportSeq = first; // overwritten meanwhile
+  while (historyPartition != NULL && historyExportLeft > 0 && historyExportSeq < next && read < HISTORY_EXPORT_CHUNK * 4) {
+    uint32_t seq = historyExportSeq++;
+    read++;
+
+    // slot can be erased and rewritten right after, seq check and crc catch that
+    historyLock();
+    bool written = seq >= historyFirstSeq;
+    uint16_t slot = historySlotOf(seq);
+    historyUnlock();
+    if (!written || !historyRead(slot, r) || r.seq != seq) continue;
+    if (historyExportUnconfirmed && (r.flags & HISTORY_UNCONFIRMED) == 0) continue;
+
+    historyToJson(r, records.add<JsonObject>());
+    historyExportLeft--;
+    if (records.size() >= HISTORY_EXPORT_CHUNK) break;
+  }
+
+  bool done = historyPartition == NULL || historyExportLeft == 0 || historyExportSeq >= next;
+  obj["from_seq"] = historyExportSeq; // continue from here (if not done)
+  obj["done"] = done;
+  if (done) historyExporting = false;
+
+  sendFrame(doc, OUT_TELEMETRY);
+}
+
+void addHistoryStats(JsonObject obj) {
+  obj["records"] = historyIndexCount;
+  obj["capacity"] = historyCapacity;
+  obj["pending"] = historyOpsCount;
+  obj["appends"] = historyAppends;
+  obj["dropped"] = historyDropped;
+  obj["erases"] = historyErases;
+  obj["errors"] = historyErrors;
+  obj["max_write_us"] = historyMaxWriteUs;
+}
+
+#endif
@@ -6,6 +6,10 @@
 #define SCROLLER_SETBACK 1000
 
 #include "defines.h"
+#include "histogram.hpp"
+#include "probes.hpp"
+#include "trace.hpp"
+#include "watchdog.hpp"
 
 int mainCoreId = -1;
 char scrollerBuff[MAX_SCROLLER_LINE];
@@ -22,6 +26,7 @@ int x, y = 0;
 bool lcdWriteLock = false;
 bool lcdHasChanged = true;
 unsigned long lcdLastDraw = 0;
+LatencyHistogram lcdDrawHistogram; // i2c time of redraws that changed something
 
 enum PrintAligment {
   ALIGN_LEFT = 0,
@@ -39,6 +44,9 @@ void lcdScroller(int line, const char *str);
 void scrollLoop();
 
 inline void waitForLock() {
+  if (!lcdWriteLock) return;
+
+  WATCHDOG_SECTION(SECTION_LCD_LOCK);
   while(lcdWriteLock) { delay(1); }
 }
 
@@ -70,6 +78,8 @@ void printLcdBuff(bool force) {
   waitForLock();
   lcdWriteLock = true;
 
+  unsigned long drawStart = micros();
+  bool drawn = false;
   for(int y = 0; y < LCD_SIZE_Y; y++) {
     int lastX = 0;
     lcd.setCursor(0, y);
@@ -81,10 +91,17 @@ void printLcdBuff(bool force) {
 
         shownBuff[y][x] = lcdBuff[y][x];
         lastX = x;
+        drawn = true;
       }
     }
   }
 
+  if (drawn) {
+    unsigned long drawTime = micros() - drawStart;
+    lcdDrawHistogram.add(drawTime);
+    trace(TRACE_LCD_FLUSH, 0, drawTime);
+  }
+  PROBE_END(PROBE_FINISH_LCD);
   lcdLastDraw = millis();
   lcdWriteLock = false;
 }
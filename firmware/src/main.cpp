@@ -15,16 +15,22 @@
 #include "buttons.hpp"
 #include "state.hpp"
 #include "radio/radio.hpp"
+#include "rfid.hpp"
+#include "watchdog.hpp"
+#include "blackbox.hpp"
+#include "power.hpp"
+#include "standby.hpp"
 #include <stackmat.h>
 
 void core2(void *pvParameters);
 inline void loop2();
-void rfidLoop();
 void sleepDetection();
 void stackmatLoop();
 
 void setup() {
   WRITE_PERI_REG(RTC_CNTL_BROWN_OUT_REG, 0);
+  blackBoxInit();
+  standbyInit();
 
   pinMode(BUTTON1, INPUT_PULLUP);
   pinMode(BUTTON2, INPUT_PULLUP);
@@ -35,21 +41,28 @@ void setup() {
   pinMode(DIS_STCP, OUTPUT);
   pinMode(DIS_SHCP, OUTPUT);
 
+  Serial.setTxBufferSize(WS_LOGGER_SERIAL_TX_BUFFER); // logger never waits for uart
   Serial.begin(115200);
   Logger.begin(&Serial);
   EEPROM.begin(128);
   Wire.begin(LCD_SDA, LCD_SCL);
   readState();
+  requestsInit();
+  outboundInit();
+  cardCacheInit();
+  historyInit();
   clearDisplay(0);
   lcdInit();
 
   delay(100);
-  currentBatteryVoltage = readBatteryVoltage(BAT_ADC, 15);
+  batteryInit(BAT_ADC);
+  currentBatteryVoltage = batteryVoltage();
   float initialBat = roundf(voltageToPercentage(currentBatteryVoltage));
 
   Logger.printf("ESP ID: %x\n", getEspId());
   Logger.printf("Current firmware version: %s\n", FIRMWARE_VERSION);
   Logger.printf("Build time: %s\n", BUILD_TIME);
+  Logger.printf("Reset reason: %s\n", resetReasonName(lastResetReason));
   Logger.printf("Battery: %f%% (%fv)\n", initialBat, currentBatteryVoltage);
 
   lcdPrintf(0, true, ALIGN_LEFT, "ID: %x", getEspId());
@@ -59,11 +72,13 @@ void setup() {
   Serial1.begin(STACKMAT_TIMER_BAUD_RATE, SERIAL_8N1, STACKMAT_JACK, 255, false);
   stackmat.begin(&Serial1);
   SPI.begin(RFID_SCK, RFID_MISO, RFID_MOSI);
+  powerInit();
 
   buttonsInit();
-  mfrc522.PCD_Init();
+  rfidInit();
   
-  initWifi();
+  if (!standbyFastConnect()) initWifi();
+  discoveryInit();
   lcdClear();
   clearDisplay();
 
@@ -71,30 +86,61 @@ void setup() {
   // DATA INSIDE Serial BUFFER, SO IT WILL FIX IT
   while(Serial1.available()) { Serial1.read(); } 
 
+  watchdogRegister(WDT_LOOP, WATCHDOG_LOOP_TIMEOUT);
+  watchdogInit();
+
   initState();
-  xTaskCreatePinnedToCore(core2, "core2", 10000, NULL, 0, NULL, 0);
+  if (standbyResumed) standbyRestoreState();
+  xTaskCreatePinnedToCore(core2, "core2", 10000, NULL, 0, &core2Task, 0);
   WRITE_PERI_REG(RTC_CNTL_BROWN_OUT_REG, 1);
 }
 
 void loop() {
+  watchdogFeed();
+  powerLoop(state.currentScene == SCENE_INSPECTION || state.currentScene == SCENE_TIMER_TIME || stackmat.state() == ST_Running,
+            update || hasPendingRequest(REQUEST_SOLVE) || hasPendingRequest(REQUEST_CARD_INFO),
+            stackmat.connected(), state.currentScene <= SCENE_WAITING_FOR_COMPETITOR);
+
   if (update) {
-    webSocket.loop();
+    wsLoop();
     return;
   }
 
+  unsigned long loopStart = micros();
+  scannedCardLoop(); // non blocking
   stateLoop();      // non blocking
+  watchdogLoop();   // non blocking
+  stateStreamLoop(); // non blocking
+  historyExportLoop(); // non blocking
+  wakeLoop();       // non blocking
+  clockLoop();      // non blocking
+  linkLoop(waitForSolveResponse || waitForDelegateResponse, !stackmat.connected()); // non blocking
+  discoveryLoop(state.currentScene <= SCENE_WAITING_FOR_COMPETITOR && !hasPendingRequest(REQUEST_ANY)); // non blocking
+  standbyLoop();    // non blocking
+  requestsLoop();   // non blocking
   lcdLoop();        // non blocking
   Logger.loop();    // non blocking
-  webSocket.loop(); // non blocking
-  stackmat.loop();  // non blocking
+  outboundLoop(hasPendingRequest(REQUEST_SOLVE) || hasPendingRequest(REQUEST_DELEGATE)); // non blocking
+  wsLoop();         // non blocking (tcp + tls connect when disconnected)
+  transportLoop();  // non blocking
+  {
+    WATCHDOG_SECTION(SECTION_STACKMAT);
+    stackmat.loop(); // waits for whole frame (up to 1s)
+  }
   stackmatLoop();   // non blocking
+  blackBoxUpdate(state.currentScene, stackmat.state(), stackmat.time());
+
+  loopHistogram.add(micros() - loopStart);
 
   sleepDetection();
+  metricsLoop();
 
   delay(5);
 }
 
 void core2(void *pvParameters) {
+  watchdogRegister(WDT_LOOP2, WATCHDOG_LOOP2_TIMEOUT);
+
   while (1) {
     loop2();
   }
@@ -102,41 +148,35 @@ void core2(void *pvParameters) {
 
 unsigned long lastBatRead = 0;
 inline void loop2() {
+  watchdogFeed();
   if (update) return; // return if update'ing
 
-  rfidLoop();     // blocking (when card is close to scanner)
-  buttons.loop(); // blocking
+  unsigned long loopStart = micros();
+  {
+    PowerSpiScope spi;
+    rfidLoop(millis() - lcdLastDraw > RFID_LOW_POWER_TIME); // non blocking
+  }
+  {
+    WATCHDOG_SECTION(SECTION_BUTTONS);
+    buttons.loop(); // blocking
+  }
+  cardCacheLoop(state.currentScene <= SCENE_WAITING_FOR_COMPETITOR);
+  historyLoop(state.currentScene <= SCENE_WAITING_FOR_COMPETITOR && stackmat.state() != ST_Running);
+  batteryLoop(BAT_ADC); // non blocking
 
   if (millis() - lastBatRead > BATTERY_READ_INTERVAL) {
-    currentBatteryVoltage = readBatteryVoltage(BAT_ADC, 15);
+    currentBatteryVoltage = batteryVoltage();
     float batPerct = voltageToPercentage(currentBatteryVoltage);
+    powerBatterySample(batPerct);
 
     sendBatteryStats(batPerct, currentBatteryVoltage);
     lastBatRead = millis();
   }
 
+  loop2Histogram.add(micros() - loopStart);
   delay(10);
 }
 
-// TODO: maybe move it into own file?
-unsigned long lastCardReadTime = 0;
-unsigned long lastCardId = 0;
-void rfidLoop() {
-  if (millis() - lastCardReadTime < 500) return;
-  if (!mfrc522.PICC_IsNewCardPresent()) return;
-  if (!mfrc522.PICC_ReadCardSerial()) return;
-
-  unsigned long cardId = mfrc522.uid.uidByte[0] + (mfrc522.uid.uidByte[1] << 8) + (mfrc522.uid.uidByte[2] << 16) + (mfrc522.uid.uidByte[3] << 24);
-  if (lastCardId == cardId && millis() - lastCardReadTime < 2500) return; // if same as last card (in 2.5s)
-
-  Logger.printf("Scanned card ID: %lu\n", cardId);
-  scanCard(cardId);
-  lastCardId = cardId;
-
-  mfrc522.PICC_HaltA();
-  lastCardReadTime = millis();
-}
-
 void sleepDetection() {
   unsigned long timeSinceLastDraw = millis() - lcdLastDraw;
   if (timeSinceLastDraw > SLEEP_TIME && !lcdHasChanged && !stackmat.connected() && !state.testMode) {
@@ -145,15 +185,15 @@ void sleepDetection() {
     lcd.noBacklight();
     mfrc522.PCD_SoftPowerDown();
 
-    // enter light sleep and wait for SLEEP_WAKE_BUTTON to be pressed
-    lightSleep(SLEEP_WAKE_BUTTON, LOW);
+    // enter light sleep and wait for SLEEP_WAKE_BUTTON to be pressed,
+    // if nothing happens for STANDBY_TIME go into deep sleep (doesn't return)
+    if (lightSleep(SLEEP_WAKE_BUTTON, LOW, STANDBY_TIME)) standbyEnter();
 
     lcd.backlight();
     lcdClear();
     stateHasChanged = true;
 
-    WiFi.disconnect();
-    WiFi.reconnect();
+    wakeReconnect();
     mfrc522.PCD_SoftPowerUp();
 
     return;
@@ -164,7 +204,8 @@ void stackmatLoop() {
   StackmatTimerState stackmatState = stackmat.state();
 
   if (stackmatState != state.lastTimerState && stackmatState != ST_Unknown) {
-    Logger.printf("Stackmat state change to: %d\n", stackmatState);
+    Logger.logf(LOG_DEBUG, "Stackmat state change to: %d\n", stackmatState);
+    trace(TRACE_STACKMAT, stackmatState, stackmat.time());
     
     switch (stackmatState) {
       case ST_Stopped:
@@ -174,7 +215,9 @@ void stackmatLoop() {
           break;
         }
 
-        Logger.printf("FINISH! Final time is %i:%02i.%03i!\n", stackmat.displayMinutes(), stackmat.displaySeconds(), stackmat.displayMilliseconds());
+        PROBE_START_AT(PROBE_FINISH_DISPLAY, stackmat.frameTime());
+        PROBE_START_AT(PROBE_FINISH_LCD, stackmat.frameTime());
+        Logger.logf(LOG_INFO, "FINISH! Final time is %i:%02i.%03i!\n", stackmat.displayMinutes(), stackmat.displaySeconds(), stackmat.displayMilliseconds());
         startSolveSession(stackmat.time());
         break;
 
@@ -183,7 +226,7 @@ void stackmatLoop() {
           resetSolveState();
         }
 
-        Logger.println("Timer reset!");
+        Logger.logf(LOG_INFO, "Timer reset!\n");
         break;
 
       case ST_Running:
@@ -192,7 +235,7 @@ void stackmatLoop() {
         // if (state.competitorCardId == 0) break;
 
         state.currentScene = SCENE_TIMER_TIME;
-        Logger.println("Solve started!");
+        Logger.logf(LOG_INFO, "Solve started!\n");
         break;
 
       default:
@@ -203,10 +246,12 @@ void stackmatLoop() {
   }
 
   if (stackmatState == StackmatTimerState::ST_Running && state.currentScene == SCENE_TIMER_TIME) {
+    PROBE_START_AT(PROBE_RUNNING_DISPLAY, stackmat.frameTime());
     lcdPrintf(0, true, ALIGN_CENTER, "%s", displayTime(stackmat.displayMinutes(), stackmat.displaySeconds(), stackmat.displayMilliseconds()).c_str());
     displayStr(displayTime(stackmat.displayMinutes(), stackmat.displaySeconds(), stackmat.displayMilliseconds(), false));
     lcdClearLine(1);
   }
 
   if(stackmatState != ST_Unknown) state.lastTimerState = stackmatState;
+  timeStreamLoop(stackmatState);
 }
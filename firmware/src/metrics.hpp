@@ -0,0 +1,92 @@
+#ifndef __METRICS_HPP__
+#define __METRICS_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WiFi.h>
+#include <ws_logger.h>
+#include "globals.hpp"
+#include "histogram.hpp"
+#include "lcd.hpp"
+#include "radio/requests.hpp"
+#include "radio/frames.hpp"
+#include "watchdog.hpp"
+#include "power.hpp"
+#include "radio/wake.hpp"
+#include "standby.hpp"
+#include "clock.hpp"
+#include "radio/discovery.hpp"
+#include "radio/link.hpp"
+#include "radio/tls.hpp"
+#include "state_stream.hpp"
+#include "time_stream.hpp"
+#include "history.hpp"
+
+TaskHandle_t core2Task = NULL;
+LatencyHistogram loopHistogram;  // loop() without delay
+LatencyHistogram loop2Histogram; // loop2() without delay
+unsigned long wsConnects = 0;
+
+unsigned long lastMetricsSent = 0;
+unsigned long lastMetricsFrames = 0;
+
+void sendMetrics() {
+  unsigned long now = millis();
+  unsigned long frames = stackmat.frames();
+  float elapsed = (now - lastMetricsSent) / 1000.0;
+
+  JsonDocument doc;
+  JsonObject metrics = doc["metrics"].to<JsonObject>();
+  metrics["esp_id"] = getEspId();
+  metrics["uptime"] = now;
+
+  metrics["heap"]["free"] = ESP.getFreeHeap();
+  metrics["heap"]["min_free"] = ESP.getMinFreeHeap();
+  metrics["heap"]["max_block"] = ESP.getMaxAllocHeap();
+
+  // high water marks are in bytes (minimum free stack since task start)
+  metrics["stack"]["loop"] = uxTaskGetStackHighWaterMark(NULL);
+  if (core2Task != NULL) metrics["stack"]["core2"] = uxTaskGetStackHighWaterMark(core2Task);
+
+  loopHistogram.toJson(metrics["loop"].to<JsonObject>());
+  loop2Histogram.toJson(metrics["loop2"].to<JsonObject>());
+  lcdDrawHistogram.toJson(metrics["lcd_draw"].to<JsonObject>());
+
+  metrics["stackmat_fps"] = elapsed > 0 ? (frames - lastMetricsFrames) / elapsed : 0;
+  metrics["ws_connects"] = wsConnects;
+  metrics["rssi"] = WiFi.RSSI();
+  metrics["logs_dropped"] = Logger.dropped.load();
+  metrics["logs_suppressed"] = Logger.suppressed.load();
+  addRequestStats(metrics["requests"].to<JsonObject>());
+  addWatchdogStats(metrics["stalls"].to<JsonObject>());
+  addPowerStats(metrics["power"].to<JsonObject>());
+  addWakeStats(metrics["wake"].to<JsonObject>());
+  addStandbyStats(metrics["standby"].to<JsonObject>());
+  addClockStats(metrics["clock"].to<JsonObject>());
+  addDiscoveryStats(metrics["servers"].to<JsonArray>());
+  addLinkStats(metrics["link"].to<JsonObject>());
+  addTlsStats(metrics["tls"].to<JsonObject>());
+  addTransportStats(metrics["transport"].to<JsonObject>());
+  addOutboundStats(metrics["outbound"].to<JsonObject>());
+  addStateStreamStats(metrics["state_stream"].to<JsonObject>());
+  addTimeStreamStats(metrics["time_stream"].to<JsonObject>());
+  addHistoryStats(metrics["history"].to<JsonObject>());
+
+  sendFrame(doc, OUT_TELEMETRY, OUT_KEY_METRICS);
+
+  // histograms are per report interval
+  loopHistogram.reset();
+  loop2Histogram.reset();
+  lcdDrawHistogram.reset();
+  lastMetricsFrames = frames;
+  lastMetricsSent = now;
+}
+
+void metricsLoop() {
+  if (millis() - lastMetricsSent < METRICS_INTERVAL) return;
+  if (!webSocket.isConnected()) return;
+
+  sendMetrics();
+}
+
+#endif
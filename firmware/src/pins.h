@@ -17,6 +17,7 @@
 #define RFID_SCK 18
 #define RFID_MISO 19
 #define RFID_MOSI 23
+// #define RFID_IRQ 25 // uncomment if IRQ line of MFRC522 is connected
 
 // DEFAULT I2C PINOUT
 #define LCD_SDA 21
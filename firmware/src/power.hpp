@@ -0,0 +1,184 @@
+#ifndef __POWER_HPP__
+#define __POWER_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <WiFi.h>
+#include <driver/uart.h>
+#include <hal/uart_ll.h>
+#include <ws_logger.h>
+#include <stackmat.h>
+#include "defines.h"
+#include "pins.h"
+
+// Stock arduino-esp32 2.x sdk is built without CONFIG_PM_ENABLE, there esp_pm
+// doesn't exist and only wifi modem sleep is switched by powerLoop (PM_MANUAL)
+enum PowerMode {
+  PM_OFF,            // before powerInit
+  PM_MANUAL,         // fixed PM_MAX_CPU_FREQ, wifi max modem sleep when idle, no light sleep
+  PM_DFS,            // esp_pm frequency scaling (no tickless idle in sdk)
+  PM_DFS_LIGHT_SLEEP // esp_pm frequency scaling + automatic light sleep
+};
+
+const char *powerModeNames[] = {"off", "manual", "dfs", "dfs_light_sleep"};
+
+PowerMode powerMode = PM_OFF;
+esp_pm_lock_handle_t pmPerfLock = NULL;  // cpu at max frequency (solve, inspection)
+esp_pm_lock_handle_t pmNetLock = NULL;   // apb at max frequency (network transfer)
+esp_pm_lock_handle_t pmAwakeLock = NULL; // no light sleep (stackmat connected)
+esp_pm_lock_handle_t pmSpiLock = NULL;   // apb at max frequency (rfid spi)
+bool pmPerfHeld = false;
+bool pmNetHeld = false;
+bool pmAwakeHeld = false;
+bool pmWifiMaxModem = false; // WIFI_PS_MAX_MODEM set (idle), WIFI_PS_MIN_MODEM otherwise
+volatile unsigned long pmJackEdge = 0; // last falling edge on stackmat jack (light sleep wake)
+
+unsigned long pmPerfSince = 0;
+unsigned long pmPerfTotal = 0; // ms with perf lock held
+
+// Battery discharge since last charge
+unsigned long batteryStartTime = 0;
+float batteryStartLevel = -1;
+float batteryDischargeRate = 0; // %/h
+
+// UART clocked from APB would change baud rate with APB frequency, REF_TICK
+// (1MHz) stays the same and is precise enough for 1200 and 115200 bauds
+void powerUartRefTick(uart_port_t port, uint32_t baud) {
+  uart_ll_set_sclk(UART_LL_GET_HW(port), UART_SCLK_REF_TICK);
+  uart_set_baudrate(port, baud);
+}
+
+#if CONFIG_PM_ENABLE
+// Timer connected to sleeping station wakes it (gpio wakeup), edge keeps it awake
+// until stackmat parses frames and reports it as connected
+void IRAM_ATTR powerJackIsr() {
+  pmJackEdge = millis();
+}
+#endif
+
+void powerInit() {
+#if CONFIG_PM_ENABLE
+  esp_pm_config_esp32_t config = {
+    .max_freq_mhz = PM_MAX_CPU_FREQ,
+    .min_freq_mhz = PM_MIN_CPU_FREQ,
+    .light_sleep_enable = true,
+  };
+
+  esp_err_t err = esp_pm_configure(&config);
+  if (err == ESP_ERR_NOT_SUPPORTED) {
+    // light sleep requires tickless idle (not enabled in every sdk with esp_pm)
+    config.light_sleep_enable = false;
+    err = esp_pm_configure(&config);
+    if (err == ESP_OK) powerMode = PM_DFS;
+  } else if (err == ESP_OK) {
+    powerMode = PM_DFS_LIGHT_SLEEP;
+  }
+
+  if (powerMode != PM_OFF) {
+    Logger.printf("Power management: %s (%d-%d MHz)\n", powerModeNames[powerMode], config.min_freq_mhz, config.max_freq_mhz);
+
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "perf", &pmPerfLock);
+    esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "net", &pmNetLock);
+    esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "awake", &pmAwakeLock);
+    esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "spi", &pmSpiLock);
+
+    powerUartRefTick(UART_NUM_0, 115200);
+    powerUartRefTick(UART_NUM_1, STACKMAT_TIMER_BAUD_RATE);
+
+    if (powerMode == PM_DFS_LIGHT_SLEEP) {
+      // uart line idles high, start bit of first frame wakes the station
+      gpio_wakeup_enable((gpio_num_t)STACKMAT_JACK, GPIO_INTR_LOW_LEVEL);
+      esp_sleep_enable_gpio_wakeup();
+      attachInterrupt(digitalPinToInterrupt(STACKMAT_JACK), powerJackIsr, FALLING);
+    }
+    return;
+  }
+#endif
+
+  // below 80 MHz apb drops with cpu and nothing raises it for wifi without esp_pm,
+  // board_build.f_cpu (80 MHz) stays and idle saving comes from wifi modem sleep
+  powerMode = PM_MANUAL;
+  Logger.printf("Power management: %s (%d MHz, sdk without CONFIG_PM_ENABLE)\n", powerModeNames[powerMode],
+                getCpuFrequencyMhz());
+}
+
+void powerSetLock(esp_pm_lock_handle_t lock, bool &held, bool want) {
+  if (lock == NULL || held == want) return;
+
+  if (want) {
+    esp_pm_lock_acquire(lock);
+  } else {
+    esp_pm_lock_release(lock);
+  }
+
+  held = want;
+}
+
+/// @brief Updates performance locks and wifi power save, call from loop
+/// @param busy solve or inspection in progress (full cpu speed)
+/// @param network request or update transfer in flight
+/// @param timerConnected stackmat is sending frames (uart has to stay awake)
+/// @param idle nobody is at the station (wifi may skip beacons)
+void powerLoop(bool busy, bool network, bool timerConnected, bool idle) {
+  if (busy && !pmPerfHeld) pmPerfSince = millis();
+  if (!busy && pmPerfHeld) pmPerfTotal += millis() - pmPerfSince;
+
+  // max modem sleep wakes only every listen interval, server pushes arrive later
+  bool maxModem = idle && !busy && !network;
+  if (maxModem != pmWifiMaxModem && WiFi.setSleep(maxModem ? WIFI_PS_MAX_MODEM : WIFI_PS_MIN_MODEM)) {
+    pmWifiMaxModem = maxModem;
+  }
+
+  if (powerMode == PM_MANUAL) {
+    pmPerfHeld = busy;
+    return;
+  }
+
+  // uart doesn't receive in light sleep: awake for whole time timer is connected,
+  // disconnected one wakes the station through gpio wakeup on the jack line
+  bool jackActive = millis() - pmJackEdge < PM_TIMER_WAKE_HOLD;
+  powerSetLock(pmPerfLock, pmPerfHeld, busy);
+  powerSetLock(pmNetLock, pmNetHeld, network);
+  powerSetLock(pmAwakeLock, pmAwakeHeld, timerConnected || jackActive);
+}
+
+// Spi peripheral is clocked from APB, keep it at max for the whole transaction
+struct PowerSpiScope {
+  PowerSpiScope() { if (pmSpiLock != NULL) esp_pm_lock_acquire(pmSpiLock); }
+  ~PowerSpiScope() { if (pmSpiLock != NULL) esp_pm_lock_release(pmSpiLock); }
+};
+
+/// @brief Tracks battery level drop since last charge
+void powerBatterySample(float level) {
+  unsigned long now = millis();
+  if (batteryStartLevel < 0 || level > batteryStartLevel + BATTERY_CHARGED_DELTA) {
+    batteryStartLevel = level;
+    batteryStartTime = now;
+    batteryDischargeRate = 0;
+    return;
+  }
+
+  float hours = (now - batteryStartTime) / 3600000.0;
+  if (hours < BATTERY_RATE_MIN_TIME / 3600000.0) return;
+
+  batteryDischargeRate = (batteryStartLevel - level) / hours;
+}
+
+void addBatteryLifeStats(JsonObject obj) {
+  obj["discharge_rate"] = batteryDischargeRate; // %/h
+  obj["measured_for"] = (millis() - batteryStartTime) / 1000;
+  if (batteryDischargeRate > 0) obj["estimated_runtime"] = 100.0 / batteryDischargeRate; // h per charge
+}
+
+void addPowerStats(JsonObject obj) {
+  obj["mode"] = powerModeNames[powerMode];
+  obj["cpu_mhz"] = getCpuFrequencyMhz();
+  obj["perf_ms"] = pmPerfTotal + (pmPerfHeld ? millis() - pmPerfSince : 0);
+  obj["net_lock"] = pmNetHeld;
+  obj["awake_lock"] = pmAwakeHeld;
+  obj["wifi_max_modem"] = pmWifiMaxModem;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef __PROBES_HPP__
+#define __PROBES_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "histogram.hpp"
+#include "version.h"
+
+// Latency probes are compiled out in release builds (RELEASE_BUILD is set in version.h)
+#ifndef RELEASE_BUILD
+#define LATENCY_PROBES
+#endif
+
+enum ProbePath {
+  PROBE_RUNNING_DISPLAY, // running stackmat frame -> 7 segment display
+  PROBE_FINISH_DISPLAY,  // stop frame -> final time on 7 segment display
+  PROBE_FINISH_LCD,      // stop frame -> lcd redrawn
+  PROBE_CARD_INFO,       // scanCard -> competitor info applied
+  PROBE_SUBMIT_ACK,      // sendSolve -> solve confirm / delegate response
+  PROBE_PATHS_COUNT
+};
+
+const char *probePathNames[PROBE_PATHS_COUNT] = {
+  "running_display",
+  "finish_display",
+  "finish_lcd",
+  "card_info",
+  "submit_ack",
+};
+
+#ifdef LATENCY_PROBES
+// micros() (esp_timer) is used instead of cycle counter, because paths cross
+// cores (card info) and cycle counters of both cores are not synchronized
+volatile unsigned long probeStarts[PROBE_PATHS_COUNT] = {0};
+LatencyHistogram probeHistograms[PROBE_PATHS_COUNT];
+
+inline void probeStart(ProbePath path, unsigned long at) {
+  probeStarts[path] = at == 0 ? 1 : at; // 0 - not started
+}
+
+inline void probeEnd(ProbePath path) {
+  unsigned long start = probeStarts[path];
+  if (start == 0) return;
+
+  probeStarts[path] = 0;
+  probeHistograms[path].add(micros() - start);
+}
+
+#define PROBE_START(path) probeStart(path, micros())
+#define PROBE_START_AT(path, at) probeStart(path, at)
+#define PROBE_END(path) probeEnd(path)
+#else
+#define PROBE_START(path)
+#define PROBE_START_AT(path, at)
+#define PROBE_END(path)
+#endif
+
+/// @brief Adds per path latency histograms (in us) into json object
+void addLatencyStats(JsonObject obj, bool reset) {
+#ifdef LATENCY_PROBES
+  obj["enabled"] = true;
+  for (int i = 0; i < PROBE_PATHS_COUNT; i++) {
+    probeHistograms[i].toJson(obj["paths"][probePathNames[i]].to<JsonObject>());
+    if (reset) probeHistograms[i].reset();
+  }
+#else
+  obj["enabled"] = false;
+#endif
+}
+
+#endif
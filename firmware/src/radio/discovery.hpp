@@ -0,0 +1,179 @@
+#ifndef __DISCOVERY_HPP__
+#define __DISCOVERY_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPmDNS.h>
+#include <WiFi.h>
+#include <ws_logger.h>
+#include "globals.hpp"
+#include "radio/utils.hpp"
+
+#define MAX_WS_SERVERS 4
+#define WS_SERVER_UNREACHABLE UINT32_MAX
+
+void wsSwitchServer(const char *url);
+
+struct WsServer {
+  char url[128];
+  uint32_t connectRtt; // best tcp connect time (us), not comparable with link rtt
+};
+
+WsServer wsServers[MAX_WS_SERVERS];
+uint8_t wsServersCount = 0;
+char wsCurrentUrl[128] = {0};
+portMUX_TYPE discoveryMux = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t discoveryTaskHandle = NULL;
+bool mdnsStarted = false;
+unsigned long wsLastConnected = 0;
+
+// Tcp handshake time (connect rtt), cheaper than websocket round trip and doesn't touch server state
+uint32_t probeServerRtt(const char *host, uint16_t port) {
+  uint32_t best = WS_SERVER_UNREACHABLE;
+  for (int i = 0; i < DISCOVERY_PROBES; i++) {
+    WiFiClient client;
+    unsigned long start = micros();
+    if (client.connect(host, port, DISCOVERY_PROBE_TIMEOUT)) {
+      best = min(best, (uint32_t)(micros() - start));
+      client.stop();
+    }
+  }
+
+  return best;
+}
+
+/// @brief Finds all stackmat services and probes them (blocking, up to a few seconds)
+/// @return number of found servers
+int discoverServers(WsServer *out) {
+  if (!mdnsStarted) {
+    mdnsStarted = MDNS.begin("random");
+    if (!mdnsStarted) Logger.printf("Failed to setup MDNS!\n");
+  }
+
+  int n = MDNS.queryService("stackmat", "tcp");
+  int count = 0;
+  for (int i = 0; i < n && count < MAX_WS_SERVERS; i++) {
+    String url = MDNS.txt(i, "ws");
+    if (url.length() == 0) continue;
+
+    ws_info_t info = parseWsUrl(url.c_str());
+    WsServer &s = out[count++];
+    strncpy(s.url, url.c_str(), sizeof(s.url) - 1);
+    s.url[sizeof(s.url) - 1] = '\0';
+    s.connectRtt = probeServerRtt(info.host, info.port);
+
+    Logger.printf("Found stackmat MDNS:\nHostname: %s, IP: %s, PORT: %d, connect RTT: %lu us\n",
+                  s.url, MDNS.IP(i).toString().c_str(), MDNS.port(i), (unsigned long)s.connectRtt);
+  }
+
+  return count;
+}
+
+int bestServer(WsServer *servers, int count) {
+  int best = -1;
+  for (int i = 0; i < count; i++) {
+    if (servers[i].connectRtt == WS_SERVER_UNREACHABLE) continue;
+    if (best < 0 || servers[i].connectRtt < servers[best].connectRtt) best = i;
+  }
+
+  return best;
+}
+
+void discoveryStore(WsServer *servers, int count) {
+  portENTER_CRITICAL(&discoveryMux);
+  memcpy(wsServers, servers, sizeof(WsServer) * count);
+  wsServersCount = count;
+  portEXIT_CRITICAL(&discoveryMux);
+}
+
+/// @brief Url of server with lowest connect rtt (empty if none found)
+String getWsUrl() {
+  WsServer found[MAX_WS_SERVERS];
+  int count = discoverServers(found);
+  discoveryStore(found, count);
+
+  // unreachable by probe, but mdns still advertises it, try it anyway
+  int best = bestServer(found, count);
+  if (best < 0 && count > 0) best = 0;
+  if (best < 0) return "";
+
+  strcpy(wsCurrentUrl, found[best].url);
+  return found[best].url;
+}
+
+void discoveryTask(void *pvParameters) {
+  while (1) {
+    // woken earlier by discoveryLoop when current server is lost
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DISCOVERY_INTERVAL));
+    if (!WiFi.isConnected()) continue;
+
+    WsServer found[MAX_WS_SERVERS];
+    int count = discoverServers(found);
+    discoveryStore(found, count);
+  }
+}
+
+void discoveryInit() {
+  xTaskCreatePinnedToCore(discoveryTask, "discovery", 4096, NULL, 0, &discoveryTaskHandle, 0);
+}
+
+/// @brief Switches to better server (only when idle) or fails over when current one is lost
+void discoveryLoop(bool idle) {
+  unsigned long now = millis();
+  bool connected = webSocket.isConnected();
+  if (connected) wsLastConnected = now;
+
+  bool lost = !connected && now - wsLastConnected > DISCOVERY_FAILOVER_TIME;
+  if (!lost && !idle) return;
+
+  WsServer servers[MAX_WS_SERVERS];
+  portENTER_CRITICAL(&discoveryMux);
+  int count = wsServersCount;
+  memcpy(servers, wsServers, sizeof(servers));
+  portEXIT_CRITICAL(&discoveryMux);
+
+  int best = bestServer(servers, count);
+  int current = -1;
+  for (int i = 0; i < count; i++) {
+    if (strcmp(servers[i].url, wsCurrentUrl) == 0) current = i;
+  }
+
+  if (lost) {
+    static unsigned long lastRediscovery = 0;
+    if (discoveryTaskHandle != NULL && now - lastRediscovery > DISCOVERY_FAILOVER_TIME) {
+      xTaskNotifyGive(discoveryTaskHandle);
+      lastRediscovery = now;
+    }
+
+    if (best < 0 || best == current) return;
+  } else {
+    if (best < 0 || best == current) return;
+
+    bool degraded = current < 0 || servers[current].connectRtt == WS_SERVER_UNREACHABLE ||
+                    servers[current].connectRtt > servers[best].connectRtt * 2 + DISCOVERY_RTT_MARGIN;
+    if (!degraded) return;
+  }
+
+  Logger.printf("Switching server to %s (connect rtt: %lu us)\n", servers[best].url,
+                (unsigned long)servers[best].connectRtt);
+  strcpy(wsCurrentUrl, servers[best].url);
+  wsLastConnected = now;
+  wsSwitchServer(servers[best].url);
+}
+
+void addDiscoveryStats(JsonArray arr) {
+  WsServer servers[MAX_WS_SERVERS];
+  portENTER_CRITICAL(&discoveryMux);
+  int count = wsServersCount;
+  memcpy(servers, wsServers, sizeof(servers));
+  portEXIT_CRITICAL(&discoveryMux);
+
+  for (int i = 0; i < count; i++) {
+    JsonObject s = arr.add<JsonObject>();
+    s["url"] = servers[i].url;
+    s["current"] = strcmp(servers[i].url, wsCurrentUrl) == 0;
+    if (servers[i].connectRtt != WS_SERVER_UNREACHABLE) s["connect_rtt_us"] = servers[i].connectRtt;
+  }
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef __FRAMES_HPP__
+#define __FRAMES_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "globals.hpp"
+#include "trace.hpp"
+#include "clock.hpp"
+#include "radio/transport.hpp"
+#include "radio/outbound.hpp"
+
+/// @brief Sends already serialized text frame to server
+/// @param fast latency sensitive frame (goes over udp if it was negotiated)
+bool sendText(String &json, bool fast = false) {
+  Transport *transport = &wsTransport;
+  if (fast) {
+    transport = fastTransport(json.length());
+    if (transport == &udpTransport) {
+      transportSentUdp++;
+    } else {
+      transportSentWs++;
+    }
+  }
+
+  trace(TRACE_WS_SEND, transport == &udpTransport ? 1 : 0, json.length());
+  return transport->sendText((const uint8_t *)json.c_str(), json.length());
+}
+
+/// @brief Sends binary frame to server (always websocket, udp channel carries json only)
+bool sendBinary(const uint8_t *data, size_t len) {
+  trace(TRACE_WS_SEND, 0, len);
+  return wsTransport.sendBinary(data, len);
+}
+
+/// @brief Adds epoch_ms and err_ms into frame object ({"frame_name": {...}})
+void stampFrame(JsonDocument &doc) {
+  for (JsonPair kv : doc.as<JsonObject>()) {
+    if (kv.value().is<JsonObject>()) clockStamp(kv.value().as<JsonObject>());
+    return;
+  }
+}
+
+/// @brief Serializes json document and sends it to server (through outbound queue)
+/// @param key frames with same key are coalesced while queued
+bool sendFrame(JsonDocument &doc, OutboundClass cls = OUT_CONTROL, uint8_t key = OUT_KEY_NONE) {
+  stampFrame(doc);
+
+  String json;
+  serializeJson(doc, json);
+
+  return outboundSend(cls, json, key);
+}
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef __LINK_HPP__
+#define __LINK_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ws_logger.h>
+#include "globals.hpp"
+
+#define LINK_WINDOW 16 // last pings used for loss ratio
+
+// Own ping/pong (payload carries sequence number), websocket library
+// heartbeat only disconnects and doesn't expose rtt
+uint32_t linkSeq = 0;
+uint32_t linkPendingSeq = 0;       // 0 - no ping in flight
+unsigned long linkPendingSent = 0; // micros
+unsigned long linkLastPing = 0;    // millis
+
+uint32_t linkSrtt = 0;   // smoothed rtt (us)
+uint32_t linkRttVar = 0; // rtt variation (us)
+uint32_t linkLastRtt = 0;
+uint16_t linkHistory = 0; // bit per ping, 1 - lost
+uint8_t linkHistoryCount = 0;
+uint8_t linkConsecutiveLost = 0;
+
+uint32_t linkPings = 0;
+uint32_t linkLost = 0;
+uint32_t linkReconnects = 0; // forced by link quality
+uint8_t linkConnectFails = 0;
+bool linkDegraded = false;
+
+void linkReset() {
+  linkPendingSeq = 0;
+  linkSrtt = 0;
+  linkRttVar = 0;
+  linkHistory = 0;
+  linkHistoryCount = 0;
+  linkConsecutiveLost = 0;
+}
+
+void linkRecord(bool lost) {
+  linkHistory = (linkHistory << 1) | (lost ? 1 : 0);
+  if (linkHistoryCount < LINK_WINDOW) linkHistoryCount++;
+
+  linkConsecutiveLost = lost ? linkConsecutiveLost + 1 : 0;
+  if (lost) linkLost++;
+}
+
+/// @brief Lost pings in window (%)
+uint8_t linkLoss() {
+  if (linkHistoryCount == 0) return 0;
+  return __builtin_popcount(linkHistory & ((1 << linkHistoryCount) - 1)) * 100 / linkHistoryCount;
+}
+
+void linkOnPong(uint8_t *payload, size_t length) {
+  if (length != sizeof(uint32_t) || linkPendingSeq == 0) return;
+
+  uint32_t seq;
+  memcpy(&seq, payload, sizeof(seq));
+  if (seq != linkPendingSeq) return; // late pong of already lost ping
+
+  uint32_t rtt = micros() - linkPendingSent;
+  linkPendingSeq = 0;
+  linkLastRtt = rtt;
+  linkConnectFails = 0; // link works, next reconnect can be fast again
+  linkRecord(false);
+
+  // same smoothing as tcp (rfc 6298)
+  if (linkSrtt == 0) {
+    linkSrtt = rtt;
+    linkRttVar = rtt / 2;
+  } else {
+    uint32_t diff = rtt > linkSrtt ? rtt - linkSrtt : linkSrtt - rtt;
+    linkRttVar = (3 * linkRttVar + diff) / 4;
+    linkSrtt = (7 * linkSrtt + rtt) / 8;
+  }
+}
+
+void linkOnConnected() {
+  linkReset();
+  linkLastPing = millis();
+  webSocket.setReconnectInterval(LINK_RECONNECT_INTERVAL);
+}
+
+/// @brief Backs off reconnect attempts (unless fast reconnect is needed)
+void linkOnDisconnected(bool urgent) {
+  linkReset();
+  if (linkConnectFails < 8) linkConnectFails++;
+
+  unsigned long interval = urgent ? LINK_RECONNECT_INTERVAL : min((unsigned long)LINK_RECONNECT_INTERVAL << (linkConnectFails - 1), (unsigned long)LINK_RECONNECT_MAX_INTERVAL);
+  webSocket.setReconnectInterval(interval);
+}
+
+/// @param urgent response is awaited (solve), ping often
+/// @param idle nothing happens, ping rarely to save power
+void linkLoop(bool urgent, bool idle) {
+  if (!webSocket.isConnected()) return;
+
+  unsigned long interval = urgent ? LINK_PING_FAST : idle ? LINK_PING_IDLE : LINK_PING_NORMAL;
+  if (linkDegraded) interval = min(interval, (unsigned long)LINK_PING_NORMAL / 2);
+
+  // pong timeout, at least LINK_PONG_TIMEOUT or 4 * rtt variance above srtt
+  if (linkPendingSeq != 0) {
+    unsigned long timeout = max((unsigned long)LINK_PONG_TIMEOUT * 1000, (unsigned long)(linkSrtt + 4 * linkRttVar));
+    if (micros() - linkPendingSent < timeout) return;
+
+    linkPendingSeq = 0;
+    linkRecord(true);
+    Logger.logf(LOG_WARN, "[link] pong timeout (lost: %u%%)\n", linkLoss());
+  }
+
+  uint8_t loss = linkLoss();
+  linkDegraded = loss > 0 || linkSrtt > LINK_WARN_RTT * 1000;
+
+  bool badRtt = linkHistoryCount >= 4 && linkSrtt > LINK_MAX_RTT * 1000;
+  bool badLoss = linkHistoryCount >= 4 && loss > LINK_MAX_LOSS;
+  if (badRtt || badLoss || linkConsecutiveLost >= LINK_MAX_CONSECUTIVE_LOST) {
+    Logger.logf(LOG_ERROR, "[link] reconnecting (rtt: %lu us, loss: %u%%, lost in row: %u)\n",
+                (unsigned long)linkSrtt, loss, linkConsecutiveLost);
+    linkReconnects++;
+    linkReset();
+    webSocket.disconnect(); // reconnected by library
+    return;
+  }
+
+  if (millis() - linkLastPing < interval) return;
+
+  linkSeq++;
+  if (linkSeq == 0) linkSeq = 1;
+
+  uint8_t payload[sizeof(uint32_t)];
+  memcpy(payload, &linkSeq, sizeof(linkSeq));
+
+  linkPendingSeq = linkSeq;
+  linkPendingSent = micros();
+  linkLastPing = millis();
+  linkPings++;
+  webSocket.sendPing(payload, sizeof(payload));
+}
+
+void addLinkStats(JsonObject obj) {
+  obj["srtt_us"] = linkSrtt;
+  obj["rttvar_us"] = linkRttVar;
+  obj["last_rtt_us"] = linkLastRtt;
+  obj["loss"] = linkLoss();
+  obj["pings"] = linkPings;
+  obj["lost"] = linkLost;
+  obj["reconnects"] = linkReconnects;
+}
+
+#endif
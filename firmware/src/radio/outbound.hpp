@@ -0,0 +1,349 @@
+#ifndef __OUTBOUND_HPP__
+#define __OUTBOUND_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <transport.h>
+#include <ws_logger.h>
+#include "defines.h"
+#include "radio/transport.hpp"
+
+#define OUTBOUND_MAX_DEPTH 10
+
+bool sendText(String &json, bool fast); // frames.hpp
+bool sendBinary(const uint8_t *data, size_t len);
+
+// Priority classes of outgoing frames (lower is sent first)
+enum OutboundClass : uint8_t {
+  OUT_SOLVE,     // solve, delegate
+  OUT_LOOKUP,    // card info, time_sync (carries send timestamp)
+  OUT_STREAM,    // running time (binary)
+  OUT_CONTROL,   // acks, add device
+  OUT_TELEMETRY, // battery, snapshot, metrics, dumps
+  OUT_LOGS,
+  OUT_CLASSES_COUNT
+};
+
+// Queued frame with same key replaces the older one (only latest state matters)
+enum OutboundKey : uint8_t {
+  OUT_KEY_NONE,
+  OUT_KEY_BATTERY,
+  OUT_KEY_SNAPSHOT,
+  OUT_KEY_METRICS,
+  OUT_KEY_LATENCY,
+};
+
+struct OutboundPolicy {
+  const char *name;
+  uint8_t depth; // 0 - not queued (dropped when not sent)
+  uint32_t rate; // bytes/s (0 - unlimited)
+  uint32_t burst;
+  bool immediate; // sent right away, queued only when transport refuses it
+};
+
+// Immediate frames are queued only while connected, after disconnect requests
+// resend solves themselves and lookups are cancelled
+const OutboundPolicy outboundPolicies[OUT_CLASSES_COUNT] = {
+  {"solve", 2, 0, 0, true},
+  {"lookup", 2, 0, 0, true},
+  {"stream", 0, 0, 0, true}, // next frame replaces lost one
+  {"control", 8, 0, 0, false},
+  {"telemetry", OUTBOUND_MAX_DEPTH, OUTBOUND_TELEMETRY_RATE, OUTBOUND_TELEMETRY_RATE * 4, false},
+  {"logs", 2, OUTBOUND_LOGS_RATE, WS_LOGGER_CHUNK_SIZE * 2, false},
+};
+
+struct OutboundEntry {
+  String payload;
+  uint8_t key;
+  unsigned long queuedAt;
+};
+
+struct OutboundQueue {
+  OutboundEntry entries[OUTBOUND_MAX_DEPTH];
+  uint8_t head = 0;
+  uint8_t count = 0;
+  int32_t tokens = 0; // token bucket, can go negative after oversized frame
+  unsigned long refilledAt = 0;
+
+  // stats (updated from both cores under outboundMutex)
+  uint32_t sent = 0;
+  uint32_t bytes = 0;
+  uint32_t coalesced = 0;
+  uint32_t dropped = 0;
+  uint8_t maxDepth = 0;
+  unsigned long maxWait = 0; // ms in queue
+};
+
+OutboundQueue outboundQueues[OUT_CLASSES_COUNT];
+SemaphoreHandle_t outboundMutex = NULL; // frames are produced on both cores
+unsigned long outboundHoldStart = 0;
+
+void outboundInit() {
+  outboundMutex = xSemaphoreCreateMutex();
+}
+
+inline void outboundLock() {
+  xSemaphoreTake(outboundMutex, portMAX_DELAY);
+}
+
+inline void outboundUnlock() {
+  xSemaphoreGive(outboundMutex);
+}
+
+void outboundCountSent(OutboundQueue &q, size_t len) {
+  outboundLock();
+  q.sent++;
+  q.bytes += len;
+  outboundUnlock();
+}
+
+void outboundCountDropped(OutboundQueue &q) {
+  outboundLock();
+  q.dropped++;
+  outboundUnlock();
+}
+
+/// @brief Sends frame right away (solve, lookup) or queues it for outboundLoop
+/// @return false if frame was dropped (queue full or not sent)
+bool outboundSend(OutboundClass cls, String &json, uint8_t key = OUT_KEY_NONE) {
+  const OutboundPolicy &policy = outboundPolicies[cls];
+  OutboundQueue &q = outboundQueues[cls];
+
+  if (policy.immediate) {
+    if (!wsTransport.connected()) {
+      outboundCountDropped(q);
+      return false;
+    }
+
+    // frames refused earlier go first
+    outboundLock();
+    bool waiting = q.count > 0;
+    outboundUnlock();
+
+    size_t len = json.length();
+    if (!waiting && sendText(json, true)) {
+      outboundCountSent(q, len);
+      return true;
+    }
+
+    if (policy.depth == 0) {
+      outboundCountDropped(q);
+      return false;
+    }
+  }
+
+  outboundLock();
+  OutboundEntry *slot = NULL;
+  if (key != OUT_KEY_NONE) {
+    for (int i = 0; i < q.count; i++) {
+      OutboundEntry &e = q.entries[(q.head + i) % OUTBOUND_MAX_DEPTH];
+      if (e.key == key) {
+        slot = &e;
+        q.coalesced++;
+        break;
+      }
+    }
+  }
+
+  if (slot == NULL) {
+    if (q.count >= policy.depth) {
+      q.dropped++;
+      // logger keeps records until they are accepted, telemetry keeps newest
+      if (cls == OUT_LOGS) {
+        outboundUnlock();
+        return false;
+      }
+
+      q.head = (q.head + 1) % OUTBOUND_MAX_DEPTH;
+      q.count--;
+    }
+
+    slot = &q.entries[(q.head + q.count) % OUTBOUND_MAX_DEPTH];
+    q.count++;
+    if (q.count > q.maxDepth) q.maxDepth = q.count;
+    slot->queuedAt = millis();
+  }
+
+  // coalesced entry keeps its queue time and position
+  slot->payload = std::move(json);
+  slot->key = key;
+  outboundUnlock();
+
+  return true;
+}
+
+/// @brief Sends binary frame right away (only classes that aren't queued)
+bool outboundSendBinary(OutboundClass cls, const uint8_t *data, size_t len) {
+  OutboundQueue &q = outboundQueues[cls];
+  if (outboundPolicies[cls].depth != 0 || !sendBinary(data, len)) {
+    outboundCountDropped(q);
+    return false;
+  }
+
+  outboundCountSent(q, len);
+  return true;
+}
+
+/// @brief Puts frame refused by transport back at the head of its queue
+void outboundRequeue(OutboundClass cls, String &payload, uint8_t key, unsigned long queuedAt) {
+  const OutboundPolicy &policy = outboundPolicies[cls];
+  OutboundQueue &q = outboundQueues[cls];
+
+  outboundLock();
+  bool superseded = false;
+  for (int i = 0; i < q.count && key != OUT_KEY_NONE; i++) {
+    if (q.entries[(q.head + i) % OUTBOUND_MAX_DEPTH].key == key) superseded = true;
+  }
+
+  if (superseded) {
+    q.coalesced++;
+  } else if (q.count >= policy.depth) {
+    q.dropped++; // filled up in the meantime, newer frames are kept
+  } else {
+    q.head = (q.head + OUTBOUND_MAX_DEPTH - 1) % OUTBOUND_MAX_DEPTH;
+    q.count++;
+
+    OutboundEntry &e = q.entries[q.head];
+    e.payload = std::move(payload);
+    e.key = key;
+    e.queuedAt = queuedAt;
+  }
+  outboundUnlock();
+}
+
+/// @brief Drops immediate frames refused before disconnect (requests resend solves after reconnect)
+void outboundDropImmediate() {
+  outboundLock();
+  for (int cls = 0; cls < OUT_CLASSES_COUNT; cls++) {
+    OutboundQueue &q = outboundQueues[cls];
+    if (!outboundPolicies[cls].immediate) continue;
+
+    for (; q.count > 0; q.count--) {
+      q.entries[q.head].payload = String();
+      q.head = (q.head + 1) % OUTBOUND_MAX_DEPTH;
+      q.dropped++;
+    }
+  }
+  outboundUnlock();
+}
+
+bool outboundHasRoom(OutboundClass cls) {
+  outboundLock();
+  bool room = outboundQueues[cls].count < outboundPolicies[cls].depth;
+  outboundUnlock();
+  return room;
+}
+
+void outboundRefill(OutboundQueue &q, const OutboundPolicy &policy, unsigned long now) {
+  if (policy.rate == 0) return;
+
+  unsigned long elapsed = now - q.refilledAt;
+  if (elapsed == 0) return;
+
+  q.refilledAt = now;
+  int64_t tokens = q.tokens + (int64_t)elapsed * policy.rate / 1000;
+  q.tokens = min(tokens, (int64_t)policy.burst);
+}
+
+/// @brief Sends queued frames by priority within rate budgets
+/// @param hold solve response is awaited, lower classes wait (tcp head of line blocking)
+/// @param force ignore budgets and hold (before sleep)
+void outboundLoop(bool hold, bool force = false) {
+  if (!wsTransport.connected()) {
+    outboundDropImmediate();
+    return;
+  }
+
+  unsigned long now = millis();
+  if (!hold) {
+    outboundHoldStart = 0;
+  } else if (outboundHoldStart == 0) {
+    outboundHoldStart = now;
+  } else if (now - outboundHoldStart > OUTBOUND_HOLD_MAX) {
+    hold = false;
+  }
+
+  size_t budget = force ? SIZE_MAX : OUTBOUND_LOOP_BYTES;
+  for (int cls = 0; cls < OUT_CLASSES_COUNT; cls++) {
+    const OutboundPolicy &policy = outboundPolicies[cls];
+    OutboundQueue &q = outboundQueues[cls];
+    if (policy.depth == 0) continue;
+    if (hold && !force && cls >= OUT_TELEMETRY) break;
+
+    outboundRefill(q, policy, now);
+    while (q.count > 0 && budget > 0) {
+      if (!force && policy.rate > 0 && q.tokens <= 0) break;
+
+      outboundLock();
+      OutboundEntry &e = q.entries[q.head];
+      String payload = std::move(e.payload);
+      uint8_t key = e.key;
+      unsigned long queuedAt = e.queuedAt;
+      q.head = (q.head + 1) % OUTBOUND_MAX_DEPTH;
+      q.count--;
+      outboundUnlock();
+
+      size_t len = payload.length();
+      if (!sendText(payload, policy.immediate)) {
+        outboundRequeue((OutboundClass)cls, payload, key, queuedAt); // tried again on next loop
+        return;
+      }
+
+      outboundLock();
+      q.sent++;
+      q.bytes += len;
+      if (now - queuedAt > q.maxWait) q.maxWait = now - queuedAt;
+      outboundUnlock();
+
+      if (policy.rate > 0) q.tokens -= len;
+      budget = len >= budget ? 0 : budget - len;
+    }
+  }
+}
+
+/// @brief Sends everything queued (before sleep)
+void outboundFlush() {
+  outboundLoop(false, true);
+}
+
+// Logger sends its chunks through logs class, while the queue is full logger
+// keeps records in its own buffer and tries again on next loop
+class OutboundLogTransport : public Transport {
+  public:
+    const char *name() override { return "logs"; }
+    bool connected() override { return wsTransport.connected(); }
+    bool busy() override { return !outboundHasRoom(OUT_LOGS); }
+    size_t maxFrameSize() override { return SIZE_MAX; }
+
+    bool sendText(const uint8_t *data, size_t len) override {
+      String json;
+      json.concat((const char *)data, len);
+      return outboundSend(OUT_LOGS, json);
+    }
+};
+
+OutboundLogTransport outboundLogTransport;
+
+void addOutboundStats(JsonObject obj) {
+  outboundLock();
+  for (int i = 0; i < OUT_CLASSES_COUNT; i++) {
+    OutboundQueue &q = outboundQueues[i];
+    JsonObject c = obj[outboundPolicies[i].name].to<JsonObject>();
+    c["sent"] = q.sent;
+    c["bytes"] = q.bytes;
+    c["dropped"] = q.dropped;
+    if (outboundPolicies[i].depth == 0) continue;
+
+    c["depth"] = q.count;
+    c["max_depth"] = q.maxDepth;
+    c["max_wait_ms"] = q.maxWait;
+    c["coalesced"] = q.coalesced;
+
+    // per report interval
+    q.maxDepth = q.count;
+    q.maxWait = 0;
+  }
+  outboundUnlock();
+}
+
+#endif
@@ -36,6 +36,7 @@ void initWifi() {
   }
 
   wifiConnected = true;
+  wifiCacheSave();
   if (!res) deinitBt(true);
   configTime(3600, 0, "pool.ntp.org", "time.nist.gov", "time.google.com");
   initWs();
@@ -0,0 +1,293 @@
+#ifndef __REQUESTS_HPP__
+#define __REQUESTS_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ws_logger.h>
+#include "globals.hpp"
+#include "defines.h"
+#include "radio/frames.hpp"
+
+enum RequestType {
+  REQUEST_SOLVE,
+  REQUEST_DELEGATE,
+  REQUEST_CARD_INFO,
+  REQUEST_TYPES_COUNT,
+  REQUEST_ANY = REQUEST_TYPES_COUNT // only for resolveRequest
+};
+
+struct RequestPolicy {
+  const char *name;
+  unsigned long timeout; // first timeout (doubled after every retry)
+  uint8_t maxRetries;
+  unsigned long offlineHold; // kept while disconnected and resent after reconnect (0 - cancelled on disconnect)
+};
+
+const RequestPolicy requestPolicies[REQUEST_TYPES_COUNT] = {
+  {"solve", SOLVE_REQUEST_TIMEOUT, SOLVE_REQUEST_RETRIES, SOLVE_REQUEST_OFFLINE_HOLD},
+  {"delegate", DELEGATE_REQUEST_TIMEOUT, 0, 0}, // answered after delegate decision
+  {"card_info", CARD_REQUEST_TIMEOUT, CARD_REQUEST_RETRIES, 0},
+};
+
+struct PendingRequest {
+  uint32_t id = 0; // 0 - free slot
+  RequestType type;
+  unsigned long sentAt;     // first send (used for rtt)
+  unsigned long lastSentAt; // last (re)send
+  unsigned long timeout;    // current timeout (with backoff)
+  uint8_t retries;
+  bool resent;              // sent again after reconnect (rtt is ambiguous)
+  bool answered;            // response was already applied locally (card cache)
+  String payload;
+};
+
+struct RequestStats {
+  unsigned long count = 0;
+  unsigned long retries = 0;
+  unsigned long timeouts = 0;
+  unsigned long lastRtt = 0;
+  unsigned long avgRtt = 0;
+  unsigned long maxRtt = 0;
+};
+
+PendingRequest pendingRequests[MAX_PENDING_REQUESTS];
+RequestStats requestStats[REQUEST_TYPES_COUNT];
+uint32_t nextRequestId = 1;
+SemaphoreHandle_t requestsMutex = NULL; // sent from both cores, resolved on core 1
+
+// implemented in state.hpp (called after all retries timed out)
+void requestFailed(RequestType type);
+
+void requestsInit() {
+  requestsMutex = xSemaphoreCreateMutex();
+}
+
+// mutex (not critical section), payload strings are allocated and freed under it
+inline void requestsLock() {
+  xSemaphoreTake(requestsMutex, portMAX_DELAY);
+}
+
+inline void requestsUnlock() {
+  xSemaphoreGive(requestsMutex);
+}
+
+/// @brief Sends frame and registers it inside pending requests table
+/// @param type request type (selects timeout/retry policy)
+/// @param doc json document with single root key (request_id is added to it)
+/// @param key root key of the frame (for example "solve")
+/// @return id of the request
+uint32_t sendRequest(RequestType type, JsonDocument &doc, const char *key) {
+  requestsLock();
+  uint32_t id = nextRequestId++;
+  if (nextRequestId == 0) nextRequestId = 1;
+  requestsUnlock();
+
+  doc[key]["request_id"] = id;
+  stampFrame(doc);
+
+  String json;
+  serializeJson(doc, json);
+  String payload = json; // kept for retries
+
+  // register before sending, response can be handled on the other core
+  requestsLock();
+  // use free slot or evict the oldest one
+  PendingRequest *slot = &pendingRequests[0];
+  for (int i = 0; i < MAX_PENDING_REQUESTS; i++) {
+    PendingRequest &r = pendingRequests[i];
+    if (r.id == 0) {
+      slot = &r;
+      break;
+    }
+
+    if (r.sentAt < slot->sentAt) slot = &r;
+  }
+
+  bool evicted = slot->id != 0;
+  slot->id = id;
+  slot->type = type;
+  slot->sentAt = slot->lastSentAt = millis();
+  slot->timeout = requestPolicies[type].timeout;
+  slot->retries = 0;
+  slot->resent = false;
+  slot->answered = false;
+  slot->payload = std::move(payload);
+  requestStats[type].count++;
+  requestsUnlock();
+
+  outboundSend(type == REQUEST_CARD_INFO ? OUT_LOOKUP : OUT_SOLVE, json);
+
+  if (evicted) LOG_RATE_LIMITED(1000, LOG_WARN, "Pending requests table full, evicted oldest request!\n");
+  return id;
+}
+
+/// @brief Removes request from pending table and records its rtt
+/// @param id request_id from response (0 if server didn't send one)
+/// @param type expected request type (when id is 0 the oldest of this type is resolved)
+/// @param answered set to true if request was already answered locally
+/// @return true if pending request was found
+bool resolveRequest(uint32_t id, RequestType type, bool *answered = NULL) {
+  requestsLock();
+  PendingRequest *req = NULL;
+  for (int i = 0; i < MAX_PENDING_REQUESTS; i++) {
+    PendingRequest &r = pendingRequests[i];
+    if (r.id == 0) continue;
+    if (type != REQUEST_ANY && r.type != type) continue;
+
+    if (id != 0 && r.id == id) {
+      req = &r;
+      break;
+    }
+
+    if (id == 0 && (req == NULL || r.sentAt < req->sentAt)) req = &r;
+  }
+
+  if (req != NULL) {
+    // dont measure rtt of retransmitted requests (it's ambiguous)
+    if (req->retries == 0 && !req->resent) {
+      RequestStats &stats = requestStats[req->type];
+      unsigned long rtt = millis() - req->sentAt;
+
+      stats.lastRtt = rtt;
+      stats.avgRtt = stats.avgRtt == 0 ? rtt : (stats.avgRtt * 7 + rtt) / 8;
+      if (rtt > stats.maxRtt) stats.maxRtt = rtt;
+    }
+
+    if (answered != NULL) *answered = req->answered;
+    req->id = 0;
+    req->payload = String();
+  }
+  requestsUnlock();
+
+  return req != NULL;
+}
+
+void cancelRequests(RequestType type) {
+  requestsLock();
+  for (int i = 0; i < MAX_PENDING_REQUESTS; i++) {
+    PendingRequest &r = pendingRequests[i];
+    if (r.id == 0 || (type != REQUEST_ANY && r.type != type)) continue;
+
+    r.id = 0;
+    r.payload = String();
+  }
+  requestsUnlock();
+}
+
+void markRequestAnswered(uint32_t id) {
+  requestsLock();
+  for (int i = 0; i < MAX_PENDING_REQUESTS; i++) {
+    if (pendingRequests[i].id == id) pendingRequests[i].answered = true;
+  }
+  requestsUnlock();
+}
+
+bool hasPendingRequest(RequestType type) {
+  bool pending = false;
+  requestsLock();
+  for (int i = 0; i < MAX_PENDING_REQUESTS; i++) {
+    if (pendingRequests[i].id == 0) continue;
+    if (type == REQUEST_ANY || pendingRequests[i].type == type) {
+      pending = true;
+      break;
+    }
+  }
+  requestsUnlock();
+
+  return pending;
+}
+
+/// @brief Cancels requests that aren't kept while disconnected (solves are resent after reconnect)
+void requestsOnDisconnected() {
+  requestsLock();
+  for (int i = 0; i < MAX_PENDING_REQUESTS; i++) {
+    PendingRequest &r = pendingRequests[i];
+    if (r.id == 0 || requestPolicies[r.type].offlineHold > 0) continue;
+
+    r.id = 0;
+    r.payload = String();
+  }
+  requestsUnlock();
+}
+
+/// @brief Resends requests kept while disconnected, frame could be lost with the old connection
+void requestsOnConnected() {
+  for (int i = 0; i < MAX_PENDING_REQUESTS; i++) {
+    requestsLock();
+    PendingRequest &r = pendingRequests[i];
+    if (r.id == 0) {
+      requestsUnlock();
+      continue;
+    }
+
+    uint32_t id = r.id;
+    RequestType type = r.type;
+    r.resent = true;
+    r.lastSentAt = millis();
+    r.timeout = requestPolicies[type].timeout;
+    String payload = r.payload;
+    requestsUnlock();
+
+    Logger.logf(LOG_INFO, "Request %lu (%s) resent after reconnect\n", (unsigned long)id, requestPolicies[type].name);
+    outboundSend(type == REQUEST_CARD_INFO ? OUT_LOOKUP : OUT_SOLVE, payload);
+  }
+}
+
+/// @brief Retries timed out requests (with exponential backoff) and drops exhausted ones
+void requestsLoop() {
+  bool offline = !wsTransport.connected();
+  for (int i = 0; i < MAX_PENDING_REQUESTS; i++) {
+    requestsLock();
+    PendingRequest &r = pendingRequests[i];
+    // held requests don't use up retries while waiting for reconnect (requestsOnConnected)
+    bool held = r.id != 0 && offline && millis() - r.sentAt < requestPolicies[r.type].offlineHold;
+    if (r.id == 0 || held || millis() - r.lastSentAt < r.timeout) {
+      requestsUnlock();
+      continue;
+    }
+
+    // slot can be evicted or resolved from the other core once unlocked, send a copy
+    uint32_t id = r.id;
+    RequestType type = r.type;
+    bool retry = r.retries < requestPolicies[type].maxRetries;
+    String payload;
+    if (retry) {
+      r.retries++;
+      r.timeout *= 2;
+      r.lastSentAt = millis();
+      requestStats[type].retries++;
+      payload = r.payload;
+    } else {
+      requestStats[type].timeouts++;
+      r.id = 0;
+      r.payload = String();
+    }
+    uint8_t retries = r.retries;
+    requestsUnlock();
+
+    if (retry) {
+      Logger.logf(LOG_WARN, "Request %lu (%s) timed out, retry %d\n", (unsigned long)id, requestPolicies[type].name, retries);
+      if (wsTransport.connected()) outboundSend(type == REQUEST_CARD_INFO ? OUT_LOOKUP : OUT_SOLVE, payload);
+      continue;
+    }
+
+    Logger.logf(LOG_ERROR, "Request %lu (%s) failed after %d retries\n", (unsigned long)id, requestPolicies[type].name, retries);
+    requestFailed(type);
+  }
+}
+
+void addRequestStats(JsonObject obj) {
+  for (int i = 0; i < REQUEST_TYPES_COUNT; i++) {
+    RequestStats &stats = requestStats[i];
+    JsonObject o = obj[requestPolicies[i].name].to<JsonObject>();
+
+    o["count"] = stats.count;
+    o["retries"] = stats.retries;
+    o["timeouts"] = stats.timeouts;
+    o["last_rtt"] = stats.lastRtt;
+    o["avg_rtt"] = stats.avgRtt;
+    o["max_rtt"] = stats.maxRtt;
+  }
+}
+
+#endif
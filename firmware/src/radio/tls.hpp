@@ -0,0 +1,100 @@
+#ifndef __TLS_HPP__
+#define __TLS_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ws_logger.h>
+#include "globals.hpp"
+#include "defines.h"
+#include "histogram.hpp"
+#include "watchdog.hpp"
+#ifdef WS_TLS_CA
+#include "ws_ca.h"
+#endif
+
+enum TlsMode {
+  TLS_OFF,         // ws://
+  TLS_INSECURE,    // wss:// without verification (WS_TLS_INSECURE)
+  TLS_CA,          // pinned CA
+  TLS_FINGERPRINT, // pinned certificate
+  TLS_REFUSED      // wss:// without any of the above, not connecting
+};
+
+const char *tlsModeNames[] = {"off", "insecure", "ca", "fingerprint", "refused"};
+
+TlsMode tlsMode = TLS_OFF;
+
+// Websocket library connects synchronously inside webSocket.loop(), the
+// longest call while disconnected covers dns, tcp connect and tls handshake.
+// Tls session resumption isn't supported: arduinoWebSockets creates new
+// WiFiClientSecure for every connect and the 2.x core has no api to save or
+// restore sessions, so every reconnect is a full handshake (WS_CONNECT_BUDGET).
+uint32_t wsConnectCallMax = 0;      // us, longest call since disconnect
+unsigned long wsConnectCallEnd = 0; // micros
+uint32_t wsConnectCallTime = 0;     // us, longest call before last connection
+uint32_t wsUpgradeTime = 0;         // us, from that call to connected event
+LatencyHistogram wsConnectCallHistogram;
+
+/// @brief Starts wss:// connection, refuses unverified server unless WS_TLS_INSECURE is defined
+/// @return false if connection was refused
+bool tlsBegin(const char *host, int port, const char *path) {
+#if defined(WS_TLS_CA)
+  tlsMode = TLS_CA;
+  webSocket.beginSslWithCA(host, port, path, wsCaCert);
+#elif defined(WS_TLS_FINGERPRINT)
+  tlsMode = TLS_FINGERPRINT;
+  webSocket.beginSSL(host, port, path, WS_TLS_FINGERPRINT);
+#elif defined(WS_TLS_INSECURE)
+  tlsMode = TLS_INSECURE;
+  Logger.logf(LOG_WARN, "wss:// without pinned CA or fingerprint, certificate is not verified!\n");
+  webSocket.beginSSL(host, port, path);
+#else
+  tlsMode = TLS_REFUSED;
+  webSocket.disconnect();
+  Logger.logf(LOG_ERROR, "wss://%s:%d%s refused, define WS_TLS_CA or WS_TLS_FINGERPRINT (or WS_TLS_INSECURE)\n",
+              host, port, path);
+  return false;
+#endif
+  return true;
+}
+
+/// @brief webSocket.loop() with connect call time measurement
+void wsLoop() {
+  if (tlsMode == TLS_REFUSED) {
+    return; // begin wasn't called for this server, library would reconnect to previous one
+  }
+
+  if (webSocket.isConnected()) {
+    webSocket.loop();
+    return;
+  }
+
+  WATCHDOG_SECTION(SECTION_WS_CONNECT);
+  unsigned long start = micros();
+  webSocket.loop();
+
+  uint32_t took = micros() - start;
+  if (took > wsConnectCallMax) {
+    wsConnectCallMax = took;
+    wsConnectCallEnd = micros();
+  }
+}
+
+void tlsOnConnected() {
+  wsConnectCallTime = wsConnectCallMax;
+  wsUpgradeTime = micros() - wsConnectCallEnd;
+  wsConnectCallMax = 0;
+  wsConnectCallHistogram.add(wsConnectCallTime);
+
+  Logger.printf("Connected (%s), longest connect call: %lu us, upgrade: %lu us\n", tlsModeNames[tlsMode],
+                (unsigned long)wsConnectCallTime, (unsigned long)wsUpgradeTime);
+}
+
+void addTlsStats(JsonObject obj) {
+  obj["mode"] = tlsModeNames[tlsMode];
+  obj["connect_call_us"] = wsConnectCallTime;
+  obj["upgrade_us"] = wsUpgradeTime;
+  wsConnectCallHistogram.toJson(obj["connect_calls"].to<JsonObject>());
+}
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef __TRANSPORT_HPP__
+#define __TRANSPORT_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <transport.h>
+#include <reliable_udp.h>
+#include <ws_logger.h>
+#include "globals.hpp"
+#include "radio/wake.hpp"
+
+#ifdef TRANSPORT_UDP
+#define TRANSPORT_OFFER "&transports=ws,udp"
+#else
+#define TRANSPORT_OFFER ""
+#endif
+
+void parseTextFrame(uint8_t *payload, size_t length); // websocket.hpp
+
+class WsTransport : public Transport {
+  public:
+    const char *name() override { return "ws"; }
+    bool connected() override { return webSocket.isConnected(); }
+    size_t maxFrameSize() override { return SIZE_MAX; }
+
+    bool sendText(const uint8_t *data, size_t len) override {
+      return webSocket.sendTXT((uint8_t *)data, len);
+    }
+
+    bool sendBinary(const uint8_t *data, size_t len) override {
+      return webSocket.sendBIN((uint8_t *)data, len);
+    }
+};
+
+// Negotiated at connect: station offers udp in ws url, server answers with
+// "transport" frame (udp port + session). Websocket stays the main channel
+// (logs, ota, pings, binary frames), udp carries only small latency sensitive json frames
+class UdpTransport : public Transport {
+  public:
+    UdpTransport() : channel(onSend, onReceive, this) {}
+
+    const char *name() override { return "udp"; }
+    size_t maxFrameSize() override { return RUDP_MAX_PAYLOAD; }
+
+    bool connected() override {
+      lock();
+      bool up = channel.up(micros());
+      unlock();
+      return up;
+    }
+
+    bool sendText(const uint8_t *data, size_t len) override {
+      lock();
+      bool sent = channel.send(data, len, micros());
+      unlock();
+      return sent;
+    }
+
+    /// @brief Usable for frame of given size (server answers and window isn't full)
+    bool ready(size_t len) {
+      lock();
+      bool ok = channel.up(micros()) && channel.canSend(len);
+      unlock();
+      return ok;
+    }
+
+    void start(IPAddress ip, uint16_t port, uint32_t session) {
+      if (mutex == NULL) mutex = xSemaphoreCreateMutex();
+      if (!socketOpen) socketOpen = udp.begin(0); // ephemeral local port
+
+      lock();
+      serverIp = ip;
+      serverPort = port;
+      channel.start(session, micros());
+      unlock();
+    }
+
+    void stop() {
+      if (mutex == NULL) return;
+
+      lock();
+      channel.stop();
+      unlock();
+    }
+
+    void loop() {
+      if (mutex == NULL || !socketOpen) return;
+
+      lock();
+      int size;
+      while ((size = udp.parsePacket()) > 0) {
+        if (udp.remoteIP() != serverIp || size > (int)sizeof(packet)) {
+          udp.flush();
+          continue;
+        }
+
+        int len = udp.read(packet, sizeof(packet));
+        channel.onDatagram(packet, len, micros());
+      }
+
+      channel.loop(micros());
+      unlock();
+
+      // frames are parsed outside of lock (handlers can send responses)
+      for (int i = 0; i < receivedCount; i++) {
+        parseTextFrame((uint8_t *)received[i].c_str(), received[i].length());
+        received[i] = String();
+      }
+      receivedCount = 0;
+    }
+
+    RudpStats stats() {
+      lock();
+      RudpStats s = channel.stats;
+      unlock();
+      return s;
+    }
+
+  private:
+    ReliableUdp channel;
+    WiFiUDP udp;
+    bool socketOpen = false;
+    IPAddress serverIp;
+    uint16_t serverPort = 0;
+    SemaphoreHandle_t mutex = NULL; // requests are sent from both cores
+    uint8_t packet[RUDP_HEADER_SIZE + RUDP_MAX_PAYLOAD];
+    String received[RUDP_WINDOW];
+    int receivedCount = 0;
+
+    void lock() { if (mutex != NULL) xSemaphoreTake(mutex, portMAX_DELAY); }
+    void unlock() { if (mutex != NULL) xSemaphoreGive(mutex); }
+
+    static void onSend(void *ctx, const uint8_t *data, size_t len) {
+      UdpTransport *t = (UdpTransport *)ctx;
+      t->udp.beginPacket(t->serverIp, t->serverPort);
+      t->udp.write(data, len);
+      t->udp.endPacket();
+    }
+
+    static bool onReceive(void *ctx, const uint8_t *data, size_t len) {
+      UdpTransport *t = (UdpTransport *)ctx;
+      if (t->receivedCount >= RUDP_WINDOW) return false; // not acked, server retransmits it after next loop
+
+      String &s = t->received[t->receivedCount++];
+      s.concat((const char *)data, len);
+      return true;
+    }
+};
+
+WsTransport wsTransport;
+UdpTransport udpTransport;
+
+uint32_t transportSentWs = 0;  // latency sensitive frames sent over websocket
+uint32_t transportSentUdp = 0;
+
+/// @brief Transport for latency sensitive frame (udp when negotiated and alive)
+Transport *fastTransport(size_t len) {
+  return udpTransport.ready(len) ? (Transport *)&udpTransport : (Transport *)&wsTransport;
+}
+
+/// @brief Server accepted udp offer ({"transport": {"udp_port": ..., "session": ...}})
+void parseTransport(JsonObject doc) {
+#ifdef TRANSPORT_UDP
+  uint16_t port = doc["udp_port"];
+  uint32_t session = doc["session"];
+  if (port == 0) return;
+
+  // same host as websocket, resolved once (tls keeps hostname in cache)
+  IPAddress ip;
+  if (!WiFi.hostByName(wsCache.host, ip)) {
+    Logger.logf(LOG_WARN, "[transport] cannot resolve %s, staying on websocket\n", wsCache.host);
+    return;
+  }
+
+  udpTransport.start(ip, port, session);
+  Logger.printf("[transport] udp negotiated (%s:%u, session: %lu)\n", ip.toString().c_str(), port, (unsigned long)session);
+#else
+  (void)doc; // udp isn't offered
+#endif
+}
+
+void transportOnDisconnected() {
+  udpTransport.stop(); // session belongs to websocket connection
+}
+
+void transportLoop() {
+  udpTransport.loop();
+}
+
+void addTransportStats(JsonObject obj) {
+  RudpStats s = udpTransport.stats();
+  obj["udp_up"] = udpTransport.connected();
+  obj["sent_ws"] = transportSentWs;
+  obj["sent_udp"] = transportSentUdp;
+  obj["udp_srtt_us"] = s.srtt;
+  obj["udp_retransmits"] = s.retransmits;
+  obj["udp_failed"] = s.failed;
+  obj["udp_received"] = s.received;
+  obj["udp_duplicates"] = s.duplicates;
+  obj["udp_rejected"] = s.rejected;
+}
+
+#endif
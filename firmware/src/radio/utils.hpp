@@ -2,12 +2,12 @@
 #define __RADIO_UTILS__
 
 #include <Arduino.h>
-#include <ESPmDNS.h>
 
 struct WsInfo {
     char host[100];
     int port;
     char path[100];
+    bool secure; // wss://
 } typedef ws_info_t;
 
 ws_info_t parseWsUrl(const char *url) {
@@ -20,12 +20,13 @@ ws_info_t parseWsUrl(const char *url) {
   } else if (strncmp("wss://", url, 6) == 0) {
     pathPtr = 6;
     wsInfo.port = 443;
+    wsInfo.secure = true;
   } else {
     return wsInfo;
   }
 
   // url with offset of pathPtr
-  char *pathSplitPtr = strchr(url + pathPtr, '/');
+  const char *pathSplitPtr = strchr(url + pathPtr, '/');
   int pathSplitIdx = pathSplitPtr == NULL ? strlen(url) : pathSplitPtr - url;
 
   if (pathSplitPtr != NULL) {
@@ -53,21 +54,4 @@ ws_info_t parseWsUrl(const char *url) {
   return wsInfo;
 }
 
-String getWsUrl() {
-  if (!MDNS.begin("random")) {
-    Logger.printf("Failed to setup MDNS!");
-  }
-
-  int n = MDNS.queryService("stackmat", "tcp");
-  if (n > 0) {
-    Logger.printf("Found stackmat MDNS:\nHostname: %s, IP: %s, PORT: %d\n",
-                  MDNS.txt(0, "ws").c_str(), MDNS.IP(0).toString().c_str(),
-                  MDNS.port(0));
-    return MDNS.txt(0, "ws");
-  }
-  MDNS.end();
-
-  return "";
-}
-
 #endif
\ No newline at end of file
@@ -0,0 +1,141 @@
+#ifndef __WAKE_HPP__
+#define __WAKE_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WiFi.h>
+#include <ws_logger.h>
+#include "globals.hpp"
+
+void wsBegin(const char *host, int port, const char *path, bool secure);
+
+// Everything needed to reconnect without wifi scan, mdns and dns lookup
+struct WifiCache {
+  bool valid;
+  char ssid[33];
+  char psk[65];
+  uint8_t bssid[6];
+  int32_t channel;
+};
+
+struct WsCache {
+  bool valid;
+  char url[128];  // as advertised by mdns
+  char host[100]; // resolved ip if possible
+  int port;
+  char path[256];
+  bool secure;
+};
+
+// rtc memory, so it survives deep sleep standby
+RTC_DATA_ATTR WifiCache wifiCache = {};
+RTC_DATA_ATTR WsCache wsCache = {};
+
+unsigned long wakeStart = 0;
+bool wakePending = false;
+bool wakeFast = false;     // fast connect (cached channel + bssid) used
+bool wakeWsStarted = false;
+bool wakeWifiUp = false;
+
+uint32_t wakeCount = 0;
+unsigned long wakeWifiTime = 0;  // ms from wake to wifi connected
+unsigned long wakeReadyTime = 0; // ms from wake to websocket connected
+
+void wifiCacheSave() {
+  if (WiFi.status() != WL_CONNECTED) return;
+
+  strncpy(wifiCache.ssid, WiFi.SSID().c_str(), sizeof(wifiCache.ssid) - 1);
+  strncpy(wifiCache.psk, WiFi.psk().c_str(), sizeof(wifiCache.psk) - 1);
+  memcpy(wifiCache.bssid, WiFi.BSSID(), sizeof(wifiCache.bssid));
+  wifiCache.channel = WiFi.channel();
+  wifiCache.valid = true;
+
+  Logger.printf("Cached wifi: %s (channel: %d, bssid: %s)\n", wifiCache.ssid, wifiCache.channel, WiFi.BSSIDstr().c_str());
+}
+
+void wsCacheSave(const char *url, const char *host, int port, const char *path, bool secure) {
+  strncpy(wsCache.url, url, sizeof(wsCache.url) - 1);
+
+  // certificate is verified against hostname, so wss:// keeps it (dns lookup on reconnect)
+  IPAddress ip;
+  if (!secure && WiFi.hostByName(host, ip)) {
+    strncpy(wsCache.host, ip.toString().c_str(), sizeof(wsCache.host) - 1);
+  } else {
+    strncpy(wsCache.host, host, sizeof(wsCache.host) - 1);
+  }
+
+  wsCache.port = port;
+  wsCache.secure = secure;
+  strncpy(wsCache.path, path, sizeof(wsCache.path) - 1);
+  wsCache.valid = true;
+}
+
+/// @brief Starts reconnect after light sleep (wifi first, websocket in wakeLoop)
+void wakeReconnect() {
+  wakeStart = millis();
+  wakePending = true;
+  wakeWsStarted = false;
+  wakeWifiUp = false;
+  wakeCount++;
+
+#ifdef SLEEP_KEEP_WIFI
+  if (WiFi.status() == WL_CONNECTED) {
+    wakeFast = true;
+    return;
+  }
+#endif
+
+  wakeFast = wifiCache.valid;
+  if (wakeFast) {
+    // skips scan, connects directly to cached ap (without saving config to nvs)
+    WiFi.persistent(false);
+    WiFi.begin(wifiCache.ssid, wifiCache.psk, wifiCache.channel, wifiCache.bssid, true);
+  } else {
+    WiFi.disconnect();
+    WiFi.reconnect();
+  }
+}
+
+void wakeLoop() {
+  if (!wakePending) return;
+  unsigned long elapsed = millis() - wakeStart;
+
+  if (!wakeWifiUp) {
+    if (WiFi.status() == WL_CONNECTED) {
+      wakeWifiUp = true;
+      wakeWifiTime = elapsed;
+    } else if (wakeFast && elapsed > WAKE_FAST_CONNECT_TIMEOUT) {
+      // ap probably changed channel, do normal connect (with scan)
+      Logger.printf("Fast wifi connect failed, reconnecting with scan\n");
+      wifiCache.valid = false;
+      wakeFast = false;
+      WiFi.disconnect();
+      WiFi.begin(wifiCache.ssid, wifiCache.psk);
+    }
+
+    return;
+  }
+
+  // don't wait for websocket reconnect interval
+  if (!wakeWsStarted) {
+    if (wsCache.valid && !webSocket.isConnected()) wsBegin(wsCache.host, wsCache.port, wsCache.path, wsCache.secure);
+    wakeWsStarted = true;
+  }
+
+  if (!webSocket.isConnected()) return;
+
+  wakeReadyTime = elapsed;
+  wakePending = false;
+  if (!wakeFast || memcmp(wifiCache.bssid, WiFi.BSSID(), sizeof(wifiCache.bssid)) != 0) wifiCacheSave();
+
+  Logger.printf("Wake to ready: %lu ms (wifi: %lu ms, fast: %d)\n", wakeReadyTime, wakeWifiTime, wakeFast);
+}
+
+void addWakeStats(JsonObject obj) {
+  obj["count"] = wakeCount;
+  obj["wifi_ms"] = wakeWifiTime;
+  obj["ready_ms"] = wakeReadyTime;
+  obj["fast"] = wakeFast;
+}
+
+#endif
@@ -7,8 +7,17 @@
 #include "version.h"
 #include "defines.h"
 #include "radio/utils.hpp"
+#include "metrics.hpp"
+#include "blackbox.hpp"
+#include "radio/wake.hpp"
+#include "radio/discovery.hpp"
+#include "radio/tls.hpp"
+#include "state_stream.hpp"
+#include "time_stream.hpp"
 
 void webSocketEvent(WStype_t type, uint8_t *payload, size_t length);
+void wsBegin(const char *host, int port, const char *path, bool secure);
+void wsConnectUrl(const char *url);
 String wsURL = "";
 
 // OTA
@@ -27,33 +36,54 @@ void initWs() {
     delay(1000);
   }
 
-  ws_info_t wsInfo = parseWsUrl(wsURL.c_str());
+  wsConnectUrl(wsURL.c_str());
+}
+
+void wsConnectUrl(const char *url) {
+  ws_info_t wsInfo = parseWsUrl(url);
 
   char finalPath[256];
-  snprintf(finalPath, 256, "%s?id=%lu&ver=%s&chip=%s&bt=%s&firmware=%s", 
-            wsInfo.path, getEspId(), FIRMWARE_VERSION, CHIP, BUILD_TIME, FIRMWARE_TYPE);
+  snprintf(finalPath, 256, "%s?id=%lu&ver=%s&chip=%s&bt=%s&firmware=%s%s", 
+            wsInfo.path, getEspId(), FIRMWARE_VERSION, CHIP, BUILD_TIME, FIRMWARE_TYPE, TRANSPORT_OFFER);
+
+  wsCacheSave(url, wsInfo.host, wsInfo.port, finalPath, wsInfo.secure);
+  wsBegin(wsInfo.host, wsInfo.port, finalPath, wsInfo.secure);
+}
+
+void wsSwitchServer(const char *url) {
+  wsURL = url;
+  webSocket.disconnect();
+  wsConnectUrl(url);
+}
+
+void wsBegin(const char *host, int port, const char *path, bool secure) {
+  if (secure) {
+    if (!tlsBegin(host, port, path)) {
+      return;
+    }
+  } else {
+    tlsMode = TLS_OFF;
+    webSocket.begin(host, port, path);
+  }
 
-  webSocket.begin(wsInfo.host, wsInfo.port, finalPath);
   webSocket.onEvent(webSocketEvent);
-  webSocket.setReconnectInterval(1500);
-  Logger.setWsClient(&webSocket);
+  webSocket.setReconnectInterval(LINK_RECONNECT_INTERVAL);
+  Logger.setTransport(&outboundLogTransport);
+  Logger.setClock(clockLogStamp);
 }
 
-typedef ArduinoJson::V701PB2::detail::MemberProxy<ArduinoJson::V701PB2::JsonDocument &, const char *> JsonChildDocument;
-void parseCardInfoResponse(JsonChildDocument doc) {
-  String display = doc["display"];
-  unsigned long cardId = doc["card_id"];
-  String countryIso2 = doc["country_iso2"];
-  bool canCompete = doc["can_compete"];
-  countryIso2.toLowerCase();
+// version namespace (V701PB2 on esp32) is inline and depends on build flags, so it's left out
+typedef ArduinoJson::detail::MemberProxy<ArduinoJson::JsonDocument &, const char *> JsonChildDocument;
+void applyCardInfo(card_id_t cardId, const char *display, const char *countryIso2, bool canCompete) {
+  PROBE_END(PROBE_CARD_INFO);
 
   if (state.currentScene == SCENE_WAITING_FOR_COMPETITOR || state.currentScene == SCENE_WAITING_FOR_COMPETITOR_WITH_TIME) {
-    if(!webSocket.isConnected() || (!stackmat.connected() && !state.testMode)) return;
+    if(!stackmat.connected() && !state.testMode) return;
 
     if (state.competitorCardId == 0 && canCompete) {
-      strncpy(state.competitorDisplay, display.c_str(), 128);
+      strncpy(state.competitorDisplay, display, 128);
       state.competitorCardId = cardId;
-      primaryLangauge = countryIso2 != "pl";
+      primaryLangauge = strcmp(countryIso2, "pl") != 0;
       state.currentScene = SCENE_COMPETITOR_INFO;
 
       int time = state.testMode ? testModeStackmatTime : stackmat.time();
@@ -78,23 +108,68 @@ void parseCardInfoResponse(JsonChildDocument doc) {
   stateHasChanged = true;
 }
 
+void parseCardInfoResponse(JsonChildDocument doc) {
+  String display = doc["display"];
+  card_id_t cardId = doc["card_id"];
+  String countryIso2 = doc["country_iso2"];
+  bool canCompete = doc["can_compete"];
+  countryIso2.toLowerCase();
+
+  if (doc.containsKey("cache_epoch")) cardCacheSetEpoch(doc["cache_epoch"]);
+
+  // responses are applied only once (retries can be answered twice), late or
+  // unsolicited ones don't get into cache (request_id 0 resolves oldest request)
+  bool answered = false;
+  uint32_t requestId = doc["request_id"];
+  if (!resolveRequest(requestId, REQUEST_CARD_INFO, &answered)) {
+    LOG_RATE_LIMITED(1000, LOG_WARN, "Stale card info response (request %lu)\n", (unsigned long)requestId);
+    return;
+  }
+
+  cardCachePut(cardId, display.c_str(), countryIso2.c_str(), canCompete);
+
+  if (answered) {
+    // already shown from cache, only correct competitor if cached entry was outdated
+    if (state.competitorCardId != cardId || state.currentScene > SCENE_COMPETITOR_INFO) return;
+
+    if (!canCompete) {
+      resetSolveState(false);
+    } else {
+      strncpy(state.competitorDisplay, display.c_str(), 128);
+      primaryLangauge = countryIso2 != "pl";
+    }
+
+    stateHasChanged = true;
+    return;
+  }
+
+  applyCardInfo(cardId, display.c_str(), countryIso2.c_str(), canCompete);
+}
+
 void parseSolveConfirm(JsonChildDocument doc) {
   if (doc["competitor_id"] != state.competitorCardId ||
       doc["esp_id"] != getEspId() ||
       doc["session_id"] != state.solveSessionId) {
-    Logger.println("Wrong solve confirm frame!");
+    LOG_RATE_LIMITED(1000, LOG_WARN, "Wrong solve confirm frame!\n");
     return;
   }
 
+  resolveRequest(doc["request_id"], REQUEST_SOLVE); // only valid confirm (request_id 0 resolves oldest solve)
+
+  PROBE_END(PROBE_SUBMIT_ACK);
+  historyConfirm(state.solveSessionId);
   resetSolveState();
 }
 
 void parseDelegateResponse(JsonChildDocument doc) {
   if (doc["esp_id"] != getEspId()) {
-    Logger.println("Wrong solve confirm frame!");
+    LOG_RATE_LIMITED(1000, LOG_WARN, "Wrong solve confirm frame!\n");
     return;
   }
 
+  resolveRequest(doc["request_id"], REQUEST_DELEGATE);
+  PROBE_END(PROBE_SUBMIT_ACK);
+
   if (doc.containsKey("solve_time")) {
     unsigned long solveTime =  doc["solve_time"];
     state.solveTime = solveTime;
@@ -112,6 +187,7 @@ void parseDelegateResponse(JsonChildDocument doc) {
     state.currentScene = SCENE_FINISHED_TIME;
     waitForDelegateResponse = false;
   } else {
+    historyConfirm(state.solveSessionId); // delegate decided, nothing more will be sent
     resetSolveState();
   }
 
@@ -120,7 +196,7 @@ void parseDelegateResponse(JsonChildDocument doc) {
 
 void parseDeviceSettings(JsonChildDocument doc) {
   if (doc["esp_id"] != getEspId()) {
-    Logger.println("Wrong deivce settings frame!");
+    LOG_RATE_LIMITED(1000, LOG_WARN, "Wrong deivce settings frame!\n");
     return;
   }
 
@@ -132,12 +208,38 @@ void parseDeviceSettings(JsonChildDocument doc) {
   bool added = doc["added"];
   state.added = added;
 
+  if (doc.containsKey("card_cache_epoch")) {
+    cardCacheSetEpoch(doc["card_cache_epoch"]);
+  }
+
   stateHasChanged = true;
 }
 
 void parseEpochTime(JsonChildDocument doc) {
-  epochBase = doc["current_epoch"];
-  epochBase -= millis() / 1000;
+  // only seconds, used until first time_sync response
+  int64_t epoch = doc["current_epoch"];
+  clockSetEpoch(epoch * 1000000, 1000000);
+}
+
+void parseTimeSync(JsonChildDocument doc) {
+  int64_t t3 = clockLocalUs();
+  int64_t t0 = doc["t0"];
+  if (t0 <= 0 || t3 - t0 > CLOCK_SYNC_TIMEOUT * 1000LL) return;
+
+  // server timestamps are epoch ms (fractional part is used if sent)
+  int64_t t1 = doc["t1"].as<double>() * 1000;
+  int64_t t2 = doc["t2"].as<double>() * 1000;
+  clockAddSample(t0, t1, t2, t3);
+}
+
+void clockLoop() {
+  if (!clockSyncDue(webSocket.isConnected())) return;
+
+  JsonDocument doc;
+  doc["time_sync"]["esp_id"] = getEspId();
+  doc["time_sync"]["t0"] = clockLocalUs();
+
+  sendFrame(doc, OUT_LOOKUP);
 }
 
 void parseStartUpdate(JsonChildDocument doc) {
@@ -171,13 +273,15 @@ void parseStartUpdate(JsonChildDocument doc) {
 
 void parseApiError(JsonChildDocument doc) {
   if (doc["esp_id"] != getEspId()) {
-    Logger.println("Wrong api error frame!");
+    LOG_RATE_LIMITED(1000, LOG_WARN, "Wrong api error frame!\n");
     return;
   }
 
+  resolveRequest(doc["request_id"], REQUEST_ANY);
+
   String errorMessage = doc["error"];
   bool shouldResetTime = doc["should_reset_time"];
-  Logger.printf("Api entry error: %s\n", errorMessage.c_str());
+  Logger.logf(LOG_WARN, "Api entry error: %s\n", errorMessage.c_str());
 
   if(shouldResetTime) resetSolveState();
   if(state.currentScene != SCENE_ERROR) state.sceneBeforeError = state.currentScene;
@@ -216,9 +320,10 @@ void parseTestPacket(JsonChildDocument doc) {
     }
 
     int pressTime = doc["data"]["press_time"];
+    WATCHDOG_SECTION(SECTION_TEST_BUTTON);
     buttons.testButtonClick(pins, pressTime);
   } else if (type == "ScanCard") {
-    unsigned long cardId = doc["data"];
+    card_id_t cardId = doc["data"];
     scanCard(cardId);
   } else if (type == "ResetState") {
     resetSolveState(true);
@@ -230,6 +335,7 @@ void parseTestPacket(JsonChildDocument doc) {
 }
 
 void parseUpdateData(uint8_t *payload, size_t length) {
+  WATCHDOG_SECTION(SECTION_OTA);
   if (Update.write(payload, length) != length) {
     Update.printError(Serial);
     Logger.printf("[Update] (lensum) Error! Rebooting...\n");
@@ -265,37 +371,69 @@ void parseUpdateData(uint8_t *payload, size_t length) {
   webSocket.sendBIN((uint8_t *)NULL, 0);
 }
 
+/// @brief Handles text frame from server (websocket or udp transport)
+void parseTextFrame(uint8_t *payload, size_t length) {
+  JsonDocument doc;
+  deserializeJson(doc, payload, length);
+
+  if (doc.containsKey("card_info_response")) {
+    parseCardInfoResponse(doc["card_info_response"]);
+  } else if (doc.containsKey("solve_confirm")) {
+    parseSolveConfirm(doc["solve_confirm"]);
+  } else if (doc.containsKey("delegate_response")) {
+    parseDelegateResponse(doc["delegate_response"]);
+  } else if (doc.containsKey("device_settings")) {
+    parseDeviceSettings(doc["device_settings"]);
+  } else if (doc.containsKey("start_update")) {
+    parseStartUpdate(doc["start_update"]);
+  } else if (doc.containsKey("api_error")) {
+    parseApiError(doc["api_error"]);
+  } else if (doc.containsKey("test_packet")) {
+    parseTestPacket(doc["test_packet"]);
+  } else if (doc.containsKey("epoch_time")) {
+    parseEpochTime(doc["epoch_time"]);
+  } else if (doc.containsKey("time_sync")) {
+    parseTimeSync(doc["time_sync"]);
+  } else if (doc.containsKey("trace_request")) {
+    if (doc["trace_request"]["esp_id"] == getEspId()) sendTraceDump();
+  } else if (doc.containsKey("latency_request")) {
+    if (doc["latency_request"]["esp_id"] == getEspId()) sendLatencyStats(doc["latency_request"]["reset"]);
+  } else if (doc.containsKey("transport")) {
+    parseTransport(doc["transport"]);
+  } else if (doc.containsKey("state_subscribe")) {
+    parseStateSubscribe(doc["state_subscribe"]);
+  } else if (doc.containsKey("time_stream")) {
+    parseTimeStream(doc["time_stream"]);
+  } else if (doc.containsKey("history_request")) {
+    parseHistoryRequest(doc["history_request"]);
+  }
+}
+
 void webSocketEvent(WStype_t type, uint8_t *payload, size_t length) {
+  trace(TRACE_WS_RECV, type, length);
+
   if (type == WStype_TEXT) {
-    JsonDocument doc;
-    deserializeJson(doc, payload);
-
-    if (doc.containsKey("card_info_response")) {
-      parseCardInfoResponse(doc["card_info_response"]);
-    } else if (doc.containsKey("solve_confirm")) {
-      parseSolveConfirm(doc["solve_confirm"]);
-    } else if (doc.containsKey("delegate_response")) {
-      parseDelegateResponse(doc["delegate_response"]);
-    } else if (doc.containsKey("device_settings")) {
-      parseDeviceSettings(doc["device_settings"]);
-    } else if (doc.containsKey("start_update")) {
-      parseStartUpdate(doc["start_update"]);
-    } else if (doc.containsKey("api_error")) {
-      parseApiError(doc["api_error"]);
-    } else if (doc.containsKey("test_packet")) {
-      parseTestPacket(doc["test_packet"]);
-    } else if (doc.containsKey("epoch_time")) {
-      parseEpochTime(doc["epoch_time"]);
-    }
+    parseTextFrame(payload, length);
   } else if (type == WStype_BIN) {
     parseUpdateData(payload, length);
+  } else if (type == WStype_PONG) {
+    linkOnPong(payload, length);
   } else if (type == WStype_CONNECTED) {
     Serial.println("Connected to WebSocket server"); // do not send to logger
+    wsConnects++;
+    tlsOnConnected();
+    linkOnConnected();
+    stateStreamOnConnected();
+    requestsOnConnected();
+    sendBlackBox();
   } else if (type == WStype_DISCONNECTED) {
     Serial.println("Disconnected from WebSocket server"); // do not send to logger
+    linkOnDisconnected(waitForSolveResponse || waitForDelegateResponse || hasPendingRequest(REQUEST_ANY));
+    transportOnDisconnected();
 
-    // TODO: remove this (if packet queuening is added for backend)
-    if(waitForSolveResponse || waitForDelegateResponse) {
+    // solve is kept and resent after reconnect, delegate decision isn't
+    requestsOnDisconnected();
+    if (waitForDelegateResponse || (waitForSolveResponse && !hasPendingRequest(REQUEST_SOLVE))) {
       showError("Server not connected!");
       waitForSolveResponse = false;
       waitForDelegateResponse = false;
@@ -0,0 +1,319 @@
+#ifndef __RFID_HPP__
+#define __RFID_HPP__
+
+#include <Arduino.h>
+#include <inttypes.h>
+#include "globals.hpp"
+#include "defines.h"
+#include "pins.h"
+#include "state.hpp"
+
+// Card detection is split into small steps, so core2 is never stalled
+// for whole transaction (MFRC522 internal timer answers with TimerIRq).
+// Every frame (REQA, anticollision, select, halt) is started and then polled.
+enum RfidStep {
+  RFID_IDLE,          // waiting for next poll
+  RFID_ANTENNA_SETTLE,// antenna turned on (low power mode), card is powering up
+  RFID_WAIT_ATQA,     // REQA sent, waiting for RxIRq/TimerIRq
+  RFID_WAIT_UID,      // anticollision sent (current cascade level), waiting for uid part + BCC
+  RFID_WAIT_SAK,      // select sent, waiting for SAK
+  RFID_WAIT_HALT      // HLTA sent, waiting until it leaves (card doesn't answer)
+};
+
+enum RfidAnswer {
+  RFID_PENDING,
+  RFID_ANSWERED, // response is in fifo
+  RFID_FAILED    // no card, timeout or rx error
+};
+
+RfidStep rfidStep = RFID_IDLE;
+unsigned long rfidStepStarted = 0;
+unsigned long lastRfidPoll = 0;
+bool rfidLowPower = false;
+bool rfidAntennaOn = true;
+
+const byte rfidSelectCmds[3] = {MFRC522Constants::PICC_CMD_SEL_CL1, MFRC522Constants::PICC_CMD_SEL_CL2,
+                                MFRC522Constants::PICC_CMD_SEL_CL3};
+byte rfidCascade = 0;   // cascade level being selected (0-2)
+byte rfidUidPart[5];    // uid part + BCC of current cascade level
+byte rfidUid[10];
+byte rfidUidSize = 0;
+
+unsigned long lastCardReadTime = 0;
+card_id_t lastCardId = 0;
+
+#ifdef RFID_IRQ
+volatile bool rfidIrq = false;
+
+void IRAM_ATTR rfidIrqHandler() {
+  rfidIrq = true;
+}
+#endif
+
+inline void rfidSetBits(MFRC522Constants::PCD_Register reg, byte mask) {
+  driver.PCD_WriteRegister(reg, driver.PCD_ReadRegister(reg) | mask);
+}
+
+inline void rfidClearBits(MFRC522Constants::PCD_Register reg, byte mask) {
+  driver.PCD_WriteRegister(reg, driver.PCD_ReadRegister(reg) & (~mask));
+}
+
+void rfidInit() {
+  mfrc522.PCD_Init();
+
+#ifdef RFID_IRQ
+  pinMode(RFID_IRQ, INPUT_PULLUP);
+  // IRqInv (active low) + RxIEn + TimerIEn, IRQ pin as push-pull
+  driver.PCD_WriteRegister(MFRC522Constants::ComIEnReg, 0xA1);
+  driver.PCD_WriteRegister(MFRC522Constants::DivIEnReg, 0x80);
+  attachInterrupt(digitalPinToInterrupt(RFID_IRQ), rfidIrqHandler, FALLING);
+#endif
+}
+
+/// @brief Writes frame into fifo and starts transceive (answer is polled by rfidPollAnswer)
+/// @param txLastBits number of bits of last byte to send (0 - whole byte)
+void rfidTransceive(const byte *data, byte len, byte txLastBits, RfidStep next) {
+  driver.PCD_WriteRegister(MFRC522Constants::CommandReg, MFRC522Constants::PCD_Idle);
+  driver.PCD_WriteRegister(MFRC522Constants::ComIrqReg, 0x7F);    // clear irq bits
+  driver.PCD_WriteRegister(MFRC522Constants::FIFOLevelReg, 0x80); // flush fifo
+  driver.PCD_WriteRegister(MFRC522Constants::FIFODataReg, len, (byte *)data);
+  driver.PCD_WriteRegister(MFRC522Constants::BitFramingReg, txLastBits);
+  driver.PCD_WriteRegister(MFRC522Constants::CommandReg, MFRC522Constants::PCD_Transceive);
+
+#ifdef RFID_IRQ
+  rfidIrq = false;
+#endif
+  rfidSetBits(MFRC522Constants::BitFramingReg, 0x80); // StartSend
+
+  rfidStep = next;
+  rfidStepStarted = millis();
+}
+
+/// @brief Checks frame started by rfidTransceive (never waits)
+RfidAnswer rfidPollAnswer() {
+#ifdef RFID_IRQ
+  if (!rfidIrq && millis() - rfidStepStarted < RFID_REQUEST_TIMEOUT) return RFID_PENDING;
+#endif
+  byte irq = driver.PCD_ReadRegister(MFRC522Constants::ComIrqReg);
+
+  if (irq & 0x20) { // RxIRq
+    byte error = driver.PCD_ReadRegister(MFRC522Constants::ErrorReg);
+    return (error & 0x1B) == 0 ? RFID_ANSWERED : RFID_FAILED; // BufferOvfl, CollErr, ParityErr, ProtocolErr
+  }
+
+  if ((irq & 0x01) || millis() - rfidStepStarted >= RFID_REQUEST_TIMEOUT) return RFID_FAILED; // TimerIRq
+  return RFID_PENDING;
+}
+
+/// @return number of received bytes (0 if answer has different length than expected)
+byte rfidReadAnswer(byte *buffer, byte expected) {
+  byte n = driver.PCD_ReadRegister(MFRC522Constants::FIFOLevelReg) & 0x7F;
+  if (n != expected) return 0;
+
+  driver.PCD_ReadRegister(MFRC522Constants::FIFODataReg, n, buffer, 0);
+  return n;
+}
+
+/// @brief ISO/IEC 14443-3 CRC_A (computed here, MFRC522 CRC coprocessor would have to be polled too)
+uint16_t rfidCrcA(const byte *data, byte len) {
+  uint16_t crc = 0x6363;
+  for (byte i = 0; i < len; i++) {
+    byte b = data[i] ^ (byte)crc;
+    b ^= b << 4;
+    crc = (crc >> 8) ^ ((uint16_t)b << 8) ^ ((uint16_t)b << 3) ^ (b >> 4);
+  }
+
+  return crc;
+}
+
+/// @brief Sends REQA without waiting for the answer
+void rfidStartRequest() {
+  // card left in different mode (or with crc enabled) would ignore REQA
+  driver.PCD_WriteRegister(MFRC522Constants::TxModeReg, 0x00);
+  driver.PCD_WriteRegister(MFRC522Constants::RxModeReg, 0x00);
+  driver.PCD_WriteRegister(MFRC522Constants::ModWidthReg, 0x26);
+  rfidClearBits(MFRC522Constants::CollReg, 0x80);
+
+  byte reqa = MFRC522Constants::PICC_CMD_REQA;
+  rfidTransceive(&reqa, 1, 0x07, RFID_WAIT_ATQA); // short frame (7 bits)
+}
+
+/// @brief Anticollision of current cascade level (NVB 0x20 - card sends whole uid part)
+void rfidStartAnticollision() {
+  byte frame[2] = {rfidSelectCmds[rfidCascade], 0x20};
+  rfidTransceive(frame, sizeof(frame), 0, RFID_WAIT_UID);
+}
+
+void rfidStartSelect() {
+  byte frame[9] = {rfidSelectCmds[rfidCascade], 0x70};
+  memcpy(frame + 2, rfidUidPart, 5);
+
+  uint16_t crc = rfidCrcA(frame, 7);
+  frame[7] = crc & 0xFF;
+  frame[8] = crc >> 8;
+  rfidTransceive(frame, sizeof(frame), 0, RFID_WAIT_SAK);
+}
+
+void rfidStartHalt() {
+  byte frame[4] = {MFRC522Constants::PICC_CMD_HLTA, 0};
+
+  uint16_t crc = rfidCrcA(frame, 2);
+  frame[2] = crc & 0xFF;
+  frame[3] = crc >> 8;
+  rfidTransceive(frame, sizeof(frame), 0, RFID_WAIT_HALT);
+}
+
+void rfidSetAntenna(bool on) {
+  if (rfidAntennaOn == on) return;
+
+  if (on) mfrc522.PCD_AntennaOn();
+  else mfrc522.PCD_AntennaOff();
+  rfidAntennaOn = on;
+}
+
+void rfidEndPoll() {
+  rfidStep = RFID_IDLE;
+  if (rfidLowPower) rfidSetAntenna(false);
+}
+
+/// @brief Card id of whole UID
+/// 4 and 7 byte UIDs are packed little endian (4 byte ids keep the same value as
+/// before), 10 byte UIDs don't fit so they are FNV-1a hashed with top bit set
+/// (packed ids are below 2^56, so hashed ones never equal them)
+card_id_t uidToCardId(const byte *uid, byte size) {
+  card_id_t id = 0;
+  if (size <= 8) {
+    for (byte i = 0; i < size; i++) {
+      id |= (card_id_t)uid[i] << (i * 8);
+    }
+
+    return id;
+  }
+
+  id = 0xcbf29ce484222325ULL; // FNV-1a 64 offset basis
+  for (byte i = 0; i < size; i++) {
+    id ^= uid[i];
+    id *= 0x100000001b3ULL;
+  }
+
+  return id | (1ULL << 63);
+}
+
+void rfidCardPresent(const byte *uid, byte size) {
+  card_id_t cardId = uidToCardId(uid, size);
+  trace(TRACE_RFID, size, (uint32_t)cardId);
+  if (lastCardId == cardId && millis() - lastCardReadTime < 2500) return; // if same as last card (in 2.5s)
+
+  Logger.logf(LOG_INFO, "Scanned card ID: %" PRIu64 "\n", cardId);
+  scanCard(cardId);
+  lastCardId = cardId;
+  lastCardReadTime = millis();
+}
+
+/// @brief Handles SAK of current cascade level
+void rfidSelected() {
+  byte sak[3];
+  if (rfidReadAnswer(sak, 3) == 0 || rfidCrcA(sak, 1) != (sak[1] | (sak[2] << 8))) {
+    rfidEndPoll();
+    return;
+  }
+
+  if (sak[0] & 0x04) { // uid not complete, first byte of this part is cascade tag
+    if (rfidUidPart[0] != MFRC522Constants::PICC_CMD_CT || rfidCascade == 2) {
+      rfidEndPoll();
+      return;
+    }
+
+    memcpy(rfidUid + rfidUidSize, rfidUidPart + 1, 3);
+    rfidUidSize += 3;
+    rfidCascade++;
+    rfidStartAnticollision();
+    return;
+  }
+
+  memcpy(rfidUid + rfidUidSize, rfidUidPart, 4);
+  rfidUidSize += 4;
+  rfidStartHalt();
+  rfidCardPresent(rfidUid, rfidUidSize);
+}
+
+/// @brief Non blocking card detection (every call does at most one step)
+/// @param lowPower poll less often and keep antenna off between polls
+void rfidLoop(bool lowPower) {
+  rfidLowPower = lowPower;
+
+  switch (rfidStep) {
+    case RFID_IDLE: {
+      if (millis() - lastCardReadTime < 500) return;
+
+      unsigned long interval = lowPower ? RFID_LOW_POWER_POLL_INTERVAL : RFID_POLL_INTERVAL;
+      if (millis() - lastRfidPoll < interval) return;
+      lastRfidPoll = millis();
+
+      if (!rfidAntennaOn) {
+        rfidSetAntenna(true);
+        rfidStep = RFID_ANTENNA_SETTLE;
+        rfidStepStarted = millis();
+        return;
+      }
+
+      rfidStartRequest();
+      return;
+    }
+
+    case RFID_ANTENNA_SETTLE:
+      if (millis() - rfidStepStarted < RFID_ANTENNA_SETTLE_TIME) return;
+      rfidStartRequest();
+      return;
+
+    case RFID_WAIT_ATQA: {
+      RfidAnswer answer = rfidPollAnswer();
+      if (answer == RFID_PENDING) return;
+      if (answer == RFID_FAILED) {
+        rfidEndPoll();
+        return;
+      }
+
+      rfidCascade = 0;
+      rfidUidSize = 0;
+      rfidStartAnticollision();
+      return;
+    }
+
+    case RFID_WAIT_UID: {
+      RfidAnswer answer = rfidPollAnswer();
+      if (answer == RFID_PENDING) return;
+
+      // 4 uid bytes + BCC (xor of them), collision with second card is retried on next poll
+      byte *p = rfidUidPart;
+      if (answer == RFID_FAILED || rfidReadAnswer(p, 5) == 0 || (p[0] ^ p[1] ^ p[2] ^ p[3] ^ p[4]) != 0) {
+        rfidEndPoll();
+        return;
+      }
+
+      rfidStartSelect();
+      return;
+    }
+
+    case RFID_WAIT_SAK: {
+      RfidAnswer answer = rfidPollAnswer();
+      if (answer == RFID_PENDING) return;
+      if (answer == RFID_FAILED) {
+        rfidEndPoll();
+        return;
+      }
+
+      rfidSelected();
+      return;
+    }
+
+    case RFID_WAIT_HALT:
+      // TxIRq - frame was sent, card doesn't answer HLTA
+      if (!(driver.PCD_ReadRegister(MFRC522Constants::ComIrqReg) & 0x40) && millis() - rfidStepStarted < 2) return;
+      driver.PCD_WriteRegister(MFRC522Constants::CommandReg, MFRC522Constants::PCD_Idle);
+      rfidEndPoll();
+      return;
+  }
+}
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef __STANDBY_HPP__
+#define __STANDBY_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WiFi.h>
+#include <sys/time.h>
+#include <driver/rtc_io.h>
+#include <ws_logger.h>
+#include "pins.h"
+#include "globals.hpp"
+#include "utils.hpp"
+#include "state.hpp"
+#include "radio/wake.hpp"
+#include "radio/discovery.hpp"
+
+#define STANDBY_MAGIC 0x57A4DB11
+
+// Kept in rtc slow memory through deep sleep (wifi and ws cache are in wake.hpp)
+struct StandbyState {
+  uint32_t magic;
+  uint32_t count;
+  int64_t epochUs;       // clockEpochUs() before sleep (0 if not synced)
+  uint32_t epochErrMs;
+  int64_t sleptAt;       // gettimeofday() in us, rtc timer keeps running in deep sleep
+  float batteryLevel;    // % before sleep
+
+  char solveSessionId[UUID_LENGTH];
+  int solveTime;
+  int penalty;
+  bool useInspection;
+  unsigned long inspectionTime; // finished inspection (ms), millis() restart after deep sleep
+  bool timeConfirmed;
+  card_id_t competitorCardId;
+  card_id_t judgeCardId;
+  char competitorDisplay[128];
+};
+
+RTC_DATA_ATTR StandbyState standby = {};
+
+bool standbyResumed = false;
+uint32_t standbySlept = 0;          // s
+unsigned long standbyResumeTime = 0; // ms from boot to websocket connected
+float standbyDrainRate = -1;        // %/h while in deep sleep
+
+int64_t standbyNowUs() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/// @brief Detects resume from deep sleep, call at the beginning of setup
+void standbyInit() {
+  esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+  if (cause != ESP_SLEEP_WAKEUP_EXT0 && cause != ESP_SLEEP_WAKEUP_EXT1) return;
+  if (standby.magic != STANDBY_MAGIC) return;
+
+  // wake pins are still configured as rtc io
+  rtc_gpio_hold_dis(SLEEP_WAKE_BUTTON);
+  rtc_gpio_deinit(SLEEP_WAKE_BUTTON);
+  rtc_gpio_deinit((gpio_num_t)BUTTON1);
+
+  standbyResumed = true;
+  standbySlept = (standbyNowUs() - standby.sleptAt) / 1000000;
+  standby.magic = 0;
+
+  // no need to wait for epoch from server (time_sync corrects it later)
+  if (standby.epochUs > 0) {
+    int64_t sleptUs = standbyNowUs() - standby.sleptAt;
+    clockSetEpoch(standby.epochUs + sleptUs, standby.epochErrMs * 1000LL + (int64_t)(sleptUs * CLOCK_RTC_SLEEP_ERROR));
+  }
+}
+
+/// @brief Restores solve session saved before deep sleep (call instead of eeprom restore)
+void standbyRestoreState() {
+  strcpy(state.solveSessionId, standby.solveSessionId);
+  state.solveTime = standby.solveTime;
+  state.lastSolveTime = standby.solveTime;
+  state.penalty = standby.penalty;
+  state.useInspection = standby.useInspection;
+  state.timeConfirmed = standby.timeConfirmed;
+  state.competitorCardId = standby.competitorCardId;
+  state.judgeCardId = standby.judgeCardId;
+  strncpy(state.competitorDisplay, standby.competitorDisplay, 128);
+
+  // rebased onto current millis, only the duration is used (penalty, solve frame)
+  state.inspectionStarted = 0;
+  state.inspectionEnded = 0;
+  if (standby.inspectionTime > 0) {
+    state.inspectionEnded = millis();
+    state.inspectionStarted = state.inspectionEnded - standby.inspectionTime;
+  }
+
+  if (state.solveTime > 0) {
+    state.currentScene = SCENE_FINISHED_TIME;
+  } else if (state.competitorCardId > 0) {
+    state.currentScene = SCENE_COMPETITOR_INFO;
+  } else {
+    state.currentScene = SCENE_WAITING_FOR_COMPETITOR;
+  }
+}
+
+/// @brief Connects to cached ap and server (without WiFiManager and mdns)
+/// @return false if cache is missing or connection failed (use initWifi)
+bool standbyFastConnect() {
+  if (!standbyResumed || !wifiCache.valid || !wsCache.valid) return false;
+
+  WiFi.mode(WIFI_STA);
+  WiFi.persistent(false);
+  WiFi.begin(wifiCache.ssid, wifiCache.psk, wifiCache.channel, wifiCache.bssid, true);
+
+  unsigned long start = millis();
+  while (WiFi.status() != WL_CONNECTED) {
+    if (millis() - start > WAKE_FAST_CONNECT_TIMEOUT) {
+      Logger.printf("Fast wifi connect failed, falling back to full init\n");
+      WiFi.disconnect();
+      return false;
+    }
+
+    delay(5);
+  }
+
+  wifiConnected = true;
+  configTime(3600, 0, "pool.ntp.org", "time.nist.gov", "time.google.com");
+  wsBegin(wsCache.host, wsCache.port, wsCache.path, wsCache.secure);
+  strcpy(wsCurrentUrl, wsCache.url);
+
+  Logger.printf("Resumed from standby (slept %lu s), wifi in %lu ms\n", (unsigned long)standbySlept, millis() - start);
+  return true;
+}
+
+void standbyEnter() {
+  standby.magic = STANDBY_MAGIC;
+  standby.count++;
+  standby.epochUs = clockEpochUs();
+  standby.epochErrMs = clockErrorMs();
+  standby.sleptAt = standbyNowUs();
+  standby.batteryLevel = voltageToPercentage(batteryVoltage());
+
+  strcpy(standby.solveSessionId, state.solveSessionId);
+  standby.solveTime = state.solveTime;
+  standby.penalty = state.penalty;
+  standby.useInspection = state.useInspection;
+  // unfinished inspection is dropped, it can't be timed across deep sleep
+  standby.inspectionTime = state.inspectionEnded != 0 ? state.inspectionEnded - state.inspectionStarted : 0;
+  standby.timeConfirmed = state.timeConfirmed;
+  standby.competitorCardId = state.competitorCardId;
+  standby.judgeCardId = state.judgeCardId;
+  strncpy(standby.competitorDisplay, state.competitorDisplay, 128);
+
+  Logger.println("Going into deep sleep standby...");
+  Logger.loop(true);
+  outboundFlush();
+  Serial.flush();
+  lcd.clear();
+  lcd.noBacklight();
+
+  // stackmat jack (timer turned on) or submit button
+  esp_sleep_enable_ext0_wakeup(SLEEP_WAKE_BUTTON, LOW);
+  rtc_gpio_pullup_en((gpio_num_t)BUTTON1);
+  rtc_gpio_pulldown_dis((gpio_num_t)BUTTON1);
+  esp_sleep_enable_ext1_wakeup(1ULL << BUTTON1, ESP_EXT1_WAKEUP_ALL_LOW);
+  esp_deep_sleep_start();
+}
+
+void standbyLoop() {
+  if (!standbyResumed || standbyResumeTime > 0) return;
+  if (!webSocket.isConnected()) return;
+
+  standbyResumeTime = millis();
+
+  // adc noise is ~1%, so drain is meaningful only after longer sleep
+  float level = voltageToPercentage(batteryVoltage());
+  if (standbySlept > STANDBY_DRAIN_MIN_TIME) {
+    standbyDrainRate = (standby.batteryLevel - level) / (standbySlept / 3600.0);
+  }
+
+  Logger.printf("Standby resume to ready: %lu ms\n", standbyResumeTime);
+}
+
+void addStandbyStats(JsonObject obj) {
+  obj["count"] = standby.count;
+  obj["resumed"] = standbyResumed;
+  if (!standbyResumed) return;
+
+  obj["slept"] = standbySlept;
+  obj["resume_ms"] = standbyResumeTime;
+  if (standbyDrainRate >= 0) {
+    obj["drain_rate"] = standbyDrainRate; // %/h
+    obj["est_current_ma"] = standbyDrainRate / 100.0 * BATTERY_CAPACITY_MAH;
+  }
+}
+
+#endif
@@ -4,12 +4,22 @@
 #include "lcd.hpp"
 #include "translations.h"
 #include "ws_logger.h"
+#include "radio/requests.hpp"
+#include "card_cache.hpp"
+#include "history.hpp"
+#include "trace.hpp"
+#include "radio/link.hpp"
 #include <UUID.h>
+#include <inttypes.h>
+#include <base64.h>
 #include <stackmat.h>
 
 #define UUID_LENGTH 37
 void sendSolve(bool delegate);
 void stopInspection();
+void applyCardInfo(card_id_t cardId, const char *display, const char *countryIso2, bool canCompete);
+void clockLoop();
+void wsLoop();
 
 UUID uuid;
 bool stateHasChanged = true;
@@ -20,6 +30,7 @@ bool waitForDelegateResponse = false;
 bool lastWifiConnected = false;
 bool lastServerConnected = false;
 bool lastStackmatConnected = false;
+bool lastLinkDegraded = false;
 
 int testModeStackmatTime = 0; //mock of stackmat time for testmode
 
@@ -49,8 +60,8 @@ struct State {
   unsigned long inspectionStarted = 0;
   unsigned long inspectionEnded = 0;
 
-  unsigned long competitorCardId = 0;
-  unsigned long judgeCardId = 0;
+  card_id_t competitorCardId = 0;
+  card_id_t judgeCardId = 0;
   char competitorDisplay[128]; // max 128 chars
 
   bool timeConfirmed = false;
@@ -64,7 +75,7 @@ struct State {
 
 struct EEPROMState {
   char solveSessionId[UUID_LENGTH];
-  unsigned long competitorCardId;
+  card_id_t competitorCardId;
   unsigned long inspectionStarted;
   unsigned long inspectionEnded;
   unsigned long saveTime;
@@ -110,9 +121,11 @@ void readState() {
 }
 
 void initState() {
+  WATCHDOG_SECTION(SECTION_INIT_STATE);
   unsigned long currentEpoch = 0;
   while((currentEpoch = getEpoch()) == 0) {
-    webSocket.loop();
+    wsLoop();
+    clockLoop();
     delay(5);
   }
 
@@ -149,13 +162,24 @@ void checkConnectionStatus() {
     stateHasChanged = true;
   }
 
+  if (linkDegraded != lastLinkDegraded) {
+    lastLinkDegraded = linkDegraded;
+    stateHasChanged = true;
+  }
+
   if (WiFi.isConnected() != lastWifiConnected) {
     lastWifiConnected = WiFi.isConnected();
     stateHasChanged = true;
   }
 }
 
+StateScene tracedScene = SCENE_NOT_INITALIZED;
 void stateLoop() {
+  if (state.currentScene != tracedScene) {
+    trace(TRACE_SCENE, state.currentScene, tracedScene);
+    tracedScene = state.currentScene;
+  }
+
   checkConnectionStatus();
   if (!stateHasChanged || lockStateChange)
     return;
@@ -199,6 +223,10 @@ void stateLoop() {
     stateHasChanged = false;
     return;
   } else if (state.currentScene == SCENE_WAITING_FOR_COMPETITOR) {
+#ifdef LCD_LINK_STATUS
+    if (linkDegraded) lcdPrintf(0, true, ALIGN_CENTER, "%lums %u%%", (unsigned long)(linkSrtt / 1000), linkLoss());
+    else
+#endif
     lcdPrintf(0, true, ALIGN_CENTER, TR_AWAITING_COMPETITOR_TOP);
     lcdPrintf(1, true, ALIGN_CENTER, TR_AWAITING_COMPETITOR_BOTTOM);
   } else if (state.currentScene == SCENE_WAITING_FOR_COMPETITOR_WITH_TIME) {
@@ -291,6 +319,8 @@ void startSolveSession(int solveTime) {
   state.timeConfirmed = false;
   waitForSolveResponse = false;
   waitForDelegateResponse = false;
+  cancelRequests(REQUEST_SOLVE);
+  cancelRequests(REQUEST_DELEGATE);
   state.currentScene = SCENE_FINISHED_TIME;
 
   int inspectionTime = state.inspectionEnded - state.inspectionStarted;
@@ -301,7 +331,7 @@ void startSolveSession(int solveTime) {
     state.penalty = -1;
   }
 
-  Logger.printf("Start Solve Session\n");
+  Logger.logf(LOG_INFO, "Start Solve Session\n");
 
   stateHasChanged = true;
   saveState();
@@ -318,6 +348,8 @@ void resetSolveState(bool save = true) {
   memset(state.competitorDisplay, ' ', sizeof(state.competitorDisplay));
   waitForSolveResponse = false;
   waitForDelegateResponse = false;
+  cancelRequests(REQUEST_SOLVE);
+  cancelRequests(REQUEST_DELEGATE);
   state.currentScene = SCENE_WAITING_FOR_COMPETITOR;
 
   clearDisplay();
@@ -368,16 +400,21 @@ void sendSolve(bool delegate) {
   doc["solve"]["judge_id"] = state.judgeCardId;
   doc["solve"]["esp_id"] = getEspId();
   doc["solve"]["timestamp"] = getEpoch();
+  doc["solve"]["timestamp_ms"] = clockEpochMs();
   doc["solve"]["session_id"] = state.solveSessionId;
   doc["solve"]["delegate"] = delegate;
   doc["solve"]["inspection_time"] =
       state.inspectionEnded - state.inspectionStarted;
 
-  String json;
-  serializeJson(doc, json);
-  webSocket.sendTXT(json);
+  PROBE_START(PROBE_SUBMIT_ACK);
+  RequestType type = delegate ? REQUEST_DELEGATE : REQUEST_SOLVE;
+  cancelRequests(type); // only latest solve is awaited
+  sendRequest(type, doc, "solve");
+  historyAppend(state.solveSessionId, state.competitorCardId, state.judgeCardId, state.solveTime, state.penalty,
+                state.inspectionEnded - state.inspectionStarted, delegate, clockEpochMs());
 
   if (!webSocket.isConnected()) {
+    if (delegate) cancelRequests(type); // solve is sent after reconnect
     showError("Server not connected!");
   }
 
@@ -387,17 +424,44 @@ void sendSolve(bool delegate) {
   stateHasChanged = true;
 }
 
-void scanCard(unsigned long cardId) {
+void scanCard(card_id_t cardId) {
+  PROBE_START(PROBE_CARD_INFO);
+
   JsonDocument doc;
   doc["card_info_request"]["card_id"] = cardId;
   doc["card_info_request"]["esp_id"] = getEspId();
-
-  String json;
-  serializeJson(doc, json);
-  webSocket.sendTXT(json);
+  uint32_t requestId = sendRequest(REQUEST_CARD_INFO, doc, "card_info_request");
+
+  // answer from cache right away (state is changed on core 1, see scannedCardLoop),
+  // server response only confirms it
+  CardInfo cached;
+  bool isCached = cardCacheGet(cardId, cached);
+  if (isCached) {
+    markRequestAnswered(requestId);
+    cardCacheQueueHit(cached);
+  }
 
   if(!webSocket.isConnected()) {
-    showError("Server not connected!");
+    resolveRequest(requestId, REQUEST_CARD_INFO);
+    if (!isCached) showError("Server not connected!");
+  }
+}
+
+/// @brief Applies cached card info of card scanned on core 0, call from loop
+void scannedCardLoop() {
+  CardInfo cached;
+  if (!cardCacheTakeHit(cached)) return;
+
+  applyCardInfo(cached.cardId, cached.display, cached.countryIso2, cached.canCompete);
+}
+
+void requestFailed(RequestType type) {
+  if (type == REQUEST_SOLVE && waitForSolveResponse) {
+    waitForSolveResponse = false;
+    showError("Server timeout!");
+  } else if (type == REQUEST_DELEGATE && waitForDelegateResponse) {
+    waitForDelegateResponse = false;
+    showError("Server timeout!");
   }
 }
 
@@ -428,19 +492,44 @@ void sendSnapshotData() {
   doc["snapshot"]["error_msg"] = state.errorMsg;
   doc["snapshot"]["lcd_buffer"] = tmpLcdBuff.c_str();
   doc["snapshot"]["free_heap_size"] = esp_get_free_heap_size();
+  addRequestStats(doc["snapshot"]["requests"].to<JsonObject>());
+
+  sendFrame(doc, OUT_TELEMETRY, OUT_KEY_SNAPSHOT);
+}
+
+void sendLatencyStats(bool reset) {
+  JsonDocument doc;
+  doc["latency"]["esp_id"] = getEspId();
+  addLatencyStats(doc["latency"].to<JsonObject>(), reset);
+
+  sendFrame(doc, OUT_TELEMETRY, OUT_KEY_LATENCY);
+}
+
+void sendTraceDump() {
+  static TraceEvent events[TRACE_SIZE];
+  size_t count = traceSnapshot(events, TRACE_SIZE);
+
+  size_t offset = 0;
+  do {
+    size_t n = min(count - offset, (size_t)TRACE_DUMP_CHUNK);
+
+    JsonDocument doc;
+    doc["trace_dump"]["esp_id"] = getEspId();
+    doc["trace_dump"]["now_us"] = micros();
+    doc["trace_dump"]["offset"] = offset;
+    doc["trace_dump"]["total"] = count;
+    doc["trace_dump"]["data"] = base64::encode((uint8_t *)&events[offset], n * sizeof(TraceEvent));
+    sendFrame(doc, OUT_TELEMETRY);
 
-  String json;
-  serializeJson(doc, json);
-  webSocket.sendTXT(json);
+    offset += n;
+  } while (offset < count);
 }
 
 void sendTestAck() {
   JsonDocument doc;
   doc["test_ack"]["esp_id"] = getEspId();
 
-  String json;
-  serializeJson(doc, json);
-  webSocket.sendTXT(json);
+  sendFrame(doc);
 }
 
 void logState() {
@@ -449,8 +538,8 @@ void logState() {
   Logger.printf("Last finished time: %d\n", state.lastSolveTime);
   Logger.printf("Finished time: %d\n", state.solveTime);
   Logger.printf("Penalty: %d\n", state.penalty);
-  Logger.printf("Competitor card: %lu\n", state.competitorCardId);
-  Logger.printf("Judge card: %lu\n", state.judgeCardId);
+  Logger.printf("Competitor card: %" PRIu64 "\n", state.competitorCardId);
+  Logger.printf("Judge card: %" PRIu64 "\n", state.judgeCardId);
   Logger.printf("Inspection started: %lu\n", state.inspectionStarted);
   Logger.printf("Inspection Ended: %lu\n", state.inspectionEnded);
   Logger.printf("Competitor display: \"%s\"\n", state.competitorDisplay);
@@ -0,0 +1,137 @@
+#ifndef __STATE_STREAM_HPP__
+#define __STATE_STREAM_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ws_logger.h>
+#include "globals.hpp"
+#include "defines.h"
+#include "state.hpp"
+#include "radio/frames.hpp"
+
+// Last values sent to subscriber (only fields that changed since are sent)
+struct StreamedState {
+  StateScene scene;
+  char solveSessionId[UUID_LENGTH];
+  int solveTime;
+  int lastSolveTime;
+  int penalty;
+  bool added;
+  bool useInspection;
+  unsigned long inspectionStarted;
+  unsigned long inspectionEnded;
+  card_id_t competitorCardId;
+  card_id_t judgeCardId;
+  char competitorDisplay[128];
+  bool timeConfirmed;
+  bool testMode;
+  StackmatTimerState timerState;
+  char errorMsg[128];
+};
+
+StreamedState streamed;
+bool streamSubscribed = false;
+bool streamKeyframeNeeded = true;
+unsigned long streamInterval = STATE_STREAM_INTERVAL;
+unsigned long streamKeyframeInterval = STATE_STREAM_KEYFRAME_INTERVAL;
+unsigned long streamLastSent = 0;
+unsigned long streamLastKeyframe = 0;
+uint32_t streamSeq = 0;
+
+uint32_t streamDeltas = 0;
+uint32_t streamKeyframes = 0;
+uint32_t streamBytes = 0;
+
+#define STREAM_FIELD(name, field, value)          \
+  if (key || streamed.field != (value)) {         \
+    streamed.field = (value);                     \
+    obj[name] = streamed.field;                   \
+    changed++;                                    \
+  }
+
+#define STREAM_STRING(name, field, value)                       \
+  if (key || strcmp(streamed.field, (value)) != 0) {            \
+    strncpy(streamed.field, (value), sizeof(streamed.field));   \
+    streamed.field[sizeof(streamed.field) - 1] = '\0';          \
+    obj[name] = streamed.field;                                 \
+    changed++;                                                  \
+  }
+
+/// @brief Adds changed fields (all of them for keyframe) and remembers them as sent
+/// @return number of added fields
+int stateStreamDiff(JsonObject obj, bool key) {
+  int changed = 0;
+  STREAM_FIELD("scene", scene, state.currentScene);
+  STREAM_STRING("solve_session_id", solveSessionId, state.solveSessionId);
+  STREAM_FIELD("solve_time", solveTime, state.solveTime);
+  STREAM_FIELD("last_solve_time", lastSolveTime, state.lastSolveTime);
+  STREAM_FIELD("penalty", penalty, state.penalty);
+  STREAM_FIELD("added", added, state.added);
+  STREAM_FIELD("use_inspection", useInspection, state.useInspection);
+  STREAM_FIELD("inspection_started", inspectionStarted, state.inspectionStarted);
+  STREAM_FIELD("inspection_ended", inspectionEnded, state.inspectionEnded);
+  STREAM_FIELD("competitor_card_id", competitorCardId, state.competitorCardId);
+  STREAM_FIELD("judge_card_id", judgeCardId, state.judgeCardId);
+  STREAM_STRING("competitor_display", competitorDisplay, state.competitorDisplay);
+  STREAM_FIELD("time_confirmed", timeConfirmed, state.timeConfirmed);
+  STREAM_FIELD("test_mode", testMode, state.testMode);
+  STREAM_FIELD("timer_state", timerState, stackmat.state());
+  STREAM_STRING("error_msg", errorMsg, state.errorMsg);
+  return changed;
+}
+
+/// @brief {"state_subscribe": {"esp_id", "interval_ms", "keyframe_ms", "enabled"}}
+void parseStateSubscribe(JsonObject doc) {
+  if (doc["esp_id"] != getEspId()) return;
+
+  streamSubscribed = doc["enabled"] | true;
+  streamInterval = max((unsigned long)(doc["interval_ms"] | STATE_STREAM_INTERVAL), (unsigned long)STATE_STREAM_MIN_INTERVAL);
+  streamKeyframeInterval = doc["keyframe_ms"] | STATE_STREAM_KEYFRAME_INTERVAL;
+  streamKeyframeNeeded = true; // new subscriber has nothing to apply deltas to
+
+  Logger.printf("State stream %s (interval: %lu ms, keyframe: %lu ms)\n", streamSubscribed ? "subscribed" : "unsubscribed",
+                streamInterval, streamKeyframeInterval);
+}
+
+void stateStreamOnConnected() {
+  streamKeyframeNeeded = true; // deltas sent while disconnected were lost
+}
+
+/// @brief Sends changed state fields at most every streamInterval (non blocking)
+void stateStreamLoop() {
+  if (!streamSubscribed || !webSocket.isConnected()) return;
+
+  unsigned long now = millis();
+  if (now - streamLastSent < streamInterval) return;
+
+  bool key = streamKeyframeNeeded || (streamKeyframeInterval > 0 && now - streamLastKeyframe >= streamKeyframeInterval);
+
+  JsonDocument doc;
+  JsonObject obj = doc["state_delta"].to<JsonObject>();
+  if (stateStreamDiff(obj, key) == 0) return;
+
+  obj["esp_id"] = getEspId();
+  obj["seq"] = ++streamSeq; // gap - delta was lost, server should resubscribe
+  obj["key"] = key;
+
+  streamLastSent = now;
+  if (key) {
+    streamLastKeyframe = now;
+    streamKeyframeNeeded = false;
+    streamKeyframes++;
+  } else {
+    streamDeltas++;
+  }
+
+  streamBytes += measureJson(doc);
+  sendFrame(doc, OUT_TELEMETRY);
+}
+
+void addStateStreamStats(JsonObject obj) {
+  obj["subscribed"] = streamSubscribed;
+  obj["deltas"] = streamDeltas;
+  obj["keyframes"] = streamKeyframes;
+  obj["bytes"] = streamBytes;
+}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef __TIME_STREAM_HPP__
+#define __TIME_STREAM_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ws_logger.h>
+#include <stackmat.h>
+#include "globals.hpp"
+#include "defines.h"
+#include "clock.hpp"
+#include "radio/frames.hpp"
+
+#define TIME_STREAM_MAGIC 0xB7
+#define TIME_STREAM_FINAL 0x01 // last frame of solve (authoritative time), or of stream disabled mid-run (state ' ')
+#define TIME_STREAM_EPOCH 0x02 // rx_us is epoch, otherwise station local time
+
+// Binary websocket frame (20 bytes, little endian), empty binary frame is ota ack
+struct __attribute__((packed)) TimeStreamFrame {
+  uint8_t magic;
+  uint8_t flags;
+  uint8_t timerState; // StackmatTimerState ('I', ' ', 'S')
+  uint8_t seq;
+  uint32_t espId;
+  uint32_t elapsedMs;
+  int64_t rxUs; // when stackmat frame was received
+};
+
+bool timeStreamEnabled = false;
+unsigned long timeStreamInterval = TIME_STREAM_INTERVAL;
+unsigned long timeStreamLastSent = 0;
+unsigned long timeStreamLastFrame = 0; // stackmat frame count of last sent frame
+bool timeStreamRunning = false;        // running frames were sent, stop frame is due
+uint8_t timeStreamSeq = 0;
+
+uint32_t timeStreamFrames = 0;
+uint32_t timeStreamStops = 0;
+uint32_t timeStreamDropped = 0;
+
+/// @brief {"time_stream": {"esp_id", "interval_ms", "enabled"}}
+void parseTimeStream(JsonObject doc) {
+  if (doc["esp_id"] != getEspId()) return;
+
+  timeStreamEnabled = doc["enabled"] | true;
+  timeStreamInterval = max((unsigned long)(doc["interval_ms"] | TIME_STREAM_INTERVAL), (unsigned long)TIME_STREAM_MIN_INTERVAL);
+  Logger.printf("Time stream %s (interval: %lu ms)\n", timeStreamEnabled ? "enabled" : "disabled", timeStreamInterval);
+}
+
+bool timeStreamSend(StackmatTimerState timerState, uint8_t flags) {
+  if (!wsTransport.connected()) {
+    timeStreamDropped++;
+    return false;
+  }
+
+  TimeStreamFrame frame;
+  frame.magic = TIME_STREAM_MAGIC;
+  frame.timerState = timerState;
+  frame.seq = timeStreamSeq++;
+  frame.espId = getEspId();
+  frame.elapsedMs = stackmat.time();
+
+  // frame age moves rx timestamp back from now (both micros and clock are esp_timer)
+  unsigned long age = micros() - stackmat.frameTime();
+  if (clockSynced) {
+    frame.rxUs = clockEpochUs() - age;
+    flags |= TIME_STREAM_EPOCH;
+  } else {
+    frame.rxUs = clockLocalUs() - age;
+  }
+  frame.flags = flags;
+
+  if (!outboundSendBinary(OUT_STREAM, (const uint8_t *)&frame, sizeof(frame))) {
+    timeStreamDropped++;
+    return false;
+  }
+
+  if (flags & TIME_STREAM_FINAL) {
+    timeStreamStops++;
+  } else {
+    timeStreamFrames++;
+  }
+  return true;
+}
+
+/// @brief Called from stackmat path after local display and solve handling
+void timeStreamLoop(StackmatTimerState timerState) {
+  if (timerState == ST_Unknown) return;
+
+  if (timerState != ST_Running || !timeStreamEnabled) {
+    // stop (or reset without stop) ends stream, sent once with final time,
+    // disabled stream ends with current time
+    if (timeStreamRunning) timeStreamSend(timerState, TIME_STREAM_FINAL);
+    timeStreamRunning = false;
+    return;
+  }
+
+  // only new stackmat frames, rate limited
+  unsigned long frames = stackmat.frames();
+  unsigned long now = millis();
+  if (frames == timeStreamLastFrame || now - timeStreamLastSent < timeStreamInterval) return;
+
+  timeStreamLastFrame = frames;
+  timeStreamLastSent = now;
+  timeStreamRunning = true;
+  timeStreamSend(timerState, 0);
+}
+
+void addTimeStreamStats(JsonObject obj) {
+  obj["enabled"] = timeStreamEnabled;
+  obj["frames"] = timeStreamFrames;
+  obj["stops"] = timeStreamStops;
+  obj["dropped"] = timeStreamDropped;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef __TRACE_HPP__
+#define __TRACE_HPP__
+
+#include <Arduino.h>
+#include <atomic>
+
+#define TRACE_SIZE 512 // events kept in ram (12 bytes each)
+#define TRACE_RTC_SIZE 32 // last events mirrored into rtc memory (see blackbox.hpp)
+
+// Keep in sync with tools/trace_to_chrome.py
+enum TraceEventType : uint8_t {
+  TRACE_SCENE = 1,    // arg0 - new scene, arg1 - previous scene
+  TRACE_STACKMAT = 2, // arg0 - timer state, arg1 - timer time (ms)
+  TRACE_BUTTON = 3,   // arg0 - first pin, arg1 - 1 pressed / 0 released
+  TRACE_RFID = 4,     // arg0 - uid size, arg1 - low 32 bits of card id
+  TRACE_WS_SEND = 5,  // arg0 - 0 websocket / 1 udp, arg1 - frame length
+  TRACE_WS_RECV = 6,  // arg0 - WStype_t, arg1 - frame length
+  TRACE_LCD_FLUSH = 7 // arg1 - draw time (us)
+};
+
+struct TraceEvent {
+  uint32_t us;   // micros() (wraps every ~71 minutes)
+  uint8_t core;
+  uint8_t type;
+  uint16_t arg0;
+  uint32_t arg1;
+};
+
+TraceEvent traceRing[TRACE_SIZE];
+std::atomic<uint32_t> traceHead{0};
+
+// Survives resets (but not power loss)
+RTC_NOINIT_ATTR TraceEvent traceRtcRing[TRACE_RTC_SIZE];
+RTC_NOINIT_ATTR uint32_t traceRtcHead;
+
+/// @brief Records trace event (lock free, a few instructions, safe from both cores)
+inline void trace(TraceEventType type, uint16_t arg0 = 0, uint32_t arg1 = 0) {
+  uint32_t seq = traceHead.fetch_add(1, std::memory_order_relaxed);
+  TraceEvent &e = traceRing[seq % TRACE_SIZE];
+
+  e.us = micros();
+  e.core = xPortGetCoreID();
+  e.type = type;
+  e.arg0 = arg0;
+  e.arg1 = arg1;
+
+  // unwrapped count, blackBoxInit takes all TRACE_RTC_SIZE events once it's past them
+  traceRtcRing[seq % TRACE_RTC_SIZE] = e;
+  traceRtcHead = seq + 1;
+}
+
+/// @brief Copies events from oldest to newest into out
+/// @return number of copied events
+size_t traceSnapshot(TraceEvent *out, size_t maxEvents) {
+  uint32_t head = traceHead.load();
+  uint32_t count = head < TRACE_SIZE ? head : TRACE_SIZE;
+  if (count > maxEvents) count = maxEvents;
+
+  for (uint32_t i = 0; i < count; i++) {
+    out[i] = traceRing[(head - count + i) % TRACE_SIZE];
+  }
+
+  return count;
+}
+
+#endif
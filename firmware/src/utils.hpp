@@ -5,62 +5,125 @@
 #include <driver/rtc_io.h>
 #include "globals.hpp"
 #include "version.h"
+#include "probes.hpp"
+#include "radio/frames.hpp"
+#include "watchdog.hpp"
+#include "power.hpp"
+#include "clock.hpp"
 
 float batteryVoltageOffset = 0;
 
-void lightSleep(gpio_num_t gpio, int level) {
+/// @param timeoutMs wake up after timeout (0 - only gpio)
+/// @return true if waked up by timeout
+bool lightSleep(gpio_num_t gpio, int level, uint64_t timeoutMs = 0) {
+  WATCHDOG_SECTION(SECTION_SLEEP);
   Logger.println("Going into light sleep...");
   Serial.flush();
   Logger.loop(true);
+  outboundFlush();
   webSocket.loop();
+#ifndef SLEEP_KEEP_WIFI
   webSocket.disconnect();
+#endif
 
   rtc_gpio_hold_en(gpio);
   esp_sleep_enable_ext0_wakeup(gpio, level);
+  if (timeoutMs > 0) esp_sleep_enable_timer_wakeup(timeoutMs * 1000);
   esp_light_sleep_start();
+  watchdogResume();
+
+  bool timedOut = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER;
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+  if (timedOut) return true;
 
   Logger.println("Waked up from light sleep...");
+  return false;
 }
 
-uint16_t analogReadMax(int pin, int c = 10, int delayMs = 5) {
-  uint16_t v = 0;
+// calibrated with eFuse adc characteristics (analogReadMilliVolts)
+uint32_t analogReadMaxMilliVolts(int pin, int c = 10, int delayMs = 5) {
+  uint32_t v = 0;
   for (int i = 0; i < c; i++) {
-    v = max(analogRead(pin), v);
+    v = max(analogReadMilliVolts(pin), v);
     delay(delayMs);
   }
 
   return v;
 }
 
-#define MIN_VOLTAGE 3.0 // to change (measure min voltage of cell when esp is turning on)
+#define MIN_VOLTAGE 3.27 // 0% on discharge curve below
 #define MAX_VOLTAGE 4.2
+
+// Li-ion (18650) open circuit voltage -> state of charge, every 5%
+const float socCurve[] = {
+  3.27, 3.61, 3.69, 3.71, 3.73, 3.75, 3.77, 3.79, 3.80, 3.82, 3.84,
+  3.85, 3.87, 3.91, 3.95, 3.98, 4.02, 4.08, 4.11, 4.15, 4.20
+};
+#define SOC_CURVE_POINTS (sizeof(socCurve) / sizeof(socCurve[0]))
+#define SOC_CURVE_STEP (100.0 / (SOC_CURVE_POINTS - 1))
+
 float voltageToPercentage(float voltage) {
-  voltage = constrain(voltage, MIN_VOLTAGE, MAX_VOLTAGE);
+  if (voltage <= socCurve[0]) return 0;
+  if (voltage >= socCurve[SOC_CURVE_POINTS - 1]) return 100;
+
+  size_t i = 1;
+  while (voltage > socCurve[i]) i++;
 
-  return ((voltage - MIN_VOLTAGE) / (MAX_VOLTAGE - MIN_VOLTAGE)) * 100;
+  float part = (voltage - socCurve[i - 1]) / (socCurve[i] - socCurve[i - 1]);
+  return (i - 1 + part) * SOC_CURVE_STEP;
 }
 
-#define V_REF 3.3
 #define READ_OFFSET 1.0 // to change
-#define MAX_ADC 4095.0 // max adc - 1
 #define R1 10000
 #define R2 10000
+inline float milliVoltsToBattery(uint32_t mv) {
+  return mv / 1000.0 * READ_OFFSET * ((R1 + R2) / R2);
+}
+
+/// @brief Blocking read (setup and calibration only, use batteryLoop otherwise)
 float readBatteryVoltage(int pin, int delayMs = 5, bool offset = true) {
-  float val = analogReadMax(pin, 10, delayMs);
-  float voltage = val * READ_OFFSET * (V_REF / MAX_ADC) * ((R1 + R2) / R2);
+  float voltage = milliVoltsToBattery(analogReadMaxMilliVolts(pin, 10, delayMs));
 
   return voltage + (offset ? batteryVoltageOffset : 0);
 }
 
+// Incremental sampling: one adc read per BATTERY_SAMPLE_INTERVAL, max of every
+// BATTERY_WINDOW samples (drops voltage sags during wifi tx) is smoothed with EMA
+unsigned long lastBatterySample = 0;
+uint32_t batteryWindowMax = 0;
+uint8_t batteryWindowCount = 0;
+float batteryFiltered = 0; // without calibration offset
+
+void batteryInit(int pin) {
+  batteryFiltered = readBatteryVoltage(pin, 15, false);
+}
+
+/// @brief Takes at most one adc sample (a few tens of us), call every tick
+void batteryLoop(int pin) {
+  if (millis() - lastBatterySample < BATTERY_SAMPLE_INTERVAL) return;
+  lastBatterySample = millis();
+
+  batteryWindowMax = max(analogReadMilliVolts(pin), batteryWindowMax);
+  if (++batteryWindowCount < BATTERY_WINDOW) return;
+
+  float voltage = milliVoltsToBattery(batteryWindowMax);
+  batteryFiltered = batteryFiltered == 0 ? voltage : batteryFiltered + BATTERY_EMA_ALPHA * (voltage - batteryFiltered);
+  batteryWindowMax = 0;
+  batteryWindowCount = 0;
+}
+
+float batteryVoltage() {
+  return batteryFiltered + batteryVoltageOffset;
+}
+
 void sendBatteryStats(float level, float voltage) {
   JsonDocument doc;
   doc["battery"]["esp_id"] = getEspId();
   doc["battery"]["level"] = level;
   doc["battery"]["voltage"] = voltage;
+  addBatteryLifeStats(doc["battery"].as<JsonObject>());
 
-  String json;
-  serializeJson(doc, json);
-  webSocket.sendTXT(json);
+  sendFrame(doc, OUT_TELEMETRY, OUT_KEY_BATTERY);
 }
 
 #define ADD_DEVICE_FIRMWARE_TYPE "STATION"
@@ -69,15 +132,12 @@ void sendAddDevice() {
   doc["add"]["esp_id"] = getEspId();
   doc["add"]["firmware"] = ADD_DEVICE_FIRMWARE_TYPE;
 
-  String json;
-  serializeJson(doc, json);
-  webSocket.sendTXT(json);
+  sendFrame(doc);
 }
 
-unsigned long epochBase = 0;
+/// @brief Epoch in seconds (0 if clock isn't synced yet)
 unsigned long getEpoch() {
-  if (epochBase == 0) return 0;
-  return epochBase + (millis() / 1000);
+  return clockEpochMs() / 1000;
 }
 
 void clearDisplay(uint8_t filler = 255) {
@@ -110,6 +170,8 @@ void displayStr(String str) {
   }
 
   digitalWrite(DIS_STCP, HIGH);
+  PROBE_END(PROBE_RUNNING_DISPLAY);
+  PROBE_END(PROBE_FINISH_DISPLAY);
 }
 
 String displayTime(uint8_t m, uint8_t s, uint16_t ms, bool special = true) {
@@ -0,0 +1,265 @@
+#ifndef __WATCHDOG_HPP__
+#define __WATCHDOG_HPP__
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+#include <esp_task_wdt.h>
+#include <ws_logger.h>
+#include "defines.h"
+
+#define WATCHDOG_STALLS_SIZE 8 // stall records kept until next metrics frame
+#define WATCHDOG_UNBOUNDED 0xFFFFFFFF
+
+enum WatchdogTask {
+  WDT_LOOP,  // loop() on core 1
+  WDT_LOOP2, // loop2() on core 0
+  WDT_TASKS_COUNT
+};
+
+// Known blocking calls, while one is active task deadline is extended to section budget
+enum WatchdogSection : uint8_t {
+  SECTION_NONE,
+  SECTION_LCD_LOCK,    // waitForLock()
+  SECTION_STACKMAT,    // stackmat.loop() (ReadStackmatString waits up to 1s)
+  SECTION_BUTTONS,     // buttons.loop() (blocks while button is held)
+  SECTION_TEST_BUTTON, // testButtonClick() from ws callback
+  SECTION_INIT_STATE,  // initState() waiting for epoch
+  SECTION_OTA,         // parseUpdateData() delays
+  SECTION_SLEEP,       // light sleep
+  SECTION_WS_CONNECT,  // webSocket.loop() while disconnected (tcp + tls handshake)
+  SECTION_HISTORY,     // history flash sector erase
+  SECTION_COUNT
+};
+
+struct WatchdogSectionInfo {
+  const char *name;
+  uint32_t budget; // ms
+};
+
+const WatchdogSectionInfo watchdogSections[SECTION_COUNT] = {
+  {"none", 0},
+  {"lcd_lock", 500},
+  {"stackmat", 1500},
+  {"buttons", RESET_WIFI_HOLD_TIME + 5000},
+  {"test_button", 20000},
+  {"init_state", 60000},
+  {"ota", 5000},
+  {"sleep", WATCHDOG_UNBOUNDED},
+  {"ws_connect", WS_CONNECT_BUDGET},
+  {"history", 1000},
+};
+
+const char *watchdogTaskNames[WDT_TASKS_COUNT] = {"loop", "loop2"};
+
+struct WatchdogTaskState {
+  TaskHandle_t handle;
+  uint32_t timeout;             // ms between heartbeats
+  volatile uint32_t lastBeat;   // millis
+  volatile uint8_t section;
+  volatile uint32_t sectionStart;
+  volatile bool stalled;        // set by checker, cleared by next heartbeat
+  volatile bool stallLogged;    // stall was reported by watchdogLoop
+  uint8_t stalledSection;
+  uint32_t stalledFor;          // ms without heartbeat when checker noticed it
+};
+
+struct StallRecord {
+  uint8_t task;
+  uint8_t section;
+  uint32_t at;       // millis when task last fed watchdog
+  uint32_t duration; // ms
+};
+
+WatchdogTaskState watchdogTasks[WDT_TASKS_COUNT] = {};
+StallRecord watchdogStalls[WATCHDOG_STALLS_SIZE];
+uint8_t watchdogStallsCount = 0;
+uint32_t watchdogStallsTotal = 0;
+uint32_t watchdogSectionMax[SECTION_COUNT] = {0}; // longest stall per section (ms)
+portMUX_TYPE watchdogMux = portMUX_INITIALIZER_UNLOCKED;
+esp_timer_handle_t watchdogTimer = NULL;
+
+inline WatchdogTaskState *watchdogCurrentTask() {
+  TaskHandle_t current = xTaskGetCurrentTaskHandle();
+  for (int i = 0; i < WDT_TASKS_COUNT; i++) {
+    if (watchdogTasks[i].handle == current) return &watchdogTasks[i];
+  }
+
+  return NULL;
+}
+
+/// @brief Registers calling task, it has to call watchdogFeed at least every timeout ms
+void watchdogRegister(WatchdogTask task, uint32_t timeout) {
+  WatchdogTaskState &t = watchdogTasks[task];
+  t.timeout = timeout;
+  t.lastBeat = millis();
+  t.section = SECTION_NONE;
+  t.stalled = false;
+  t.handle = xTaskGetCurrentTaskHandle();
+}
+
+/// @brief Heartbeat, finishes stall record if task was stalled
+void watchdogFeed() {
+  WatchdogTaskState *t = watchdogCurrentTask();
+  if (t == NULL) return;
+
+  uint32_t now = millis();
+  if (t->stalled) {
+    uint32_t duration = now - t->lastBeat;
+    uint8_t task = t - watchdogTasks;
+
+    portENTER_CRITICAL(&watchdogMux);
+    if (watchdogStallsCount < WATCHDOG_STALLS_SIZE) {
+      watchdogStalls[watchdogStallsCount++] = {task, t->stalledSection, t->lastBeat, duration};
+    }
+    if (duration > watchdogSectionMax[t->stalledSection]) watchdogSectionMax[t->stalledSection] = duration;
+    watchdogStallsTotal++;
+    portEXIT_CRITICAL(&watchdogMux);
+
+    t->stalled = false;
+    t->stallLogged = false;
+    Logger.logf(LOG_WARN, "[watchdog] %s recovered after %lu ms (section: %s)\n",
+                watchdogTaskNames[task], (unsigned long)duration, watchdogSections[t->stalledSection].name);
+  }
+
+  t->lastBeat = now;
+}
+
+/// @brief Marks start of blocking call on calling task
+/// @return previous section (has to be passed to watchdogExit)
+inline uint8_t watchdogEnter(WatchdogSection section) {
+  WatchdogTaskState *t = watchdogCurrentTask();
+  if (t == NULL) return SECTION_NONE;
+
+  uint8_t prev = t->section;
+  t->sectionStart = millis();
+  t->section = section;
+  return prev;
+}
+
+inline void watchdogExit(uint8_t prev) {
+  WatchdogTaskState *t = watchdogCurrentTask();
+  if (t == NULL) return;
+
+  t->section = prev;
+  t->sectionStart = millis();
+}
+
+// Instruments blocking call for the rest of the scope
+struct WatchdogScope {
+  uint8_t prev;
+  WatchdogScope(WatchdogSection section) { prev = watchdogEnter(section); }
+  ~WatchdogScope() { watchdogExit(prev); }
+};
+
+#define WATCHDOG_SECTION(section) WatchdogScope _watchdogScope(section)
+
+/// @brief Restarts heartbeat deadlines of all tasks (after light sleep)
+void watchdogResume() {
+  uint32_t now = millis();
+  for (int i = 0; i < WDT_TASKS_COUNT; i++) {
+    watchdogTasks[i].lastBeat = now;
+  }
+}
+
+// Runs in esp_timer task, so it works even if both loops are blocked. It only
+// marks stalls, esp_timer task is too small (and too important) for logging
+void watchdogCheck(void *arg) {
+  uint32_t now = millis();
+  uint32_t longestStall = 0;
+  bool sleeping = false;
+
+  // whole chip was sleeping, other tasks didn't have a chance to run yet
+  for (int i = 0; i < WDT_TASKS_COUNT; i++) {
+    if (watchdogTasks[i].section == SECTION_SLEEP) sleeping = true;
+  }
+
+  for (int i = 0; i < WDT_TASKS_COUNT && !sleeping; i++) {
+    WatchdogTaskState &t = watchdogTasks[i];
+    if (t.handle == NULL) continue;
+
+    uint32_t lastBeat = t.lastBeat;
+    uint8_t section = t.section;
+    if (now - lastBeat <= t.timeout) continue;
+
+    uint32_t budget = watchdogSections[section].budget;
+    if (section != SECTION_NONE && (budget == WATCHDOG_UNBOUNDED || now - t.sectionStart <= budget)) continue;
+
+    if (now - lastBeat > longestStall) longestStall = now - lastBeat;
+    if (t.stalled) continue;
+
+    t.stalledSection = section;
+    t.stalledFor = now - lastBeat;
+    t.stalled = true;
+  }
+
+#ifdef WATCHDOG_HW_ESCALATE
+  // checker is subscribed to task watchdog (initialized by arduino core, its timeout
+  // applies), stops feeding it when some task is stalled for too long, so hardware
+  // watchdog panics and reboots esp
+  static bool subscribed = false;
+  if (!subscribed) subscribed = esp_task_wdt_add(NULL) == ESP_OK;
+  if (longestStall < WATCHDOG_HW_ESCALATE) esp_task_wdt_reset();
+#endif
+}
+
+void watchdogInit() {
+  esp_timer_create_args_t args = {
+    .callback = watchdogCheck,
+    .arg = NULL,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "watchdog",
+  };
+
+  esp_timer_create(&args, &watchdogTimer);
+  esp_timer_start_periodic(watchdogTimer, WATCHDOG_CHECK_INTERVAL * 1000);
+}
+
+/// @brief Logs stalls noticed by checker (other task is stalled, own stall is logged on recovery)
+void watchdogLoop() {
+  for (int i = 0; i < WDT_TASKS_COUNT; i++) {
+    WatchdogTaskState &t = watchdogTasks[i];
+    if (!t.stalled || t.stallLogged) continue;
+
+    t.stallLogged = true;
+    Logger.logf(LOG_ERROR, "[watchdog] %s stalled for %lu ms (section: %s)\n",
+                watchdogTaskNames[i], (unsigned long)t.stalledFor, watchdogSections[t.stalledSection].name);
+  }
+}
+
+/// @brief Adds stalls since last call into json object
+void addWatchdogStats(JsonObject obj) {
+  StallRecord stalls[WATCHDOG_STALLS_SIZE];
+  uint32_t sectionMax[SECTION_COUNT];
+  uint8_t count;
+  uint32_t total;
+
+  portENTER_CRITICAL(&watchdogMux);
+  count = watchdogStallsCount;
+  total = watchdogStallsTotal;
+  memcpy(stalls, watchdogStalls, sizeof(stalls));
+  memcpy(sectionMax, watchdogSectionMax, sizeof(sectionMax));
+  watchdogStallsCount = 0;
+  portEXIT_CRITICAL(&watchdogMux);
+
+  obj["total"] = total;
+
+  JsonArray recent = obj["recent"].to<JsonArray>();
+  for (int i = 0; i < count; i++) {
+    JsonObject s = recent.add<JsonObject>();
+    s["task"] = watchdogTaskNames[stalls[i].task];
+    s["section"] = watchdogSections[stalls[i].section].name;
+    s["at"] = stalls[i].at;
+    s["duration"] = stalls[i].duration;
+  }
+
+  for (int i = 0; i < SECTION_COUNT; i++) {
+    if (sectionMax[i] > 0) obj["section_max"][watchdogSections[i].name] = sectionMax[i];
+  }
+
+  for (int i = 0; i < WDT_TASKS_COUNT; i++) {
+    if (watchdogTasks[i].stalled) obj["stalled"].add(watchdogTaskNames[i]);
+  }
+}
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef __WS_CA_H__
+#define __WS_CA_H__
+
+// CA certificate of wss:// server (PEM), used when WS_TLS_CA is defined.
+// For local testing paste tools/test_cert.pem generated by tools/test_server.py --tls
+const char wsCaCert[] = R"EOF(
+-----BEGIN CERTIFICATE-----
+-----END CERTIFICATE-----
+)EOF";
+
+#endif
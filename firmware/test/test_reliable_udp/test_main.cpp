@@ -0,0 +1,178 @@
+// ReliableUdp against hand made server datagrams (pio test -e native)
+
+#include <unity.h>
+#include <reliable_udp.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define SESSION 0x12345678
+
+struct Sent {
+  uint8_t type;
+  uint16_t seq;
+  std::string payload;
+};
+
+static std::vector<Sent> sent;
+static std::vector<std::string> received;
+static bool receiverFull = false;
+
+static void onSend(void *ctx, const uint8_t *data, size_t len) {
+  (void)ctx;
+  TEST_ASSERT_TRUE(len >= RUDP_HEADER_SIZE);
+  sent.push_back({data[1], (uint16_t)(data[2] | data[3] << 8), std::string((const char *)data + RUDP_HEADER_SIZE, len - RUDP_HEADER_SIZE)});
+}
+
+static bool onReceive(void *ctx, const uint8_t *data, size_t len) {
+  (void)ctx;
+  if (receiverFull) return false;
+
+  received.push_back(std::string((const char *)data, len));
+  return true;
+}
+
+static std::string datagram(RudpType type, uint16_t seq, const char *payload = "", uint32_t session = SESSION) {
+  uint8_t header[RUDP_HEADER_SIZE] = {RUDP_MAGIC, type, (uint8_t)seq, (uint8_t)(seq >> 8), (uint8_t)session,
+                                      (uint8_t)(session >> 8), (uint8_t)(session >> 16), (uint8_t)(session >> 24)};
+  return std::string((const char *)header, sizeof(header)) + payload;
+}
+
+static void deliver(ReliableUdp &channel, const std::string &d, uint32_t nowUs) {
+  channel.onDatagram((const uint8_t *)d.data(), d.size(), nowUs);
+}
+
+static int countSent(uint8_t type) {
+  int n = 0;
+  for (Sent &s : sent) n += s.type == type;
+  return n;
+}
+
+void setUp() {
+  sent.clear();
+  received.clear();
+  receiverFull = false;
+}
+
+void tearDown() {}
+
+void test_start_sends_hello() {
+  ReliableUdp channel(onSend, onReceive, NULL);
+  channel.start(SESSION, 0);
+
+  TEST_ASSERT_EQUAL(1, sent.size());
+  TEST_ASSERT_EQUAL(RUDP_HELLO, sent[0].type);
+  TEST_ASSERT_FALSE(channel.up(0));
+
+  deliver(channel, datagram(RUDP_HELLO_ACK, sent[0].seq), 1000);
+  TEST_ASSERT_TRUE(channel.up(1000));
+  TEST_ASSERT_FALSE(channel.up(1000 + RUDP_DEAD_TIME * 1000UL));
+}
+
+void test_data_is_delivered_and_acked() {
+  ReliableUdp channel(onSend, onReceive, NULL);
+  channel.start(SESSION, 0);
+  sent.clear();
+
+  deliver(channel, datagram(RUDP_DATA, 7, "{\"a\":1}"), 1000);
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_EQUAL_STRING("{\"a\":1}", received[0].c_str());
+  TEST_ASSERT_EQUAL(1, sent.size());
+  TEST_ASSERT_EQUAL(RUDP_ACK, sent[0].type);
+  TEST_ASSERT_EQUAL(7, sent[0].seq);
+}
+
+void test_duplicate_is_acked_but_not_delivered() {
+  ReliableUdp channel(onSend, onReceive, NULL);
+  channel.start(SESSION, 0);
+  sent.clear();
+
+  deliver(channel, datagram(RUDP_DATA, 3, "x"), 1000);
+  deliver(channel, datagram(RUDP_DATA, 3, "x"), 2000);
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_EQUAL(2, countSent(RUDP_ACK));
+  TEST_ASSERT_EQUAL(1, channel.stats.duplicates);
+
+  // out of order within replay window
+  deliver(channel, datagram(RUDP_DATA, 5, "y"), 3000);
+  deliver(channel, datagram(RUDP_DATA, 4, "z"), 4000);
+  deliver(channel, datagram(RUDP_DATA, 4, "z"), 5000);
+  TEST_ASSERT_EQUAL(3, received.size());
+  TEST_ASSERT_EQUAL(2, channel.stats.duplicates);
+}
+
+void test_rejected_frame_is_not_acked() {
+  ReliableUdp channel(onSend, onReceive, NULL);
+  channel.start(SESSION, 0);
+  sent.clear();
+
+  receiverFull = true;
+  deliver(channel, datagram(RUDP_DATA, 9, "req"), 1000);
+  TEST_ASSERT_EQUAL(0, received.size());
+  TEST_ASSERT_EQUAL(0, countSent(RUDP_ACK));
+  TEST_ASSERT_EQUAL(1, channel.stats.rejected);
+
+  // server retransmits, now there is room
+  receiverFull = false;
+  deliver(channel, datagram(RUDP_DATA, 9, "req"), 300000);
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_EQUAL(1, countSent(RUDP_ACK));
+  TEST_ASSERT_EQUAL(0, channel.stats.duplicates);
+}
+
+void test_ack_frees_window_and_measures_rtt() {
+  ReliableUdp channel(onSend, onReceive, NULL);
+  channel.start(SESSION, 0);
+  sent.clear();
+
+  for (int i = 0; i < RUDP_WINDOW; i++) TEST_ASSERT_TRUE(channel.send((const uint8_t *)"f", 1, 1000));
+  TEST_ASSERT_FALSE(channel.canSend(1));
+  TEST_ASSERT_FALSE(channel.send((const uint8_t *)"f", 1, 1000));
+  TEST_ASSERT_EQUAL(RUDP_WINDOW, countSent(RUDP_DATA));
+
+  deliver(channel, datagram(RUDP_ACK, sent[0].seq), 41000);
+  TEST_ASSERT_TRUE(channel.canSend(1));
+  TEST_ASSERT_EQUAL(40000, channel.stats.srtt);
+}
+
+void test_retransmits_then_gives_up() {
+  ReliableUdp channel(onSend, onReceive, NULL);
+  channel.start(SESSION, 0);
+  deliver(channel, datagram(RUDP_HELLO_ACK, 1), 0); // no fast hellos
+  sent.clear();
+
+  TEST_ASSERT_TRUE(channel.send((const uint8_t *)"solve", 5, 0));
+  uint32_t now = 0;
+  for (int i = 0; i < 200; i++) {
+    now += 100000;
+    channel.loop(now);
+  }
+
+  TEST_ASSERT_EQUAL(1 + RUDP_MAX_RETRIES, countSent(RUDP_DATA));
+  TEST_ASSERT_EQUAL(RUDP_MAX_RETRIES, channel.stats.retransmits);
+  TEST_ASSERT_EQUAL(1, channel.stats.failed);
+  TEST_ASSERT_TRUE(channel.canSend(1));
+}
+
+void test_other_session_is_ignored() {
+  ReliableUdp channel(onSend, onReceive, NULL);
+  channel.start(SESSION, 0);
+  sent.clear();
+
+  deliver(channel, datagram(RUDP_DATA, 1, "x", SESSION + 1), 1000);
+  TEST_ASSERT_EQUAL(0, received.size());
+  TEST_ASSERT_EQUAL(0, sent.size());
+  TEST_ASSERT_FALSE(channel.up(1000));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_start_sends_hello);
+  RUN_TEST(test_data_is_delivered_and_acked);
+  RUN_TEST(test_duplicate_is_acked_but_not_delivered);
+  RUN_TEST(test_rejected_frame_is_not_acked);
+  RUN_TEST(test_ack_frees_window_and_measures_rtt);
+  RUN_TEST(test_retransmits_then_gives_up);
+  RUN_TEST(test_other_session_is_ignored);
+  return UNITY_END();
+}
@@ -0,0 +1,163 @@
+// Udp transport negotiation against server socket on loopback (pio test -e native)
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <hal.h>
+#include <unity.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "pins.h"
+#include "radio/transport.hpp"
+
+#define SERVER_PORT 47811
+#define SESSION 0x0BADCAFE
+
+static std::vector<std::string> parsed;
+static WiFiUDP server;
+static uint16_t stationPort = 0; // from first datagram of station
+
+// websocket.hpp isn't linked, frames that came over udp end here
+void parseTextFrame(uint8_t *payload, size_t length) {
+  parsed.push_back(std::string((const char *)payload, length));
+}
+
+void wsBegin(const char */*host*/, int /*port*/, const char */*path*/, bool /*secure*/) {}
+
+struct Datagram {
+  uint8_t type = 0;
+  uint16_t seq = 0;
+  uint32_t session = 0;
+  std::string payload;
+};
+
+static void serverSend(RudpType type, uint16_t seq, const char *payload = "") {
+  uint8_t header[RUDP_HEADER_SIZE] = {RUDP_MAGIC, type, (uint8_t)seq, (uint8_t)(seq >> 8), (uint8_t)SESSION,
+                                      (uint8_t)(SESSION >> 8), (uint8_t)(SESSION >> 16), (uint8_t)(SESSION >> 24)};
+  server.beginPacket(IPAddress(127, 0, 0, 1), stationPort);
+  server.write(header, sizeof(header));
+  server.write((const uint8_t *)payload, strlen(payload));
+  server.endPacket();
+}
+
+/// @brief Runs transport loop until station sends datagram of given type (real time, sockets are real)
+static bool serverReceive(RudpType type, Datagram &out, int timeoutMs = 1000) {
+  for (int i = 0; i < timeoutMs; i++) {
+    transportLoop();
+
+    uint8_t buf[RUDP_HEADER_SIZE + RUDP_MAX_PAYLOAD];
+    while (server.parsePacket() > 0) {
+      int len = server.read(buf, sizeof(buf));
+      if (len < RUDP_HEADER_SIZE || buf[0] != RUDP_MAGIC) continue;
+
+      stationPort = server.remotePort();
+      out.type = buf[1];
+      out.seq = buf[2] | buf[3] << 8;
+      out.session = buf[4] | buf[5] << 8 | buf[6] << 16 | (uint32_t)buf[7] << 24;
+      out.payload = std::string((const char *)buf + RUDP_HEADER_SIZE, len - RUDP_HEADER_SIZE);
+      if (out.type == type) return true;
+    }
+
+    usleep(1000);
+    delay(1);
+  }
+
+  return false;
+}
+
+static void negotiate(uint16_t port) {
+  JsonDocument doc;
+  doc["udp_port"] = port;
+  doc["session"] = SESSION;
+  parseTransport(doc.as<JsonObject>());
+}
+
+static void loopFor(int ms) {
+  for (int i = 0; i < ms; i++) {
+    transportLoop();
+    usleep(1000);
+    delay(1);
+  }
+}
+
+void setUp() {
+  parsed.clear();
+  transportOnDisconnected();
+}
+
+void tearDown() {}
+
+void test_without_udp_port_stays_on_websocket() {
+  negotiate(0);
+  loopFor(50);
+
+  TEST_ASSERT_FALSE(udpTransport.connected());
+  TEST_ASSERT_TRUE(fastTransport(16) == &wsTransport);
+}
+
+void test_negotiated_udp_carries_frames() {
+  negotiate(SERVER_PORT);
+
+  Datagram hello;
+  TEST_ASSERT_TRUE(serverReceive(RUDP_HELLO, hello));
+  TEST_ASSERT_EQUAL_UINT32(SESSION, hello.session);
+  TEST_ASSERT_TRUE(fastTransport(16) == &wsTransport); // until server answers
+
+  serverSend(RUDP_HELLO_ACK, hello.seq);
+  loopFor(20);
+  TEST_ASSERT_TRUE(udpTransport.connected());
+  TEST_ASSERT_TRUE(fastTransport(16) == &udpTransport);
+  TEST_ASSERT_TRUE(fastTransport(RUDP_MAX_PAYLOAD + 1) == &wsTransport);
+
+  // station -> server
+  const char *solve = "{\"solve\":{\"request_id\":1}}";
+  TEST_ASSERT_TRUE(fastTransport(strlen(solve))->sendText((const uint8_t *)solve, strlen(solve)));
+  Datagram data;
+  TEST_ASSERT_TRUE(serverReceive(RUDP_DATA, data));
+  TEST_ASSERT_EQUAL_STRING(solve, data.payload.c_str());
+  serverSend(RUDP_ACK, data.seq);
+
+  // server -> station, parsed outside of transport lock and acked
+  serverSend(RUDP_DATA, 1, "{\"solve_confirm\":{}}");
+  Datagram ack;
+  TEST_ASSERT_TRUE(serverReceive(RUDP_ACK, ack));
+  TEST_ASSERT_EQUAL(1, ack.seq);
+  TEST_ASSERT_EQUAL(1, parsed.size());
+  TEST_ASSERT_EQUAL_STRING("{\"solve_confirm\":{}}", parsed[0].c_str());
+  TEST_ASSERT_EQUAL(0, udpTransport.stats().retransmits);
+}
+
+void test_websocket_disconnect_ends_udp_session() {
+  negotiate(SERVER_PORT);
+  Datagram hello;
+  TEST_ASSERT_TRUE(serverReceive(RUDP_HELLO, hello));
+  serverSend(RUDP_HELLO_ACK, hello.seq);
+  loopFor(20);
+  TEST_ASSERT_TRUE(fastTransport(16) == &udpTransport);
+
+  transportOnDisconnected();
+  TEST_ASSERT_FALSE(udpTransport.connected());
+  TEST_ASSERT_TRUE(fastTransport(16) == &wsTransport);
+
+  // frames of finished session are ignored
+  serverSend(RUDP_DATA, 2, "{\"late\":1}");
+  loopFor(20);
+  TEST_ASSERT_EQUAL(0, parsed.size());
+}
+
+int main() {
+  WiFi.mode(WIFI_STA);
+  WiFi.begin("test", "test");
+  delay(HAL_WIFI_CONNECT_US / 1000 + 1); // hostByName needs connection
+  strcpy(wsCache.host, "127.0.0.1");
+  server.begin(SERVER_PORT);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_without_udp_port_stays_on_websocket);
+  RUN_TEST(test_negotiated_udp_carries_frames);
+  RUN_TEST(test_websocket_disconnect_ends_udp_session);
+  return UNITY_END();
+}
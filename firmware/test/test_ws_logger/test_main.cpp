@@ -0,0 +1,193 @@
+// WsLogger ring buffer and transport handling on native_hal (pio test -e native)
+
+#include <Arduino.h>
+#include <unity.h>
+#include <ws_logger.h>
+#include <transport.h>
+#include <string>
+#include <vector>
+
+// record is 8 B header (len, level, flags + millis) and message padded to 4 bytes
+#define RECORD_TEXT "record 000 padded to forty bytes...."
+#define RECORD_SIZE (8 + ((sizeof(RECORD_TEXT) - 1 + 3) & ~3))
+#define RECORDS_OVER_3_4 (WS_LOGGER_BUFFER_SIZE * 3 / 4 / RECORD_SIZE + 2) // disconnected logger drops oldest above 3/4
+
+class FakeTransport : public Transport {
+  public:
+    bool up = true;
+    bool full = false;
+    std::vector<std::string> frames;
+
+    const char *name() override { return "fake"; }
+    bool connected() override { return up; }
+    bool busy() override { return full; }
+    size_t maxFrameSize() override { return SIZE_MAX; }
+
+    bool sendText(const uint8_t *data, size_t len) override {
+      if (!up || full) return false;
+      frames.push_back(std::string((const char *)data, len));
+      return true;
+    }
+
+    bool sent(const char *text) {
+      for (std::string &f : frames) {
+        if (f.find(text) != std::string::npos) return true;
+      }
+      return false;
+    }
+};
+
+static WsLogger *logger;
+static FakeTransport *transport;
+
+static void logRecords(int count) {
+  for (int i = 0; i < count; i++) logger->logf(LOG_INFO, "record %03d padded to forty bytes....", i);
+}
+
+static std::string lastRecord() {
+  char text[16];
+  snprintf(text, sizeof(text), "record %03d", (int)RECORDS_OVER_3_4 - 1);
+  return text;
+}
+
+void setUp() {
+  logger = new WsLogger(); // serial isn't set, records only go to transport
+  transport = new FakeTransport();
+  logger->setTransport(transport);
+}
+
+void tearDown() {
+  delete logger;
+  delete transport;
+}
+
+void test_records_are_sent_as_logs_frame() {
+  logger->logf(LOG_WARN, "first %d", 1);
+  logger->printf("second\n");
+  logger->loop(true);
+
+  TEST_ASSERT_EQUAL(1, transport->frames.size());
+  TEST_ASSERT_TRUE(transport->sent("\"msg\":\"first 1\""));
+  TEST_ASSERT_TRUE(transport->sent("\"msg\":\"second\\n\""));
+  TEST_ASSERT_TRUE(transport->sent("\"dropped\":0"));
+
+  logger->loop(true);
+  TEST_ASSERT_EQUAL(1, transport->frames.size());
+}
+
+static bool clockSynced = false;
+static bool testClock(uint64_t &epochMs, uint32_t &errMs) {
+  epochMs = 1700000000123ULL;
+  errMs = 7;
+  return clockSynced;
+}
+
+void test_frames_are_stamped_once_clock_is_synced() {
+  logger->setClock(testClock);
+  logger->logf(LOG_INFO, "before sync");
+  logger->loop(true);
+  TEST_ASSERT_FALSE(transport->sent("\"epoch_ms\""));
+
+  clockSynced = true;
+  logger->logf(LOG_INFO, "after sync");
+  logger->loop(true);
+  clockSynced = false;
+
+  TEST_ASSERT_EQUAL(2, transport->frames.size());
+  TEST_ASSERT_TRUE(transport->frames[1].find("\"epoch_ms\":1700000000123,\"err_ms\":7,\"millis\":") != std::string::npos);
+  TEST_ASSERT_TRUE(transport->frames[1].find("\"msg\":\"after sync\"") != std::string::npos);
+}
+
+void test_print_writes_are_joined_into_line() {
+  Print &out = *logger;
+  out.print("value: ");
+  out.print(42);
+  out.println();
+  logger->loop(true);
+
+  TEST_ASSERT_TRUE(transport->sent("\"msg\":\"value: 42\\r\\n\""));
+}
+
+static void printLineInParts(void */*param*/) {
+  Print &out = *logger;
+  out.print("task ");
+  delay(10);
+  out.print("line");
+  out.println();
+  vTaskDelete(NULL);
+}
+
+void test_lines_of_tasks_on_same_core_are_not_mixed() {
+  xTaskCreatePinnedToCore(printLineInParts, "other", 4096, NULL, 1, NULL, xPortGetCoreID());
+
+  // tasks switch in delay, both lines are unfinished at the same time
+  Print &out = *logger;
+  out.print("main ");
+  delay(5);
+  out.print("line");
+  delay(10);
+  out.println();
+  delay(10);
+  logger->loop(true);
+
+  TEST_ASSERT_TRUE(transport->sent("\"msg\":\"task line\\r\\n\""));
+  TEST_ASSERT_TRUE(transport->sent("\"msg\":\"main line\\r\\n\""));
+}
+
+void test_busy_transport_keeps_oldest_records() {
+  transport->full = true;
+  logRecords(RECORDS_OVER_3_4);
+  logger->loop(true);
+  TEST_ASSERT_EQUAL(0, transport->frames.size());
+  TEST_ASSERT_EQUAL(0, logger->dropped.load());
+
+  transport->full = false;
+  logger->loop(true);
+  TEST_ASSERT_TRUE(transport->sent("record 000"));
+  TEST_ASSERT_TRUE(transport->sent(lastRecord().c_str()));
+  TEST_ASSERT_EQUAL(0, logger->dropped.load());
+}
+
+void test_disconnected_drops_oldest_records() {
+  transport->up = false;
+  logRecords(RECORDS_OVER_3_4);
+  logger->loop(true);
+  TEST_ASSERT_TRUE(logger->dropped.load() > 0);
+
+  transport->up = true;
+  logger->loop(true);
+  TEST_ASSERT_FALSE(transport->sent("record 000"));
+  TEST_ASSERT_TRUE(transport->sent(lastRecord().c_str()));
+  TEST_ASSERT_TRUE(transport->frames[0].find("\"dropped\":0,") == std::string::npos); // delta is in first frame
+}
+
+// LOG_RATE_LIMITED always goes to global Logger, so it's the one under test here
+void test_suppressed_records_are_reported_once() {
+  Logger.setTransport(transport);
+  for (int i = 0; i < 3; i++) LOG_RATE_LIMITED(1000, LOG_WARN, "rate limited\n");
+  Logger.loop(true);
+
+  TEST_ASSERT_EQUAL(1, transport->frames.size());
+  TEST_ASSERT_TRUE(transport->frames[0].find("\"msg\":\"rate limited\\n\"") != std::string::npos);
+  TEST_ASSERT_TRUE(transport->frames[0].find("\"suppressed\":2") != std::string::npos);
+
+  delay(1000);
+  LOG_RATE_LIMITED(1000, LOG_WARN, "again\n"); // interval passed, not suppressed
+  Logger.loop(true);
+  Logger.setTransport(NULL);
+
+  TEST_ASSERT_EQUAL(2, transport->frames.size());
+  TEST_ASSERT_TRUE(transport->frames[1].find("\"suppressed\":0") != std::string::npos);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_records_are_sent_as_logs_frame);
+  RUN_TEST(test_frames_are_stamped_once_clock_is_synced);
+  RUN_TEST(test_print_writes_are_joined_into_line);
+  RUN_TEST(test_lines_of_tasks_on_same_core_are_not_mixed);
+  RUN_TEST(test_busy_transport_keeps_oldest_records);
+  RUN_TEST(test_disconnected_drops_oldest_records);
+  RUN_TEST(test_suppressed_records_are_reported_once);
+  return UNITY_END();
+}
@@ -0,0 +1,133 @@
+"""Reliable udp channel, python side of lib/transport/reliable_udp.{h,cpp}.
+
+Used by test_server.py (server side) and station_sim.py (station side).
+Datagram: [magic(8) | type(8) | seq(16)] [session(32)] [payload], little endian.
+"""
+import asyncio
+import random
+import struct
+import time
+
+MAGIC = 0xF7
+HEADER = struct.Struct("<BBHI")
+DATA, ACK, HELLO, HELLO_ACK = 1, 2, 3, 4
+
+MAX_PAYLOAD = 512
+INITIAL_RTO = 0.25
+MIN_RTO = 0.03
+MAX_RTO = 2.0
+MAX_RETRIES = 5
+
+
+class Channel:
+    """One session, sends through send_datagram(bytes), delivers payloads to on_frame(bytes)"""
+
+    def __init__(self, session, send_datagram, on_frame):
+        self.session = session
+        self.send_datagram = send_datagram
+        self.on_frame = on_frame
+        self.next_seq = 1
+        self.pending = {}  # seq -> (packet, sent_at, timeout, retries)
+        self.received = set()
+        self.srtt = None
+        self.rttvar = 0
+        self.rto = INITIAL_RTO
+        self.heard = False  # anything valid from other side
+        self.stats = {"sent": 0, "received": 0, "retransmits": 0, "failed": 0, "duplicates": 0}
+        self.task = asyncio.get_event_loop().create_task(self._retransmit())
+
+    def close(self):
+        self.task.cancel()
+
+    def _packet(self, type, seq, payload=b""):
+        return HEADER.pack(MAGIC, type, seq, self.session) + payload
+
+    def send(self, payload):
+        if len(payload) > MAX_PAYLOAD:
+            raise ValueError("frame too big for udp transport")
+
+        seq = self.next_seq
+        self.next_seq = self.next_seq % 0xFFFF + 1
+        packet = self._packet(DATA, seq, payload)
+        self.pending[seq] = (packet, time.monotonic(), self.rto, 0)
+        self.stats["sent"] += 1
+        self.send_datagram(packet)
+
+    def hello(self, seq):
+        self.send_datagram(self._packet(HELLO, seq))
+
+    def datagram(self, data):
+        if len(data) < HEADER.size:
+            return
+
+        magic, type, seq, session = HEADER.unpack_from(data)
+        if magic != MAGIC or session != self.session:
+            return
+
+        self.heard = True
+        if type == DATA:
+            self.send_datagram(self._packet(ACK, seq))
+            if seq in self.received:
+                self.stats["duplicates"] += 1
+                return
+
+            self.received.add(seq)
+            if len(self.received) > 1024:
+                self.received = {s for s in self.received if (seq - s) % 0x10000 < 512}
+
+            self.stats["received"] += 1
+            self.on_frame(data[HEADER.size:])
+        elif type == ACK and seq in self.pending:
+            _, sent_at, _, retries = self.pending.pop(seq)
+            if retries == 0:
+                self._rtt(time.monotonic() - sent_at)
+        elif type == HELLO:
+            self.send_datagram(self._packet(HELLO_ACK, seq))
+
+    def _rtt(self, rtt):
+        if self.srtt is None:
+            self.srtt, self.rttvar = rtt, rtt / 2
+        else:
+            self.rttvar = 0.75 * self.rttvar + 0.25 * abs(rtt - self.srtt)
+            self.srtt = 0.875 * self.srtt + 0.125 * rtt
+
+        self.rto = min(max(self.srtt + 4 * self.rttvar, MIN_RTO), MAX_RTO)
+
+    async def _retransmit(self):
+        while True:
+            await asyncio.sleep(0.01)
+            now = time.monotonic()
+            for seq, (packet, sent_at, timeout, retries) in list(self.pending.items()):
+                if now - sent_at < timeout:
+                    continue
+
+                if retries >= MAX_RETRIES:
+                    del self.pending[seq]
+                    self.stats["failed"] += 1
+                    continue
+
+                self.pending[seq] = (packet, now, min(timeout * 2, MAX_RTO), retries + 1)
+                self.stats["retransmits"] += 1
+                self.send_datagram(packet)
+
+
+class LossyProtocol(asyncio.DatagramProtocol):
+    """Datagram endpoint dropping given fraction of datagrams in both directions (loss simulation)"""
+
+    def __init__(self, on_datagram, loss=0.0):
+        self.on_datagram = on_datagram
+        self.loss = loss
+        self.transport = None
+
+    def connection_made(self, transport):
+        self.transport = transport
+
+    def datagram_received(self, data, addr):
+        if random.random() < self.loss:
+            return
+        self.on_datagram(data, addr)
+
+    def sendto(self, data, addr=None):
+        if random.random() < self.loss:
+            return
+        self.transport.sendto(data, addr)
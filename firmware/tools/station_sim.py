@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""Simulated station, measures request round trip over websocket and udp transport.
+
+Sends card_info_request frames the way firmware does (request_id, retry after timeout) and
+prints rtt percentiles. With --udp, udp is offered in ws url and used once server answers
+with "transport" frame. Run against tools/test_server.py (or real server) on loopback:
+
+    python3 tools/test_server.py --port 8080 --udp 8081 --loss 0.1
+    python3 tools/station_sim.py ws://127.0.0.1:8080/ --udp --requests 200
+"""
+import argparse
+import asyncio
+import json
+import statistics
+import time
+
+import websockets
+
+import rudp
+
+REQUEST_TIMEOUT = 1.0  # CARD_REQUEST_TIMEOUT (first attempt)
+REQUEST_RETRIES = 2
+
+
+class Station:
+    def __init__(self, args):
+        self.args = args
+        self.waiting = {}  # request_id -> future
+        self.channel = None
+        self.udp_up = asyncio.Event()
+
+    def on_frame(self, frame):
+        if "transport" in frame:
+            asyncio.get_event_loop().create_task(self.start_udp(frame["transport"]))
+            return
+
+        for key in ("card_info_response", "solve_confirm"):
+            if key in frame:
+                future = self.waiting.pop(frame[key].get("request_id"), None)
+                if future is not None and not future.done():
+                    future.set_result(frame[key])
+
+    async def start_udp(self, transport):
+        host = self.args.url.split("://", 1)[1].split("/", 1)[0].rsplit(":", 1)[0]
+        loop = asyncio.get_running_loop()
+
+        endpoint = rudp.LossyProtocol(lambda data, addr: self.channel.datagram(data), self.args.loss)
+        await loop.create_datagram_endpoint(lambda: endpoint, remote_addr=(host, transport["udp_port"]))
+        self.channel = rudp.Channel(transport["session"], endpoint.sendto, lambda p: self.on_frame(json.loads(p)))
+
+        # server learns station address from hello (answered with hello ack)
+        for seq in range(1, 20):
+            self.channel.hello(seq)
+            await asyncio.sleep(rudp.INITIAL_RTO)
+            if self.channel.heard:
+                break
+
+        self.udp_up.set()
+
+    async def request(self, ws, request_id, card_id):
+        frame = json.dumps({"card_info_request": {"card_id": card_id, "esp_id": 1, "request_id": request_id}})
+        future = asyncio.get_running_loop().create_future()
+        self.waiting[request_id] = future
+
+        start = time.monotonic()
+        timeout = REQUEST_TIMEOUT
+        for attempt in range(REQUEST_RETRIES + 1):
+            if self.channel is not None:
+                self.channel.send(frame.encode())
+            else:
+                await ws.send(frame)
+
+            try:
+                await asyncio.wait_for(asyncio.shield(future), timeout)
+                return time.monotonic() - start, attempt
+            except asyncio.TimeoutError:
+                timeout *= 2
+
+        self.waiting.pop(request_id, None)
+        return None, REQUEST_RETRIES
+
+    async def run(self):
+        url = self.args.url + ("&" if "?" in self.args.url else "?") + "id=1&ver=sim"
+        if self.args.udp:
+            url += "&transports=ws,udp"
+
+        async with websockets.connect(url) as ws:
+            async def reader():
+                async for message in ws:
+                    self.on_frame(json.loads(message))
+
+            reader_task = asyncio.create_task(reader())
+            if self.args.udp:
+                await asyncio.wait_for(self.udp_up.wait(), 5)
+
+            rtts, retries, failed = [], 0, 0
+            for i in range(self.args.requests):
+                rtt, attempts = await self.request(ws, i + 1, 1000 + i)
+                retries += attempts
+                if rtt is None:
+                    failed += 1
+                else:
+                    rtts.append(rtt * 1000)
+                await asyncio.sleep(self.args.interval)
+
+            reader_task.cancel()
+
+        transport = "udp" if self.channel is not None else "ws"
+        print(f"transport: {transport}, requests: {self.args.requests}, failed: {failed}, app retries: {retries}")
+        if rtts:
+            rtts.sort()
+            p = lambda q: rtts[min(len(rtts) - 1, int(len(rtts) * q))]
+            print(f"rtt ms: avg {statistics.mean(rtts):.2f}, p50 {p(0.5):.2f}, p90 {p(0.9):.2f}, p99 {p(0.99):.2f}, max {rtts[-1]:.2f}")
+        if self.channel is not None:
+            print(f"udp: {self.channel.stats}")
+            self.channel.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("url", help="ws://host:port/")
+    parser.add_argument("--udp", action="store_true", help="offer udp transport")
+    parser.add_argument("--requests", type=int, default=100)
+    parser.add_argument("--interval", type=float, default=0.02, help="s between requests")
+    parser.add_argument("--loss", type=float, default=0.0, help="fraction of dropped udp datagrams")
+    asyncio.run(Station(parser.parse_args()).run())
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,318 @@
+#!/usr/bin/env python3
+"""Minimal stand-in for the backend, for testing stations without the real server.
+
+Answers time_sync, card_info_request and solve frames (every card can compete), sends
+epoch_time + device_settings after connect and prints everything else.
+
+    pip install websockets
+    python3 tools/test_server.py --port 8080            # ws://<ip>:8080/
+    python3 tools/test_server.py --port 8443 --tls      # wss://<ip>:8443/
+
+With --tls a self signed certificate is generated (tools/test_cert.pem, needs openssl),
+its PEM goes into src/ws_ca.h (WS_TLS_CA) and printed sha256 into WS_TLS_FINGERPRINT.
+Hostname has to match --cn (station verifies it, so use mdns name or ip).
+With --mdns (needs zeroconf) server is advertised as _stackmat._tcp like the real one.
+
+With --udp PORT stations offering udp (transports=ws,udp in ws url) get "transport" frame
+and their requests can come over reliable udp (see tools/rudp.py), responses are sent
+back over the transport request came from. --loss drops given fraction of datagrams.
+Firmware itself (TRANSPORT_UDP is on by default) can run against it on host:
+
+    python3 tools/test_server.py --host 127.0.0.1 --port 8080 --udp 8081 --loss 0.1
+    .pio/build/native/program --server ws://127.0.0.1:8080/ --card 0A0B0C0D@8 --solve 9000@10
+
+With --subscribe MS stations are asked to stream state_delta frames, deltas are applied
+to last keyframe and merged state is printed (seq gap - station is asked for keyframe).
+
+With --time-stream MS stations send binary running time frames while timer runs (and final
+stop frame), printed with delay since station received stackmat frame (needs synced clock).
+
+With --history stations are asked to export their solve history (src/history.hpp) after
+connect, records are printed as they come (unconfirmed ones marked with *).
+"""
+import argparse
+import asyncio
+import json
+import os
+import random
+import socket
+import ssl
+import struct
+import subprocess
+import sys
+import time
+from urllib.parse import parse_qs, urlparse
+
+import websockets
+
+import rudp
+
+TOOLS_DIR = os.path.dirname(os.path.abspath(__file__))
+
+udp_endpoint = None
+udp_sessions = {}  # session -> (esp_id, channel or None)
+subscribe_interval = None
+time_stream_interval = None
+history_export = False
+
+TIME_FRAME = struct.Struct("<BBBBIIq")  # src/time_stream.hpp TimeStreamFrame
+TIME_STREAM_MAGIC = 0xB7
+TIME_STREAM_FINAL, TIME_STREAM_EPOCH = 0x01, 0x02
+
+
+def epoch_ms():
+    return time.time() * 1000
+
+
+def generate_cert(cert, key, cn):
+    if os.path.exists(cert) and os.path.exists(key):
+        return
+
+    san = f"IP:{cn}" if cn.replace(".", "").isdigit() else f"DNS:{cn}"
+    subprocess.run(["openssl", "req", "-x509", "-newkey", "ec", "-pkeyopt", "ec_paramgen_curve:prime256v1",
+                    "-nodes", "-days", "3650", "-subj", f"/CN={cn}", "-addext", f"subjectAltName={san}",
+                    "-keyout", key, "-out", cert], check=True, capture_output=True)
+
+
+def fingerprint(cert):
+    out = subprocess.run(["openssl", "x509", "-in", cert, "-noout", "-fingerprint", "-sha256"],
+                         check=True, capture_output=True, text=True).stdout
+    return out.strip().split("=", 1)[1]
+
+
+def request_path(ws):
+    request = getattr(ws, "request", None)
+    return request.path if request is not None else ws.path
+
+
+def handle_frame(frame, esp_id):
+    """Returns list of response frames"""
+    if "time_sync" in frame:
+        t1 = epoch_ms()
+        return [{"time_sync": {"esp_id": esp_id, "t0": frame["time_sync"]["t0"], "t1": t1, "t2": epoch_ms()}}]
+
+    if "card_info_request" in frame:
+        req = frame["card_info_request"]
+        return [{"card_info_response": {
+            "card_id": req["card_id"],
+            "esp_id": esp_id,
+            "request_id": req.get("request_id", 0),
+            "display": f"Test {req['card_id'] % 1000}",
+            "country_iso2": "PL",
+            "can_compete": True,
+        }}]
+
+    if "solve" in frame:
+        solve = frame["solve"]
+        print(f"solve: {solve['solve_time']} ms (+{solve['penalty']}), competitor {solve['competitor_id']}")
+        return [{"solve_confirm": {
+            "esp_id": esp_id,
+            "request_id": solve.get("request_id", 0),
+            "competitor_id": solve["competitor_id"],
+            "session_id": solve["session_id"],
+        }}]
+
+    return []
+
+
+def print_frame(frame, message, esp_id, responses):
+    if "logs" in frame:
+        for log in frame["logs"]["logs"]:
+            print(f"[{esp_id}] {log}")
+    elif "history" in frame:
+        history = frame["history"]
+        for r in history["records"]:
+            mark = " " if r["confirmed"] else "*"
+            print(f"[{esp_id}] history{mark}{r['seq']}: {r['session_id']} {r['solve_time']} ms (+{r['penalty']}), "
+                  f"competitor {r['competitor_id']}, judge {r['judge_id']}, delegate {r['delegate']}")
+        if history.get("done", True):
+            print(f"[{esp_id}] history: seq {history['first_seq']}-{history['next_seq'] - 1} of {history['capacity']}")
+    elif not responses:
+        print(message)
+
+
+def udp_datagram(data, addr):
+    if len(data) < rudp.HEADER.size:
+        return
+
+    session = rudp.HEADER.unpack_from(data)[3]
+    if session not in udp_sessions:
+        return
+
+    esp_id, channel = udp_sessions[session]
+    if channel is None:
+        def on_frame(payload):
+            frame = json.loads(payload)
+            responses = handle_frame(frame, esp_id)
+            print_frame(frame, payload.decode(), esp_id, responses)
+            for response in responses:
+                channel.send(json.dumps(response).encode())
+
+        channel = rudp.Channel(session, lambda packet: udp_endpoint.sendto(packet, addr), on_frame)
+        udp_sessions[session] = (esp_id, channel)
+        print(f"udp: {addr[0]}:{addr[1]} (esp_id: {esp_id}, session: {session})")
+
+    channel.datagram(data)
+
+
+class StreamedState:
+    def __init__(self):
+        self.state = None
+        self.seq = 0
+
+    def apply(self, delta):
+        """Returns false if delta can't be applied (station should send keyframe)"""
+        seq = delta.pop("seq")
+        key = delta.pop("key")
+        delta.pop("esp_id", None)
+        for stamp in ("epoch_ms", "err_ms"):
+            delta.pop(stamp, None)
+
+        if key:
+            self.state = delta
+        elif self.state is None or seq != self.seq + 1:
+            self.seq = seq
+            return False
+        else:
+            self.state.update(delta)
+
+        self.seq = seq
+        return True
+
+
+def print_time_frame(message):
+    magic, flags, state, seq, esp_id, elapsed, rx_us = TIME_FRAME.unpack(message)
+    delay = f"{epoch_ms() - rx_us / 1000:.1f} ms" if flags & TIME_STREAM_EPOCH else "?"
+    kind = "stop" if flags & TIME_STREAM_FINAL else "time"
+    print(f"[{esp_id}] {kind} {seq}: {elapsed / 1000:.3f}s (state: {chr(state)!r}, delay: {delay})")
+
+
+def subscribe_frame(esp_id):
+    return json.dumps({"state_subscribe": {"esp_id": esp_id, "interval_ms": subscribe_interval}})
+
+
+async def station(ws):
+    query = parse_qs(urlparse(request_path(ws)).query)
+    esp_id = int(query.get("id", ["0"])[0])
+    address = ws.remote_address[0]
+    print(f"connected: {address} (esp_id: {esp_id}, firmware: {query.get('ver', ['?'])[0]})")
+
+    await ws.send(json.dumps({"epoch_time": {"current_epoch": int(time.time())}}))
+    await ws.send(json.dumps({"device_settings": {"esp_id": esp_id, "use_inspection": True, "added": True}}))
+
+    streamed = StreamedState()
+    if subscribe_interval is not None:
+        await ws.send(subscribe_frame(esp_id))
+    if time_stream_interval is not None:
+        await ws.send(json.dumps({"time_stream": {"esp_id": esp_id, "interval_ms": time_stream_interval}}))
+    if history_export:
+        await ws.send(json.dumps({"history_request": {"esp_id": esp_id, "from_seq": 0}}))
+
+    session = None
+    if udp_endpoint is not None and "udp" in query.get("transports", [""])[0].split(","):
+        session = random.getrandbits(32)
+        udp_sessions[session] = (esp_id, None)
+        port = udp_endpoint.transport.get_extra_info("sockname")[1]
+        await ws.send(json.dumps({"transport": {"udp_port": port, "session": session}}))
+
+    try:
+        async for message in ws:
+            if isinstance(message, bytes):
+                if len(message) == TIME_FRAME.size and message[0] == TIME_STREAM_MAGIC:
+                    print_time_frame(message)
+                    continue
+                print(f"binary frame: {len(message)} bytes")
+                continue
+
+            frame = json.loads(message)
+            if "state_delta" in frame:
+                delta = frame["state_delta"]
+                changed = sorted(k for k in delta if k not in ("seq", "key", "esp_id", "epoch_ms", "err_ms"))
+                if streamed.apply(delta):
+                    print(f"[{esp_id}] state {streamed.seq}: {changed} -> {streamed.state}")
+                else:
+                    print(f"[{esp_id}] state {streamed.seq}: gap, asking for keyframe")
+                    await ws.send(subscribe_frame(esp_id))
+                continue
+
+            responses = handle_frame(frame, esp_id)
+            print_frame(frame, message, esp_id, responses)
+
+            for response in responses:
+                await ws.send(json.dumps(response))
+    except websockets.ConnectionClosed:
+        pass
+    finally:
+        if session is not None:
+            channel = udp_sessions.pop(session)[1]
+            if channel is not None:
+                print(f"udp stats: {channel.stats}")
+                channel.close()
+
+    print(f"disconnected: {address}")
+
+
+def advertise(url, port):
+    from zeroconf import ServiceInfo, Zeroconf
+
+    ip = socket.gethostbyname(socket.gethostname())
+    info = ServiceInfo("_stackmat._tcp.local.", "test._stackmat._tcp.local.", addresses=[socket.inet_aton(ip)],
+                       port=port, properties={"ws": url})
+    zc = Zeroconf()
+    zc.register_service(info)
+    return zc
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--tls", action="store_true", help="serve wss:// with self signed certificate")
+    parser.add_argument("--cn", default=socket.gethostbyname(socket.gethostname()), help="certificate hostname")
+    parser.add_argument("--cert", default=os.path.join(TOOLS_DIR, "test_cert.pem"))
+    parser.add_argument("--key", default=os.path.join(TOOLS_DIR, "test_key.pem"))
+    parser.add_argument("--mdns", action="store_true", help="advertise as _stackmat._tcp")
+    parser.add_argument("--udp", type=int, help="offer udp transport on this port")
+    parser.add_argument("--loss", type=float, default=0.0, help="fraction of dropped udp datagrams")
+    parser.add_argument("--subscribe", type=int, metavar="MS", help="subscribe to state_delta stream")
+    parser.add_argument("--time-stream", type=int, metavar="MS", help="enable running time stream")
+    parser.add_argument("--history", action="store_true", help="export solve history after connect")
+    args = parser.parse_args()
+
+    global subscribe_interval
+    subscribe_interval = args.subscribe
+    global time_stream_interval
+    time_stream_interval = args.time_stream
+    global history_export
+    history_export = args.history
+
+    if args.udp is not None:
+        global udp_endpoint
+        udp_endpoint = rudp.LossyProtocol(udp_datagram, args.loss)
+        await asyncio.get_running_loop().create_datagram_endpoint(lambda: udp_endpoint, local_addr=(args.host, args.udp))
+
+    ssl_context = None
+    if args.tls:
+        generate_cert(args.cert, args.key, args.cn)
+        ssl_context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        ssl_context.load_cert_chain(args.cert, args.key)
+        print(f"CA (src/ws_ca.h): {args.cert}")
+        print(f"WS_TLS_FINGERPRINT \"{fingerprint(args.cert)}\"")
+
+    url = f"{'wss' if args.tls else 'ws'}://{args.cn}:{args.port}/"
+    zc = advertise(url, args.port) if args.mdns else None
+
+    print(f"listening on {url}")
+    try:
+        async with websockets.serve(station, args.host, args.port, ssl=ssl_context):
+            await asyncio.Future()
+    finally:
+        if zc is not None:
+            zc.close()
+
+
+if __name__ == "__main__":
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        sys.exit(0)
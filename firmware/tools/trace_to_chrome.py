@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""Converts station trace dumps into Chrome/Perfetto trace json.
+
+Input is a file with "trace_dump" (or "black_box") frames (one json frame per line, as logged
+by the server), output can be opened in chrome://tracing or ui.perfetto.dev.
+
+    python3 tools/trace_to_chrome.py dump.jsonl trace.json
+"""
+import base64
+import json
+import struct
+import sys
+
+# Keep in sync with src/trace.hpp
+EVENT_FORMAT = "<IBBHI"
+EVENT_SIZE = struct.calcsize(EVENT_FORMAT)
+
+TRACE_SCENE = 1
+TRACE_STACKMAT = 2
+TRACE_BUTTON = 3
+TRACE_RFID = 4
+TRACE_WS_SEND = 5
+TRACE_WS_RECV = 6
+TRACE_LCD_FLUSH = 7
+
+SCENES = [
+    "NOT_INITALIZED",
+    "WAITING_FOR_COMPETITOR",
+    "WAITING_FOR_COMPETITOR_WITH_TIME",
+    "COMPETITOR_INFO",
+    "INSPECTION",
+    "TIMER_TIME",
+    "FINISHED_TIME",
+    "ERROR",
+]
+STACKMAT_STATES = {0: "Unknown", ord("I"): "Reset", ord(" "): "Running", ord("S"): "Stopped"}
+
+TID_SCENE = 10
+TID_BUTTONS = 11
+
+
+def read_dumps(path):
+    """Returns {(esp_id, now_us): [events]} from trace_dump frames."""
+    dumps = {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+
+            try:
+                frame = json.loads(line)
+            except json.JSONDecodeError:
+                continue
+
+            if not isinstance(frame, dict):
+                continue
+
+            # black box of crashed boot carries last few events in the same format
+            if "black_box" in frame:
+                bb = frame["black_box"]
+                frame = {"trace_dump": {"esp_id": bb["esp_id"], "now_us": "black_box", "offset": 0, "data": bb["trace"]}}
+
+            dump = frame.get("trace_dump")
+            if dump is None:
+                continue
+
+            key = (dump["esp_id"], dump["now_us"])
+            chunks = dumps.setdefault(key, {})
+            chunks[dump["offset"]] = base64.b64decode(dump["data"])
+
+    result = {}
+    for key, chunks in dumps.items():
+        raw = b"".join(chunks[offset] for offset in sorted(chunks))
+        result[key] = [struct.unpack_from(EVENT_FORMAT, raw, i) for i in range(0, len(raw) - EVENT_SIZE + 1, EVENT_SIZE)]
+
+    return result
+
+
+def unwrap(events):
+    """micros() wraps every ~71 minutes, make timestamps monotonic."""
+    offset = 0
+    last = None
+    for us, core, type, arg0, arg1 in events:
+        if last is not None and us + offset < last - (1 << 31):
+            offset += 1 << 32
+        last = us + offset
+        yield last, core, type, arg0, arg1
+
+
+def convert(dumps):
+    out = []
+    for (esp_id, _), events in dumps.items():
+        pid = esp_id
+        out.append({"ph": "M", "name": "process_name", "pid": pid, "args": {"name": f"station {esp_id:x}"}})
+        for tid, name in [(0, "core 0"), (1, "core 1"), (TID_SCENE, "scene"), (TID_BUTTONS, "buttons")]:
+            out.append({"ph": "M", "name": "thread_name", "pid": pid, "tid": tid, "args": {"name": name}})
+
+        scene = None
+        pressed = {}
+        last_ts = 0
+        for ts, core, type, arg0, arg1 in unwrap(events):
+            last_ts = ts
+            base = {"pid": pid, "tid": core, "ts": ts}
+
+            if type == TRACE_SCENE:
+                if scene is not None:
+                    out.append({"ph": "X", "name": SCENES[scene[0]] if scene[0] < len(SCENES) else str(scene[0]),
+                                "pid": pid, "tid": TID_SCENE, "ts": scene[1], "dur": ts - scene[1]})
+                scene = (arg0, ts)
+            elif type == TRACE_STACKMAT:
+                out.append({**base, "ph": "i", "s": "t", "name": "stackmat " + STACKMAT_STATES.get(arg0, str(arg0)),
+                            "args": {"time_ms": arg1}})
+            elif type == TRACE_BUTTON:
+                if arg1:
+                    pressed[arg0] = ts
+                elif arg0 in pressed:
+                    start = pressed.pop(arg0)
+                    out.append({"ph": "X", "name": f"button {arg0}", "pid": pid, "tid": TID_BUTTONS, "ts": start, "dur": ts - start})
+            elif type == TRACE_RFID:
+                out.append({**base, "ph": "i", "s": "t", "name": "rfid", "args": {"uid_size": arg0, "card_id_low": arg1}})
+            elif type == TRACE_WS_SEND:
+                out.append({**base, "ph": "i", "s": "t", "name": "udp send" if arg0 == 1 else "ws send", "args": {"length": arg1}})
+            elif type == TRACE_WS_RECV:
+                out.append({**base, "ph": "i", "s": "t", "name": "ws recv", "args": {"type": arg0, "length": arg1}})
+            elif type == TRACE_LCD_FLUSH:
+                out.append({**base, "ph": "X", "name": "lcd flush", "ts": ts - arg1, "dur": arg1})
+            else:
+                out.append({**base, "ph": "i", "s": "t", "name": f"event {type}", "args": {"arg0": arg0, "arg1": arg1}})
+
+        if scene is not None:
+            out.append({"ph": "X", "name": SCENES[scene[0]] if scene[0] < len(SCENES) else str(scene[0]),
+                        "pid": pid, "tid": TID_SCENE, "ts": scene[1], "dur": last_ts - scene[1]})
+
+    return {"traceEvents": out, "displayTimeUnit": "ms"}
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__)
+        sys.exit(1)
+
+    dumps = read_dumps(sys.argv[1])
+    with open(sys.argv[2], "w") as f:
+        json.dump(convert(dumps), f)
+
+    print(f"Converted {sum(len(e) for e in dumps.values())} events from {len(dumps)} dump(s)")
+
+
+if __name__ == "__main__":
+    main()